@@ -10,6 +10,7 @@ import java.util.List;
 public class DecoderTranslation extends Translation {
 
     protected List<TranslationHypothesis> nbest;
+    protected int degradation = 0;
 
     public DecoderTranslation(Word[] words, Sentence source, Alignment alignment) {
         super(words, source, alignment);
@@ -31,4 +32,16 @@ public class DecoderTranslation extends Translation {
         this.nbest = nbest;
     }
 
+    /**
+     * @return how much the search was simplified to meet the timeout of the request:
+     * 0 full search, 1 reduced beam, 2 monotone search, 3 interrupted (partial translation completed greedily)
+     */
+    public int getDegradation() {
+        return degradation;
+    }
+
+    public void setDegradation(int degradation) {
+        this.degradation = degradation;
+    }
+
 }
@@ -18,7 +18,10 @@ import org.apache.logging.log4j.Logger;
 
 import java.io.File;
 import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
 import java.util.ArrayList;
+import java.util.Arrays;
 import java.util.Collection;
 import java.util.HashMap;
 import java.util.Map;
@@ -39,8 +42,13 @@ public class MosesDecoder implements Decoder, DataListenerProvider {
         }
     }
 
+    private static final int OUTPUT_BUFFER_INITIAL_SIZE = 64 * 1024;
+
     private final FeatureWeightsStorage storage;
     private final HashMap<Long, Long> sessions = new HashMap<>();
+    private final ThreadLocal<ByteBuffer> outputBuffers = ThreadLocal.withInitial(() ->
+            ByteBuffer.allocateDirect(OUTPUT_BUFFER_INITIAL_SIZE).order(ByteOrder.nativeOrder()));
+    private final TranslationXObject.ScoreLayout scoreLayout;
     private long nativeHandle;
 
     private ArrayList<DataListener> dataListeners = null;
@@ -64,6 +72,7 @@ public class MosesDecoder implements Decoder, DataListenerProvider {
 
         this.nativeHandle = instantiate(iniFile.getAbsolutePath(),
                 aligner.getNativeHandle(), vocabulary.getNativeHandle());
+        this.scoreLayout = new TranslationXObject.ScoreLayout(this);
     }
 
     private native long instantiate(String inifile, long aligner, long vocabulary);
@@ -119,6 +128,16 @@ public class MosesDecoder implements Decoder, DataListenerProvider {
 
     private native long createSession(int[] contextKeys, float[] contextValues);
 
+    private long reopenSession(final TranslationSession session, long expiredId) {
+        // the native session expired (see the "session-timeout" option): open a new one with the same context
+        sessions.remove(session.getId(), expiredId);
+
+        if (logger.isDebugEnabled())
+            logger.debug(String.format("Session %d(%d) expired, reopening it.", session.getId(), expiredId));
+
+        return getOrComputeSession(session);
+    }
+
     @Override
     public void closeSession(TranslationSession session) {
         Long internalId = this.sessions.remove(session.getId());
@@ -132,39 +151,58 @@ public class MosesDecoder implements Decoder, DataListenerProvider {
 
     private native void destroySession(long internalId);
 
+    public native long getActiveSessionsCount();
+
+    public native long getSessionsMemoryUsage();
+
     // Translate
 
     @Override
     public DecoderTranslation translate(Sentence text) {
-        return translate(text, null, null, 0);
+        return translate(text, null, null, 0, 0L);
     }
 
     @Override
     public DecoderTranslation translate(Sentence text, ContextVector contextVector) {
-        return translate(text, contextVector, null, 0);
+        return translate(text, contextVector, null, 0, 0L);
     }
 
     @Override
     public DecoderTranslation translate(Sentence text, TranslationSession session) {
-        return translate(text, null, session, 0);
+        return translate(text, null, session, 0, 0L);
     }
 
     @Override
     public DecoderTranslation translate(Sentence text, int nbestListSize) {
-        return translate(text, null, null, nbestListSize);
+        return translate(text, null, null, nbestListSize, 0L);
     }
 
     @Override
     public DecoderTranslation translate(Sentence text, ContextVector contextVector, int nbestListSize) {
-        return translate(text, contextVector, null, nbestListSize);
+        return translate(text, contextVector, null, nbestListSize, 0L);
     }
 
     @Override
     public DecoderTranslation translate(Sentence text, TranslationSession session, int nbestListSize) {
-        return translate(text, null, session, nbestListSize);
+        return translate(text, null, session, nbestListSize, 0L);
     }
 
-    private DecoderTranslation translate(Sentence sentence, ContextVector contextVector, TranslationSession session, int nbest) {
+    /**
+     * Translate within a time budget: when running late the search is simplified step by step, and when
+     * the budget is over the best partial translation is completed and returned.
+     *
+     * @param timeout time budget in milliseconds, 0 for none
+     * @see DecoderTranslation#getDegradation()
+     */
+    public DecoderTranslation translate(Sentence text, ContextVector contextVector, int nbestListSize, long timeout) {
+        return translate(text, contextVector, null, nbestListSize, timeout);
+    }
+
+    public DecoderTranslation translate(Sentence text, TranslationSession session, int nbestListSize, long timeout) {
+        return translate(text, null, session, nbestListSize, timeout);
+    }
+
+    private DecoderTranslation translate(Sentence sentence, ContextVector contextVector, TranslationSession session, int nbest, long timeout) {
         Word[] sourceWords = sentence.getWords();
         if (sourceWords.length == 0)
             return new DecoderTranslation(new Word[0], sentence, null);
@@ -179,18 +217,121 @@ public class MosesDecoder implements Decoder, DataListenerProvider {
         }
 
         long start = System.currentTimeMillis();
-        TranslationXObject xtranslation = this.translate(text, context == null ? null : context.keys, context == null ? null : context.values, sessionId, nbest);
+        ByteBuffer output = outputBuffers.get();
+        int size;
+        try {
+            size = this.translate(text, context == null ? null : context.keys, context == null ? null : context.values, sessionId, nbest, timeout, output);
+        } catch (SessionNotFoundException e) {
+            sessionId = reopenSession(session, sessionId);
+            size = this.translate(text, context == null ? null : context.keys, context == null ? null : context.values, sessionId, nbest, timeout, output);
+        }
+        output = getOutput(output, size);
         long elapsed = System.currentTimeMillis() - start;
 
-        DecoderTranslation translation = xtranslation.getTranslation(sentence);
+        DecoderTranslation translation = TranslationXObject.read(output, sentence, scoreLayout);
         translation.setElapsedTime(elapsed);
 
         logger.info("Translation of " + sentence.length() + " words took " + (((double) elapsed) / 1000.) + "s");
+        if (translation.getDegradation() > 0)
+            logger.warn("Translation of " + sentence.length() + " words degraded to level " + translation.getDegradation() + " to meet the timeout of " + timeout + "ms");
 
         return translation;
     }
 
-    private native TranslationXObject translate(String text, int[] contextKeys, float[] contextValues, long session, int nbest);
+    private native int translate(String text, int[] contextKeys, float[] contextValues, long session, int nbest, long timeout, ByteBuffer output);
+
+    private ByteBuffer getOutput(ByteBuffer output, int size) {
+        if (size < 0) {
+            // the output did not fit: grow the thread buffer and collect the pending native output
+            output = ByteBuffer.allocateDirect(Math.max(-size, output.capacity() * 2)).order(ByteOrder.nativeOrder());
+            outputBuffers.set(output);
+
+            size = readPendingOutput(output);
+        }
+
+        output.clear();
+        output.limit(size);
+
+        return output;
+    }
+
+    private native int readPendingOutput(ByteBuffer output);
+
+    // Batch translate
+
+    public DecoderTranslation[] translate(Sentence[] sentences, ContextVector contextVector, int nbestListSize) {
+        return translate(sentences, contextVector, null, nbestListSize, 0L);
+    }
+
+    public DecoderTranslation[] translate(Sentence[] sentences, TranslationSession session, int nbestListSize) {
+        return translate(sentences, null, session, nbestListSize, 0L);
+    }
+
+    /**
+     * Translate a batch within a time budget, see translate(Sentence, ContextVector, int, long).
+     *
+     * @param timeout time budget in milliseconds of the whole batch, 0 for none
+     */
+    public DecoderTranslation[] translate(Sentence[] sentences, ContextVector contextVector, int nbestListSize, long timeout) {
+        return translate(sentences, contextVector, null, nbestListSize, timeout);
+    }
+
+    public DecoderTranslation[] translate(Sentence[] sentences, TranslationSession session, int nbestListSize, long timeout) {
+        return translate(sentences, null, session, nbestListSize, timeout);
+    }
+
+    private DecoderTranslation[] translate(Sentence[] sentences, ContextVector contextVector, TranslationSession session, int nbest, long timeout) {
+        DecoderTranslation[] result = new DecoderTranslation[sentences.length];
+
+        int[] indexes = new int[sentences.length];
+        String[] texts = new String[sentences.length];
+        int size = 0;
+
+        for (int i = 0; i < sentences.length; i++) {
+            Word[] sourceWords = sentences[i].getWords();
+
+            if (sourceWords.length == 0) {
+                result[i] = new DecoderTranslation(new Word[0], sentences[i], null);
+            } else {
+                indexes[size] = i;
+                texts[size] = XUtils.join(sourceWords);
+                size++;
+            }
+        }
+
+        if (size == 0)
+            return result;
+
+        if (size < texts.length)
+            texts = Arrays.copyOf(texts, size);
+
+        long sessionId = session == null ? 0L : getOrComputeSession(session);
+        ContextXObject context = ContextXObject.build(contextVector);
+
+        long start = System.currentTimeMillis();
+        ByteBuffer output = outputBuffers.get();
+        int outputSize;
+        try {
+            outputSize = this.translateBatch(texts, context == null ? null : context.keys, context == null ? null : context.values, sessionId, nbest, timeout, output);
+        } catch (SessionNotFoundException e) {
+            sessionId = reopenSession(session, sessionId);
+            outputSize = this.translateBatch(texts, context == null ? null : context.keys, context == null ? null : context.values, sessionId, nbest, timeout, output);
+        }
+        output = getOutput(output, outputSize);
+        long elapsed = System.currentTimeMillis() - start;
+
+        int count = output.getInt();
+        for (int i = 0; i < count; i++) {
+            Sentence sentence = sentences[indexes[i]];
+            result[indexes[i]] = TranslationXObject.read(output, sentence, scoreLayout);
+        }
+
+        logger.info("Translation of batch with " + size + " sentences took " + (((double) elapsed) / 1000.) + "s");
+
+        return result;
+    }
+
+    private native int translateBatch(String[] texts, int[] contextKeys, float[] contextValues, long session, int nbest, long timeout, ByteBuffer output);
 
     // DataListenerProvider
 
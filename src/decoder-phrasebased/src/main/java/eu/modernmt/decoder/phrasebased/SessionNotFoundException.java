@@ -0,0 +1,13 @@
+package eu.modernmt.decoder.phrasebased;
+
+/**
+ * Thrown by the native decoder when a translation refers to a session it does not know:
+ * the session was closed, or it expired after the "session-timeout" idle time.
+ */
+public class SessionNotFoundException extends RuntimeException {
+
+    public SessionNotFoundException(String message) {
+        super(message);
+    }
+
+}
@@ -2,9 +2,11 @@ package eu.modernmt.decoder.phrasebased;
 
 import eu.modernmt.decoder.DecoderTranslation;
 import eu.modernmt.decoder.TranslationHypothesis;
+import eu.modernmt.model.Alignment;
 import eu.modernmt.model.Sentence;
 import eu.modernmt.model.Word;
 
+import java.nio.ByteBuffer;
 import java.util.ArrayList;
 import java.util.Arrays;
 import java.util.HashMap;
@@ -12,69 +14,84 @@ import java.util.List;
 
 /**
  * Created by davide on 02/12/15.
+ * <p>
+ * Decoder for the binary translation output written by the native translate() methods
+ * (see eu_modernmt_decoder_phrasebased_MosesDecoder.cpp for the layout).
  */
 class TranslationXObject {
 
-    static class Hypothesis {
-        public String text;
-        public float totalScore;
-        public String fvals;
+    /**
+     * Labels of the n-best feature scores: the native decoder only sends the score values, listing the
+     * tuneable components of every tuneable feature in the order of MosesDecoder.getFeatures().
+     */
+    static class ScoreLayout {
 
-        public Hypothesis(String text, float totalScore, String fvals) {
-            this.text = text;
-            this.totalScore = totalScore;
-            this.fvals = fvals;
-        }
+        private final String[] names;
+        private final int[] sizes;
 
-        public TranslationHypothesis getTranslationHypothesis(Sentence source) {
-            HashMap<String, float[]> scores = new HashMap<>();
+        public ScoreLayout(MosesDecoder decoder) {
+            ArrayList<String> names = new ArrayList<>();
+            ArrayList<Integer> sizes = new ArrayList<>();
 
-            String[] tokens = fvals.trim().split("\\s+");
+            for (MosesFeature feature : decoder.getFeatures()) {
+                if (!feature.isTunable())
+                    continue;
 
-            String feature = null;
-            float[] weights = new float[tokens.length];
-            int index = 0;
+                int size = 0;
+                for (float weight : decoder.getFeatureWeights(feature)) {
+                    if (weight != MosesFeature.UNTUNEABLE_COMPONENT)
+                        size++;
+                }
 
-            for (int i = 0; i < tokens.length + 1; i++) {
-                String token = i < tokens.length ? tokens[i] : null;
+                if (size > 0) {
+                    names.add(feature.getName());
+                    sizes.add(size);
+                }
+            }
 
-                if (token == null || token.endsWith("=")) {
-                    if (feature != null)
-                        scores.put(feature, Arrays.copyOf(weights, index));
+            this.names = names.toArray(new String[names.size()]);
+            this.sizes = new int[sizes.size()];
+            for (int i = 0; i < this.sizes.length; i++)
+                this.sizes[i] = sizes.get(i);
+        }
 
-                    if (token != null)
-                        feature = token.substring(0, token.length() - 1);
+        private HashMap<String, float[]> decode(float[] scores) {
+            HashMap<String, float[]> result = new HashMap<>(names.length);
 
-                    index = 0;
-                } else {
-                    weights[index++] = Float.parseFloat(token);
-                }
+            int offset = 0;
+            for (int i = 0; i < names.length && offset < scores.length; i++) {
+                result.put(names[i], Arrays.copyOfRange(scores, offset, offset + sizes[i]));
+                offset += sizes[i];
             }
 
-            return new TranslationHypothesis(XUtils.explode(this.text), source, null, this.totalScore, scores);
+            return result;
         }
     }
 
-    public String text;
-    public Hypothesis[] nbestList;
-    public int[] alignment;
+    public static DecoderTranslation read(ByteBuffer buffer, Sentence source, ScoreLayout layout) {
+        long elapsedTime = buffer.getLong();
+        int degradation = buffer.getInt();
+        Word[] words = readWords(buffer);
+        Alignment alignment = readAlignment(buffer);
 
-    public TranslationXObject(String text, Hypothesis[] nbestList, int[] alignment) {
-        this.text = text;
-        this.nbestList = nbestList;
-        this.alignment = alignment;
-    }
+        DecoderTranslation translation = new DecoderTranslation(words, source, alignment);
+        translation.setElapsedTime(elapsedTime);
+        translation.setDegradation(degradation);
 
-    public DecoderTranslation getTranslation(Sentence source) {
-        Word[] words = XUtils.explode(text);
+        int nbestSize = buffer.getInt();
+        if (nbestSize > 0) {
+            List<TranslationHypothesis> nbest = new ArrayList<>(nbestSize);
 
-        DecoderTranslation translation = new DecoderTranslation(words, source, XUtils.decode(alignment));
+            for (int i = 0; i < nbestSize; i++) {
+                float totalScore = buffer.getFloat();
+                Word[] hypothesis = readWords(buffer);
 
-        if (nbestList != null && nbestList.length > 0) {
-            List<TranslationHypothesis> nbest = new ArrayList<>(nbestList.length);
+                float[] scores = new float[buffer.getInt()];
+                buffer.asFloatBuffer().get(scores);
+                buffer.position(buffer.position() + scores.length * 4);
 
-            for (Hypothesis hyp : nbestList)
-                nbest.add(hyp.getTranslationHypothesis(source));
+                nbest.add(new TranslationHypothesis(hypothesis, source, null, totalScore, layout.decode(scores)));
+            }
 
             translation.setNbest(nbest);
         }
@@ -82,4 +99,31 @@ class TranslationXObject {
         return translation;
     }
 
+    private static Word[] readWords(ByteBuffer buffer) {
+        Word[] words = new Word[buffer.getInt()];
+
+        for (int i = 0; i < words.length; i++) {
+            String rightSpace = i < words.length - 1 ? " " : null;
+            words[i] = new Word(buffer.getInt(), rightSpace);
+        }
+
+        return words;
+    }
+
+    private static Alignment readAlignment(ByteBuffer buffer) {
+        int size = buffer.getInt();
+        if (size == 0)
+            return null;
+
+        int[] source = new int[size];
+        int[] target = new int[size];
+
+        buffer.asIntBuffer().get(source);
+        buffer.position(buffer.position() + size * 4);
+        buffer.asIntBuffer().get(target);
+        buffer.position(buffer.position() + size * 4);
+
+        return new Alignment(source, target);
+    }
+
 }
@@ -0,0 +1,149 @@
+/**
+ * FVector benchmark: times the operations of FeatureVectorTest that the decoder runs per hypothesis
+ * and per translation option (copy, +=, -=, inner product, sparse updates) on FVector, and on the
+ * previous representation (core features in a std::valarray, sparse features in an unordered_map
+ * that always exists).
+ *
+ * Usage: fvector-benchmark [<core features> [<iterations>]]
+ **/
+#include <cstdlib>
+#include <iostream>
+#include <valarray>
+#include <vector>
+#include "moses/FeatureVector.h"
+#include "moses/Timer.h"
+
+using namespace std;
+using Moses::FName;
+using Moses::FValue;
+using Moses::FVector;
+
+namespace
+{
+
+/** the previous FVector storage, with the same arithmetic */
+class ValarrayFVector
+{
+public:
+  explicit ValarrayFVector(size_t coreFeatures = 0) : m_coreFeatures(coreFeatures) {}
+
+  FValue &operator[](size_t index) {
+    return m_coreFeatures[index];
+  }
+
+  void set(const FName &name, FValue value) {
+    m_features[name] = value;
+  }
+
+  FValue get(const FName &name) const {
+    FVector::FNVmap::const_iterator fi = m_features.find(name);
+    return fi == m_features.end() ? 0 : fi->second;
+  }
+
+  ValarrayFVector &operator+=(const ValarrayFVector &rhs) {
+    if (rhs.m_coreFeatures.size() > m_coreFeatures.size()) {
+      valarray<FValue> oldValues(m_coreFeatures);
+      m_coreFeatures.resize(rhs.m_coreFeatures.size());
+      for (size_t i = 0; i < oldValues.size(); ++i)
+        m_coreFeatures[i] = oldValues[i];
+    }
+    for (FVector::FNVmap::const_iterator i = rhs.m_features.begin(); i != rhs.m_features.end(); ++i)
+      set(i->first, get(i->first) + i->second);
+    for (size_t i = 0; i < rhs.m_coreFeatures.size(); ++i)
+      m_coreFeatures[i] += rhs.m_coreFeatures[i];
+    return *this;
+  }
+
+  ValarrayFVector &operator-=(const ValarrayFVector &rhs) {
+    for (FVector::FNVmap::const_iterator i = rhs.m_features.begin(); i != rhs.m_features.end(); ++i)
+      set(i->first, get(i->first) - i->second);
+    for (size_t i = 0; i < m_coreFeatures.size() && i < rhs.m_coreFeatures.size(); ++i)
+      m_coreFeatures[i] -= rhs.m_coreFeatures[i];
+    return *this;
+  }
+
+  FValue inner_product(const ValarrayFVector &rhs) const {
+    FValue product = 0.0;
+    for (FVector::FNVmap::const_iterator i = m_features.begin(); i != m_features.end(); ++i)
+      product += i->second * rhs.get(i->first);
+    for (size_t i = 0; i < m_coreFeatures.size(); ++i)
+      product += m_coreFeatures[i] * rhs.m_coreFeatures[i];
+    return product;
+  }
+
+private:
+  FVector::FNVmap m_features;
+  valarray<FValue> m_coreFeatures;
+};
+
+/** what the search does with a translation option's scores: copy, accumulate, score, and back off */
+template<class Vector>
+double Run(const vector<Vector> &options, const Vector &weights, size_t iterations, const FName *sparse)
+{
+  Moses::Timer timer;
+  timer.start();
+
+  double total = 0;
+  for (size_t it = 0; it < iterations; ++it) {
+    const Vector &option = options[it % options.size()];
+    Vector breakdown(option);
+    breakdown += options[(it + 1) % options.size()];
+    if (sparse)
+      breakdown.set(*sparse, 1.0f);
+    total += breakdown.inner_product(weights);
+    breakdown -= option;
+    total += breakdown.inner_product(weights);
+  }
+
+  double seconds = timer.get_elapsed_time();
+  if (total == 42.0) // keep the loop
+    cerr << total << endl;
+  return seconds;
+}
+
+/** FVector writes sparse features through operator[] */
+struct SparseFVector : public FVector {
+  explicit SparseFVector(size_t coreFeatures) : FVector(coreFeatures) {}
+  void set(const FName &name, FValue value) {
+    (*this)[name] = value;
+  }
+};
+
+template<class Vector>
+void Fill(vector<Vector> &options, Vector &weights, size_t coreFeatures)
+{
+  for (size_t i = 0; i < coreFeatures; ++i)
+    weights[i] = 1.0f / (i + 1);
+
+  for (size_t o = 0; o < options.size(); ++o) {
+    for (size_t i = 0; i < coreFeatures; ++i)
+      options[o][i] = -(FValue) ((o * 31 + i * 7) % 13);
+  }
+}
+
+}
+
+int main(int argc, char const **argv)
+{
+  size_t coreFeatures = argc > 1 ? (size_t) atol(argv[1]) : 17;
+  size_t iterations = argc > 2 ? (size_t) atol(argv[2]) : 10000000;
+  const size_t numOptions = 64;
+
+  vector<ValarrayFVector> valarrayOptions(numOptions, ValarrayFVector(coreFeatures));
+  ValarrayFVector valarrayWeights(coreFeatures);
+  Fill(valarrayOptions, valarrayWeights, coreFeatures);
+
+  vector<SparseFVector> options(numOptions, SparseFVector(coreFeatures));
+  SparseFVector weights(coreFeatures);
+  Fill(options, weights, coreFeatures);
+
+  FName sparse("Benchmark_sparse");
+
+  cout << "representation\tcore_features\tsparse\titerations\tseconds" << endl;
+  cout << "valarray\t" << coreFeatures << "\tno\t" << iterations << "\t" << Run(valarrayOptions, valarrayWeights, iterations, NULL) << endl;
+  cout << "fvector\t" << coreFeatures << "\tno\t" << iterations << "\t" << Run(options, weights, iterations, NULL) << endl;
+  cout << "valarray\t" << coreFeatures << "\tyes\t" << iterations << "\t" << Run(valarrayOptions, valarrayWeights, iterations, &sparse) << endl;
+  cout << "fvector\t" << coreFeatures << "\tyes\t" << iterations << "\t" << Run(options, weights, iterations, &sparse) << endl;
+
+  return 0;
+}
@@ -0,0 +1,78 @@
+/**
+ * Search benchmark: decodes the sentences read from stdin (space separated word ids, one per line)
+ * once for every stack size given on the command line, and reports the average search time.
+ *
+ * Usage: search-benchmark <moses.ini> <stack size> [<stack size> ...]
+ **/
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include "moses/Parameter.h"
+#include "moses/StaticData.h"
+#include "moses/ContextScope.h"
+#include "moses/Sentence.h"
+#include "moses/TranslationTask.h"
+#include "moses/Manager.h"
+#include "moses/IOWrapper.h"
+#include "moses/Timer.h"
+
+using namespace std;
+
+int main(int argc, char const **argv)
+{
+  if (argc < 3) {
+    cerr << "Usage: " << argv[0] << " <moses.ini> <stack size> [<stack size> ...]" << endl;
+    return 1;
+  }
+
+  const char *params_argv[2] = {"-f", argv[1]};
+  Moses::Parameter params;
+  if (!params.LoadParam(2, params_argv) || !Moses::StaticData::LoadDataStatic(&params, argv[0]))
+    return 1;
+
+  vector<string> sentences;
+  for (string line; getline(cin, line);)
+    if (!line.empty())
+      sentences.push_back(line);
+
+  if (sentences.empty()) {
+    cerr << "No input sentences" << endl;
+    return 1;
+  }
+
+  Moses::AllOptions::ptr const &defaults = Moses::StaticData::Instance().options();
+  boost::shared_ptr<Moses::IOWrapper> ioWrapperNone;
+
+  cout << "stack_size\tsentences\tavg_ms\ttotal_s" << endl;
+
+  for (int i = 2; i < argc; ++i) {
+    boost::shared_ptr<Moses::AllOptions> opts(new Moses::AllOptions(*defaults));
+    opts->search.stack_size = (size_t) atol(argv[i]);
+
+    // each run starts from fresh scopes, so that model caches do not favour later runs
+    boost::shared_ptr<Moses::ContextScope> scope(
+      new Moses::ContextScope(Moses::StaticData::Instance().GetAllWeightsSnapshot()));
+
+    double total = 0;
+
+    for (size_t s = 0; s < sentences.size(); ++s) {
+      boost::shared_ptr<Moses::InputType> source(new Moses::Sentence(opts, s, sentences[s]));
+      boost::shared_ptr<Moses::TranslationTask> ttask = Moses::TranslationTask::create(source, ioWrapperNone, scope);
+
+      Moses::Timer timer;
+      timer.start();
+      {
+        Moses::Manager manager(ttask);
+        manager.Decode();
+      }
+      total += timer.get_elapsed_time();
+    }
+
+    cout << opts->search.stack_size << "\t" << sentences.size() << "\t"
+         << (total * 1000. / sentences.size()) << "\t" << total << endl;
+  }
+
+  return 0;
+}
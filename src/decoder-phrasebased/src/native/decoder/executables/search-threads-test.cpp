@@ -0,0 +1,94 @@
+/**
+ * Search threads test: decodes the sentences read from stdin (space separated word ids, one per line)
+ * with a serial search and with the given number of search threads, and fails if any best translation
+ * or its score differs. Parallel stack expansion is meant to give exactly the serial results.
+ *
+ * Usage: search-threads-test <moses.ini> <search threads>
+ **/
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include "moses/Parameter.h"
+#include "moses/StaticData.h"
+#include "moses/ContextScope.h"
+#include "moses/Sentence.h"
+#include "moses/TranslationTask.h"
+#include "moses/Manager.h"
+#include "moses/Hypothesis.h"
+#include "moses/IOWrapper.h"
+
+using namespace std;
+
+struct Result {
+  string text;
+  float score;
+};
+
+static Result Translate(const string &sentence, size_t id, size_t threads,
+                        const boost::shared_ptr<Moses::ContextScope> &scope)
+{
+  boost::shared_ptr<Moses::AllOptions> opts(new Moses::AllOptions(*Moses::StaticData::Instance().options()));
+  opts->search.threads = threads;
+  opts->search.threads_min_length = 0;
+
+  boost::shared_ptr<Moses::IOWrapper> ioWrapperNone;
+  boost::shared_ptr<Moses::InputType> source(new Moses::Sentence(opts, id, sentence));
+  boost::shared_ptr<Moses::TranslationTask> ttask = Moses::TranslationTask::create(source, ioWrapperNone, scope);
+
+  Result result;
+  Moses::Manager manager(ttask);
+  manager.Decode();
+
+  const Moses::Hypothesis *best = manager.GetBestHypothesis();
+  result.text = best ? best->GetTargetPhraseStringRep() : "";
+  result.score = best ? best->GetFutureScore() : 0;
+  return result;
+}
+
+int main(int argc, char const **argv)
+{
+  if (argc != 3) {
+    cerr << "Usage: " << argv[0] << " <moses.ini> <search threads>" << endl;
+    return 1;
+  }
+
+  const char *params_argv[2] = {"-f", argv[1]};
+  Moses::Parameter params;
+  if (!params.LoadParam(2, params_argv) || !Moses::StaticData::LoadDataStatic(&params, argv[0]))
+    return 1;
+
+  size_t threads = (size_t) atol(argv[2]);
+
+  vector<string> sentences;
+  for (string line; getline(cin, line);)
+    if (!line.empty())
+      sentences.push_back(line);
+
+  if (sentences.empty()) {
+    cerr << "No input sentences" << endl;
+    return 1;
+  }
+
+  boost::shared_ptr<Moses::ContextScope> scope(
+    new Moses::ContextScope(Moses::StaticData::Instance().GetAllWeightsSnapshot()));
+
+  size_t failures = 0;
+  for (size_t s = 0; s < sentences.size(); ++s) {
+    Result serial = Translate(sentences[s], s, 1, scope);
+    Result parallel = Translate(sentences[s], s, threads, scope);
+
+    if (serial.text != parallel.text || serial.score != parallel.score) {
+      cerr << "Sentence " << s << " differs:" << endl
+           << "  1 thread:  " << serial.score << "\t" << serial.text << endl
+           << "  " << threads << " threads: " << parallel.score << "\t" << parallel.text << endl;
+      failures++;
+    }
+  }
+
+  cout << (sentences.size() - failures) << "/" << sentences.size() << " sentences identical with "
+       << threads << " search threads" << endl;
+
+  return failures == 0 ? 0 : 2;
+}
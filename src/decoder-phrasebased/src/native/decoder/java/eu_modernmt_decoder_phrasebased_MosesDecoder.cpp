@@ -5,29 +5,115 @@
 #include "../javah/eu_modernmt_decoder_phrasebased_MosesDecoder.h"
 #include "../moses/MosesDecoder.h"
 #include <stdlib.h>
+#include <cstring>
 #include "JMosesFeature.h"
-#include "JTranslation.h"
 #include <mmt/jniutil.h>
 
 using namespace std;
 using namespace mmt;
 using namespace mmt::decoder;
 
-void ParseContext(JNIEnv *jvm, jintArray keys, jfloatArray values, map<string, float> &outContext) {
-    int size = jvm->GetArrayLength(values);
+void ParseContext(JNIEnv *jvm, jintArray keys, jfloatArray values, context_t &outContext) {
+    // thread-local scratch buffers, reused across requests served by the same JNI thread
+    static thread_local vector<jint> keysBuffer;
+    static thread_local vector<jfloat> valuesBuffer;
 
-    jint *keysArray = jvm->GetIntArrayElements(keys, 0);
-    jfloat *valuesArray = jvm->GetFloatArrayElements(values, 0);
+    jsize size = jvm->GetArrayLength(values);
 
-    for (int i = 0; i < size; i++) {
-        string key = std::to_string((uint32_t) keysArray[i]);
-        float value = valuesArray[i];
+    keysBuffer.resize((size_t) size);
+    valuesBuffer.resize((size_t) size);
+
+    jvm->GetIntArrayRegion(keys, 0, size, keysBuffer.data());
+    jvm->GetFloatArrayRegion(values, 0, size, valuesBuffer.data());
+
+    outContext.reserve((size_t) size);
+    for (jsize i = 0; i < size; i++)
+        outContext.push_back(cscore_t((domain_t) keysBuffer[i], valuesBuffer[i]));
+}
+
+static void ThrowSessionNotFound(JNIEnv *jvm, const SessionNotFoundException &e) {
+    jclass exceptionClass = jvm->FindClass("eu/modernmt/decoder/phrasebased/SessionNotFoundException");
+    jvm->ThrowNew(exceptionClass, e.what());
+}
+
+/*
+ * Binary translation output, in native byte order:
+ *
+ *   translation := int64 elapsed, int32 degradation, words, int32 alignmentSize, int32 source[alignmentSize],
+ *                  int32 target[alignmentSize], int32 hypothesisCount, hypothesis[hypothesisCount]
+ *   hypothesis  := float totalScore, words, int32 scoreCount, float scores[scoreCount]
+ *   words       := int32 length, int32 ids[length]
+ *
+ * Batch output is an int32 translation count followed by the translations.
+ */
+
+template<typename T>
+static inline void Append(vector<char> &buffer, T value) {
+    const char *bytes = (const char *) &value;
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+static void AppendWords(vector<char> &buffer, const string &text) {
+    // the target text is made of decimal word ids separated by spaces
+    size_t lengthOffset = buffer.size();
+    Append<jint>(buffer, 0);
+
+    jint length = 0;
+    const char *ptr = text.c_str();
+    char *end;
 
-        outContext[key] = value;
+    while (true) {
+        unsigned long id = strtoul(ptr, &end, 10);
+        if (end == ptr)
+            break;
+
+        Append<jint>(buffer, (jint) id);
+        length++;
+        ptr = end;
     }
 
-    jvm->ReleaseIntArrayElements(keys, keysArray, 0);
-    jvm->ReleaseFloatArrayElements(values, valuesArray, 0);
+    memcpy(buffer.data() + lengthOffset, &length, sizeof(jint));
+}
+
+static void AppendTranslation(vector<char> &buffer, const translation_t &translation) {
+    Append<jlong>(buffer, (jlong) translation.elapsed);
+    Append<jint>(buffer, (jint) translation.degradation);
+    AppendWords(buffer, translation.text);
+
+    const vector<pair<size_t, size_t>> &alignment = translation.alignment;
+    Append<jint>(buffer, (jint) alignment.size());
+    for (auto a = alignment.begin(); a != alignment.end(); ++a)
+        Append<jint>(buffer, (jint) a->first);
+    for (auto a = alignment.begin(); a != alignment.end(); ++a)
+        Append<jint>(buffer, (jint) a->second);
+
+    const vector<hypothesis_t> &hypotheses = translation.hypotheses;
+    Append<jint>(buffer, (jint) hypotheses.size());
+    for (auto hypothesis = hypotheses.begin(); hypothesis != hypotheses.end(); ++hypothesis) {
+        Append<jfloat>(buffer, (jfloat) hypothesis->score);
+        AppendWords(buffer, hypothesis->text);
+
+        Append<jint>(buffer, (jint) hypothesis->scores.size());
+        for (auto score = hypothesis->scores.begin(); score != hypothesis->scores.end(); ++score)
+            Append<jfloat>(buffer, (jfloat) *score);
+    }
+}
+
+// Output that did not fit in the caller buffer, kept until readPendingOutput() is called by the same thread
+static thread_local vector<char> pendingOutput;
+
+static jint WriteOutput(JNIEnv *jvm, jobject output, vector<char> &data) {
+    jlong capacity = jvm->GetDirectBufferCapacity(output);
+
+    if (capacity < (jlong) data.size()) {
+        pendingOutput.swap(data);
+        return -((jint) pendingOutput.size());
+    }
+
+    char *address = (char *) jvm->GetDirectBufferAddress(output);
+    memcpy(address, data.data(), data.size());
+
+    return (jint) data.size();
 }
 
 /*
@@ -137,7 +223,7 @@ Java_eu_modernmt_decoder_phrasebased_MosesDecoder_createSession(JNIEnv *jvm, job
                                                           jfloatArray contextValues) {
     MosesDecoder *instance = jni_gethandle<MosesDecoder>(jvm, jself);
 
-    map<string, float> context;
+    context_t context;
     ParseContext(jvm, contextKeys, contextValues, context);
 
     return (jlong) instance->openSession(context);
@@ -153,52 +239,117 @@ JNIEXPORT void JNICALL Java_eu_modernmt_decoder_phrasebased_MosesDecoder_destroy
     jni_gethandle<MosesDecoder>(jvm, self)->closeSession((uint64_t) session);
 }
 
+/*
+ * Class:     eu_modernmt_decoder_moses_MosesDecoder
+ * Method:    getActiveSessionsCount
+ * Signature: ()J
+ */
+JNIEXPORT jlong JNICALL Java_eu_modernmt_decoder_phrasebased_MosesDecoder_getActiveSessionsCount(JNIEnv *jvm, jobject self) {
+    return (jlong) jni_gethandle<MosesDecoder>(jvm, self)->getActiveSessionsCount();
+}
+
+/*
+ * Class:     eu_modernmt_decoder_moses_MosesDecoder
+ * Method:    getSessionsMemoryUsage
+ * Signature: ()J
+ */
+JNIEXPORT jlong JNICALL Java_eu_modernmt_decoder_phrasebased_MosesDecoder_getSessionsMemoryUsage(JNIEnv *jvm, jobject self) {
+    return (jlong) jni_gethandle<MosesDecoder>(jvm, self)->getSessionsMemoryUsage();
+}
+
 /*
  * Class:     eu_modernmt_decoder_moses_MosesDecoder
  * Method:    translate
- * Signature: (Ljava/lang/String;[I[FJI)Leu/modernmt/decoder/moses/TranslationXObject;
+ * Signature: (Ljava/lang/String;[I[FJIJLjava/nio/ByteBuffer;)I
  */
-JNIEXPORT jobject JNICALL
+JNIEXPORT jint JNICALL
 Java_eu_modernmt_decoder_phrasebased_MosesDecoder_translate(JNIEnv *jvm, jobject jself, jstring text, jintArray contextKeys,
-                                                      jfloatArray contextValues, jlong session, jint nbest) {
+                                                      jfloatArray contextValues, jlong session, jint nbest,
+                                                      jlong timeout, jobject output) {
     MosesDecoder *instance = jni_gethandle<MosesDecoder>(jvm, jself);
     string sentence = jni_jstrtostr(jvm, text);
 
     translation_t translation;
-    if (contextKeys != NULL) {
-        map<string, float> context;
-        ParseContext(jvm, contextKeys, contextValues, context);
-
-        translation = instance->translate(sentence, (uint64_t) session, &context, (size_t) nbest);
-    } else {
-        translation = instance->translate(sentence, (uint64_t) session, NULL, (size_t) nbest);
+    try {
+        if (contextKeys != NULL) {
+            context_t context;
+            ParseContext(jvm, contextKeys, contextValues, context);
+
+            translation = instance->translate(sentence, (uint64_t) session, &context, (size_t) nbest, (int64_t) timeout);
+        } else {
+            translation = instance->translate(sentence, (uint64_t) session, NULL, (size_t) nbest, (int64_t) timeout);
+        }
+    } catch (const SessionNotFoundException &e) {
+        ThrowSessionNotFound(jvm, e);
+        return 0;
     }
 
-    jobjectArray hypothesesArray = NULL;
-    vector<hypothesis_t> hypotheses = translation.hypotheses;
+    static thread_local vector<char> buffer;
+    buffer.clear();
+
+    AppendTranslation(buffer, translation);
+
+    return WriteOutput(jvm, output, buffer);
+}
+
+/*
+ * Class:     eu_modernmt_decoder_moses_MosesDecoder
+ * Method:    translateBatch
+ * Signature: ([Ljava/lang/String;[I[FJIJLjava/nio/ByteBuffer;)I
+ */
+JNIEXPORT jint JNICALL
+Java_eu_modernmt_decoder_phrasebased_MosesDecoder_translateBatch(JNIEnv *jvm, jobject jself, jobjectArray texts,
+                                                                 jintArray contextKeys, jfloatArray contextValues,
+                                                                 jlong session, jint nbest, jlong timeout,
+                                                                 jobject output) {
+    MosesDecoder *instance = jni_gethandle<MosesDecoder>(jvm, jself);
+
+    jsize size = jvm->GetArrayLength(texts);
+    vector<string> sentences;
+    sentences.reserve((size_t) size);
 
-    if (hypotheses.size() > 0) {
-        JHypothesis Hypothesis(jvm);
-        hypothesesArray = jvm->NewObjectArray((jsize) hypotheses.size(), Hypothesis._class, nullptr);
+    for (jsize i = 0; i < size; ++i) {
+        jstring jtext = (jstring) jvm->GetObjectArrayElement(texts, i);
+        sentences.push_back(jni_jstrtostr(jvm, jtext));
+        jvm->DeleteLocalRef(jtext);
+    }
 
-        for (size_t i = 0; i < hypotheses.size(); ++i) {
-            hypothesis_t hypothesis = hypotheses[i];
-            jobject jhypothesis = Hypothesis.create(jvm, hypothesis.text, hypothesis.score, hypothesis.fvals);
-            jvm->SetObjectArrayElement(hypothesesArray, (jsize) i, jhypothesis);
-            jvm->DeleteLocalRef(jhypothesis);
+    vector<translation_t> translations;
+    try {
+        if (contextKeys != NULL) {
+            context_t context;
+            ParseContext(jvm, contextKeys, contextValues, context);
+
+            translations = instance->translate(sentences, (uint64_t) session, &context, (size_t) nbest, (int64_t) timeout);
+        } else {
+            translations = instance->translate(sentences, (uint64_t) session, NULL, (size_t) nbest, (int64_t) timeout);
         }
+    } catch (const SessionNotFoundException &e) {
+        ThrowSessionNotFound(jvm, e);
+        return 0;
     }
 
-    JTranslation Translation(jvm);
+    static thread_local vector<char> buffer;
+    buffer.clear();
+
+    Append<jint>(buffer, (jint) translations.size());
+    for (auto translation = translations.begin(); translation != translations.end(); ++translation)
+        AppendTranslation(buffer, *translation);
 
-    jintArray jAlignment = Translation.getAlignment(jvm, translation.alignment);
-    jobject jtranslation = Translation.create(jvm, translation.text, hypothesesArray, jAlignment);
+    return WriteOutput(jvm, output, buffer);
+}
 
-    jvm->DeleteLocalRef(jAlignment);
-    if (hypothesesArray)
-        jvm->DeleteLocalRef(hypothesesArray);
+/*
+ * Class:     eu_modernmt_decoder_moses_MosesDecoder
+ * Method:    readPendingOutput
+ * Signature: (Ljava/nio/ByteBuffer;)I
+ */
+JNIEXPORT jint JNICALL
+Java_eu_modernmt_decoder_phrasebased_MosesDecoder_readPendingOutput(JNIEnv *jvm, jobject jself, jobject output) {
+    vector<char> data;
+    data.swap(pendingOutput);
 
-    return jtranslation;
+    return WriteOutput(jvm, output, data);
 }
 
 /*
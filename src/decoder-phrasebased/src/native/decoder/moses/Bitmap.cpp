@@ -29,6 +29,7 @@ TO_STRING_BODY(Bitmap);
 
 Bitmap::Bitmap(size_t size, const std::vector<bool>& initializer)
   :m_bitmap(initializer.begin(), initializer.end())
+  ,m_estimatedScore(0.0f)
 {
 
   // The initializer may not be of the same length.  Change to the desired
@@ -50,7 +51,7 @@ Bitmap::Bitmap(size_t size)
   :m_bitmap(size, false)
   ,m_firstGap(0)
   ,m_numWordsCovered(0)
-
+  ,m_estimatedScore(0.0f)
 {
 }
 
@@ -59,6 +60,7 @@ Bitmap::Bitmap(const Bitmap &copy)
   :m_bitmap(copy.m_bitmap)
   ,m_firstGap(copy.m_firstGap)
   ,m_numWordsCovered(copy.m_numWordsCovered)
+  ,m_estimatedScore(copy.m_estimatedScore)
 {
 }
 
@@ -66,6 +68,7 @@ Bitmap::Bitmap(const Bitmap &copy, const Range &range)
   :m_bitmap(copy.m_bitmap)
   ,m_firstGap(copy.m_firstGap)
   ,m_numWordsCovered(copy.m_numWordsCovered)
+  ,m_estimatedScore(0.0f)
 {
   SetValueNonOverlap(range);
 }
@@ -54,6 +54,7 @@ private:
   std::vector<char> m_bitmap; //! Ticks of words in sentence that have been done.
   size_t m_firstGap; //! Cached position of first gap, or NOT_FOUND.
   size_t m_numWordsCovered;
+  float m_estimatedScore; //! Future cost of the gaps, set by Bitmaps when interning.
 
   Bitmap(); // not implemented
   Bitmap& operator= (const Bitmap& other);
@@ -111,6 +112,14 @@ public:
     return m_numWordsCovered;
   }
 
+  //! estimated future score of the words not yet translated, see SquareMatrix::CalcEstimatedScore()
+  float GetEstimatedScore() const {
+    return m_estimatedScore;
+  }
+  void SetEstimatedScore(float score) {
+    m_estimatedScore = score;
+  }
+
   //! position of 1st word not yet translated, or NOT_FOUND if everything already translated
   size_t GetFirstGapPos() const {
     return m_firstGap;
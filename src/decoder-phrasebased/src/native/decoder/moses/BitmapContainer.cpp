@@ -213,9 +213,8 @@ BackwardsEdge::Initialize()
     return;
   }
 
-  const Bitmap &bm = m_hypotheses[0]->GetWordsBitmap();
-  const Range &newRange = m_translations.Get(0)->GetSourceWordsRange();
-  m_estimatedScore = m_estimatedScores.CalcEstimatedScore(bm, newRange.GetStartPos(), newRange.GetEndPos());
+  // all the hypotheses created by this edge cover the bitmap of the parent
+  m_estimatedScore = m_parent.GetWordsBitmap().GetEstimatedScore();
 
   Hypothesis *expanded = CreateHypothesis(*m_hypotheses[0], *m_translations.Get(0));
   m_parent.Enqueue(0, 0, expanded, this);
@@ -230,7 +229,8 @@ Hypothesis *BackwardsEdge::CreateHypothesis(const Hypothesis &hypothesis, const
     hypothesis.GetManager().GetSentenceStats().StartTimeBuildHyp();
   }
   const Bitmap &bitmap = m_parent.GetWordsBitmap();
-  Hypothesis *newHypo = new Hypothesis(hypothesis, transOpt, bitmap, hypothesis.GetManager().GetNextHypoId());
+  Manager &manager = hypothesis.GetManager();
+  Hypothesis *newHypo = new (manager.GetHypothesisPool()) Hypothesis(hypothesis, transOpt, bitmap, manager.GetNextHypoId());
   IFVERBOSE(2) {
     hypothesis.GetManager().GetSentenceStats().StopTimeBuildHyp();
   }
@@ -1,5 +1,6 @@
 #include <boost/foreach.hpp>
 #include "Bitmaps.h"
+#include "SquareMatrix.h"
 #include "Util.h"
 
 using namespace std;
@@ -7,6 +8,7 @@ using namespace std;
 namespace Moses
 {
 Bitmaps::Bitmaps(size_t inputSize, const std::vector<bool> &initSourceCompleted)
+  : m_estimatedScores(NULL)
 {
   m_initBitmap = new Bitmap(inputSize, initSourceCompleted);
   m_coll[m_initBitmap];
@@ -26,6 +28,8 @@ const Bitmap &Bitmaps::GetNextBitmap(const Bitmap &bm, const Range &range)
 
   Coll::const_iterator iter = m_coll.find(newBM);
   if (iter == m_coll.end()) {
+    if (m_estimatedScores)
+      newBM->SetEstimatedScore(m_estimatedScores->CalcEstimatedScore(*newBM));
     m_coll[newBM] = NextBitmaps();
     return *newBM;
   } else {
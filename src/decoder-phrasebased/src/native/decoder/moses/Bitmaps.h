@@ -8,6 +8,7 @@
 
 namespace Moses
 {
+class SquareMatrix;
 
 class Bitmaps
 {
@@ -16,6 +17,7 @@ class Bitmaps
   //typedef std::set<const Bitmap*, OrderedComparer<Bitmap> > Coll;
   Coll m_coll;
   const Bitmap *m_initBitmap;
+  const SquareMatrix *m_estimatedScores;
 
   const Bitmap &GetNextBitmap(const Bitmap &bm, const Range &range);
 public:
@@ -27,6 +29,12 @@ public:
   }
   const Bitmap &GetBitmap(const Bitmap &bm, const Range &range);
 
+  //! future costs used to score every new bitmap once, when it is interned.
+  //! Like the initial hypothesis, the initial bitmap is not scored.
+  void SetEstimatedScores(const SquareMatrix *estimatedScores) {
+    m_estimatedScores = estimatedScores;
+  }
+
 };
 
 }
@@ -17,7 +17,9 @@
 #include "xmlrpc-c.h"
 
 #include <map>
+#include <cstdlib>
 #include <boost/shared_ptr.hpp>
+#include <mmt/sentence.h>
 #include "TypeDef.h"
 #include "Util.h"
 
@@ -40,9 +42,10 @@ protected:
   mutable boost::shared_mutex m_lock;
 #endif
   SPTR< std::map<std::string,float> const> m_context_weights;
+  SPTR< mmt::context_t const> m_context;
   SPTR< std::map<std::string,float> const> m_lm_interpolation_weights;
   SPTR< std::map<std::string, std::vector<float> > const> m_feature_weights;
-  ScoreComponentCollection m_feature_weights_scc;
+  SPTR<ScoreComponentCollection const> m_feature_weights_scc;
 public:
   typedef boost::shared_ptr<ContextScope> ptr;
   template<typename T>
@@ -83,13 +86,18 @@ public:
     return ret;
   }
 
-  ContextScope(const ScoreComponentCollection& featureWeights) {
-    m_feature_weights_scc = featureWeights;
+  ContextScope(const ScoreComponentCollection& featureWeights)
+    : m_feature_weights_scc(new ScoreComponentCollection(featureWeights)) {
+  }
+
+  // pins an immutable weights snapshot (see StaticData::GetAllWeightsSnapshot()) without copying it
+  ContextScope(SPTR<ScoreComponentCollection const> const& featureWeights)
+    : m_feature_weights_scc(featureWeights) {
   }
 
   ContextScope() {
     // this constructor should not be used anymore within MMT.
-    m_feature_weights_scc = StaticData::Instance().GetAllWeights();
+    m_feature_weights_scc.reset(new ScoreComponentCollection(StaticData::Instance().GetAllWeights()));
   }
 
   ContextScope(ContextScope const& other) {
@@ -98,6 +106,7 @@ public:
     boost::unique_lock<boost::shared_mutex> lock2(other.m_lock);
 #endif
     m_scratchpad = other.m_scratchpad;
+    m_feature_weights_scc = other.m_feature_weights_scc;
   }
 
   SPTR<std::map<std::string,float> const> const&
@@ -105,6 +114,12 @@ public:
     return m_context_weights;
   }
   
+  // typed view of the context weights (domain id, score), as consumed by the MMT models
+  SPTR<mmt::context_t const> const&
+  GetContext() const {
+    return m_context;
+  }
+
   SPTR<std::map<std::string,float> const> const&
   GetLmInterpolationWeights() {
     return m_lm_interpolation_weights;
@@ -123,6 +138,35 @@ public:
    return M;
  }
 
+  // copies context (or nothing) into a model's thread-local context buffer; the buffer
+  // is created on first use and reused across sentences to avoid per-request allocations
+  template<typename ThreadLocalPtr>
+  static void
+  AssignThreadContext(ThreadLocalPtr &buffer, mmt::context_t const* context) {
+    mmt::context_t* vec = buffer.get();
+    if (vec == NULL) {
+      vec = new mmt::context_t;
+      buffer.reset(vec);
+    }
+
+    if (context)
+      vec->assign(context->begin(), context->end());
+    else
+      vec->clear();
+  }
+
+  static mmt::context_t*
+  CreateContext(std::map<std::string,float> const& weights) {
+    mmt::context_t* context = new mmt::context_t;
+    context->reserve(weights.size());
+
+    for (std::map<std::string,float>::const_iterator it = weights.begin();
+         it != weights.end(); ++it) {
+      context->push_back(mmt::cscore_t((mmt::domain_t) strtoul(it->first.c_str(), NULL, 10), it->second));
+    }
+    return context;
+  }
+
   bool
   SetContextWeights(std::string const& spec) {
     if (m_context_weights) return false;
@@ -134,6 +178,7 @@ public:
     // may have changed while we waited for the lock
     if (m_context_weights) return false;
     m_context_weights.reset(CreateWeightMap(spec));
+    if (!m_context) m_context.reset(CreateContext(*m_context_weights));
     return true;
   }
 
@@ -160,6 +205,21 @@ public:
     // may have changed while we waited for the lock
     if (m_context_weights) return false;
     m_context_weights = w;
+    if (!m_context) m_context.reset(CreateContext(*m_context_weights));
+    return true;
+  }
+
+  bool
+  SetContext(SPTR<mmt::context_t const> const& context) {
+    if (m_context) return false;
+    // You can set the context only once during the lifetime of a
+    // ContextScope object!
+#ifdef WITH_THREADS
+    boost::unique_lock<boost::shared_mutex> lock(m_lock);
+#endif
+    // may have changed while we waited for the lock
+    if (m_context) return false;
+    m_context = context;
     return true;
   }
 
@@ -185,12 +245,16 @@ public:
     if (m_feature_weights) return false;
     m_feature_weights = w;
 
-    m_feature_weights_scc = ScoreComponentCollection::FromWeightMap(*m_feature_weights);
+    m_feature_weights_scc.reset(new ScoreComponentCollection(ScoreComponentCollection::FromWeightMap(*m_feature_weights)));
 
     return true;
   }
 
   const ScoreComponentCollection& GetFeatureWeights() const {
+    return *m_feature_weights_scc;
+  }
+
+  SPTR<ScoreComponentCollection const> GetFeatureWeightsPtr() const {
     return m_feature_weights_scc;
   }
 };
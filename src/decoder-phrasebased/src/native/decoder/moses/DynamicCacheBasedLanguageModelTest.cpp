@@ -0,0 +1,95 @@
+#include <boost/test/unit_test.hpp>
+
+#include "FF/StatelessFeatureFunction.h"
+#include "FF/DynamicCacheBasedLanguageModel.h"
+#include "ContextScope.h"
+#include "TargetPhrase.h"
+#include "TranslationTask.h"
+#include "Util.h"
+
+using namespace Moses;
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(cblm)
+
+//! features stay registered for the whole process, like the ones loaded from moses.ini
+static DynamicCacheBasedLanguageModel &GetCacheModel()
+{
+  static DynamicCacheBasedLanguageModel *cblm = NULL;
+  if (cblm == NULL) {
+    cblm = new DynamicCacheBasedLanguageModel("DynamicCacheBasedLanguageModel name=CBLMTest cblm-name=test");
+    FeatureFunction::Register(cblm);
+  }
+  return *cblm;
+}
+
+struct CacheModelFixture {
+  CacheModelFixture() : cblm(GetCacheModel()) {
+    cblm.Clear();
+    SPTR<ContextScope> scope(new ContextScope(ScoreComponentCollection()));
+    ttask = TranslationTask::create(SPTR<InputType>(), SPTR<IOWrapper>(), scope);
+  }
+
+  float Score(const string &target, size_t queryType) {
+    TargetPhrase tp(ttask);
+    tp.CreateFromString(Output, vector<FactorType>(1, 0), target, NULL);
+
+    cblm.SetQueryType(queryType);
+    ScoreComponentCollection scores, estimatedScores;
+    cblm.EvaluateInIsolation(Phrase(), tp, scores, estimatedScores);
+    return scores.GetScoreForProducer(&cblm);
+  }
+
+  DynamicCacheBasedLanguageModel &cblm;
+  ttasksptr ttask;
+};
+
+BOOST_FIXTURE_TEST_CASE(whole_string_matches_long_ngrams, CacheModelFixture)
+{
+  float lower = Score("x y z", CBLM_QUERY_TYPE_WHOLESTRING);
+
+  string entries = "x y z || y z w x";
+  cblm.Insert(entries);
+
+  BOOST_CHECK(Score("x y z", CBLM_QUERY_TYPE_WHOLESTRING) != lower);
+  BOOST_CHECK_EQUAL(Score("y z w x", CBLM_QUERY_TYPE_WHOLESTRING), Score("x y z", CBLM_QUERY_TYPE_WHOLESTRING));
+  BOOST_CHECK_EQUAL(Score("x y", CBLM_QUERY_TYPE_WHOLESTRING), lower);
+  BOOST_CHECK_EQUAL(Score("y z w", CBLM_QUERY_TYPE_WHOLESTRING), lower);
+}
+
+BOOST_FIXTURE_TEST_CASE(all_substrings_sums_every_ngram, CacheModelFixture)
+{
+  string entries = "x y z || y z w x || w || z w";
+  cblm.Insert(entries);
+  entries = "q";
+  cblm.Insert(entries); // the first entries are one step older
+
+  // the all-substrings score is the sum of the whole-string scores of every substring,
+  // trigrams and longer n-grams included
+  vector<string> words = Tokenize("x y z w x q");
+  float expected = 0.0f;
+  for (size_t start = 0; start < words.size(); ++start) {
+    string ngram;
+    for (size_t end = start; end < words.size(); ++end) {
+      ngram += (end > start ? " " : "") + words[end];
+      expected += Score(ngram, CBLM_QUERY_TYPE_WHOLESTRING);
+    }
+  }
+
+  BOOST_CHECK_CLOSE(Score("x y z w x q", CBLM_QUERY_TYPE_ALLSUBSTRINGS), expected, 0.001f);
+}
+
+BOOST_FIXTURE_TEST_CASE(cleared_entries_do_not_match, CacheModelFixture)
+{
+  float lower = Score("x y z", CBLM_QUERY_TYPE_WHOLESTRING);
+
+  string entries = "x y z || x y";
+  cblm.Insert(entries);
+  entries = "x y z";
+  cblm.ClearEntries(entries);
+
+  BOOST_CHECK_EQUAL(Score("x y z", CBLM_QUERY_TYPE_WHOLESTRING), lower);
+  BOOST_CHECK(Score("x y", CBLM_QUERY_TYPE_WHOLESTRING) != lower);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,6 +1,8 @@
 #include <utility>
 #include "StaticData.h"
 #include "InputFileStream.h"
+#include "FactorCollection.h"
+#include "util/murmur_hash.hh"
 #include "DynamicCacheBasedLanguageModel.h"
 
 namespace Moses
@@ -11,6 +13,7 @@ DynamicCacheBasedLanguageModel *DynamicCacheBasedLanguageModel::s_instance = NUL
 
 DynamicCacheBasedLanguageModel::DynamicCacheBasedLanguageModel(const std::string &line)
   : StatelessFeatureFunction(1, line)
+  , m_cache(new decaying_cache_t())
 {
   VERBOSE(2,"Initializing DynamicCacheBasedLanguageModel feature..." << std::endl);
 
@@ -33,7 +36,7 @@ DynamicCacheBasedLanguageModel::~DynamicCacheBasedLanguageModel() {};
 void DynamicCacheBasedLanguageModel::SetPreComputedScores()
 {
 #ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(m_cacheLock);
+  boost::unique_lock<boost::mutex> lock(m_updateLock);
 #endif
   precomputedScores.clear();
   for (unsigned int i=0; i<m_maxAge; i++) {
@@ -105,29 +108,55 @@ void DynamicCacheBasedLanguageModel::EvaluateInIsolation(const Phrase &sp
   scoreBreakdown.Assign(this, score);
 }
 
+void DynamicCacheBasedLanguageModel::ExtendKey(decaying_cache_key_t &key, const Factor *factor)
+{
+  // word by word, so that the key of an n-gram extends the key of its prefix
+  uint64_t id = factor->GetId();
+  key.ids.push_back(factor->GetId());
+  key.hash = util::MurmurHashNative(&id, sizeof(id), key.hash);
+}
+
+decaying_cache_key_t DynamicCacheBasedLanguageModel::GetKey(const std::string &ngram)
+{
+  FactorCollection &factorCollection = FactorCollection::Instance();
+  std::vector<std::string> words = Tokenize(ngram);
+
+  decaying_cache_key_t key;
+  for (size_t i = 0; i < words.size(); ++i)
+    ExtendKey(key, factorCollection.AddFactor(words[i]));
+  return key;
+}
+
+boost::shared_ptr<const decaying_cache_t> DynamicCacheBasedLanguageModel::GetCache() const
+{
+  return boost::atomic_load(&m_cache);
+}
+
+void DynamicCacheBasedLanguageModel::Publish(const boost::shared_ptr<const decaying_cache_t> &cache)
+{
+  // caller must hold m_updateLock
+  boost::atomic_store(&m_cache, cache);
+}
+
 float DynamicCacheBasedLanguageModel::Evaluate_Whole_String(const TargetPhrase& tp) const
 {
   //consider all words in the TargetPhrase as one n-gram
   // and compute the decaying_score for the whole n-gram
   // and return this value
 
-  decaying_cache_t::const_iterator it;
+  boost::shared_ptr<const decaying_cache_t> snapshot = GetCache();
+  const decaying_cache_t &cache = *snapshot;
   float score = m_lower_score;
 
-  std::string w = "";
-  size_t endpos = tp.GetSize();
-  for (size_t pos = 0 ; pos < endpos ; ++pos) {
-    w += tp.GetWord(pos).GetFactor(0)->GetString().as_string();
-    if (pos < endpos - 1) {
-      w += " ";
-    }
-  }
-  it = m_cache.find(w);
+  decaying_cache_key_t key;
+  key.ids.reserve(tp.GetSize());
+  for (size_t pos = 0 ; pos < tp.GetSize() ; ++pos)
+    ExtendKey(key, tp.GetWord(pos).GetFactor(0));
 
-  VERBOSE(4,"cblm::Evaluate_Whole_String: searching w:|" << w << "|" << std::endl);
-  if (it != m_cache.end()) { //found!
-    score = ((*it).second).second;
-    VERBOSE(4,"cblm::Evaluate_Whole_String: found w:|" << w << "|" << std::endl);
+  decaying_cache_t::const_iterator it = cache.find(key);
+  if (it != cache.end()) { //found!
+    score = it->second.value.second;
+    VERBOSE(4,"cblm::Evaluate_Whole_String: found w:|" << it->second.ngram << "|" << std::endl);
   }
 
   VERBOSE(4,"cblm::Evaluate_Whole_String: returning score:|" << score << "|" << std::endl);
@@ -140,26 +169,25 @@ float DynamicCacheBasedLanguageModel::Evaluate_All_Substrings(const TargetPhrase
   //and compute the decaying_score for all words
   //and return their sum
 
-  decaying_cache_t::const_iterator it;
+  boost::shared_ptr<const decaying_cache_t> snapshot = GetCache();
+  const decaying_cache_t &cache = *snapshot;
   float score = 0.0;
 
+  decaying_cache_key_t key;
+  key.ids.reserve(tp.GetSize());
   for (size_t startpos = 0 ; startpos < tp.GetSize() ; ++startpos) {
-    std::string w = "";
+    key.ids.clear();
+    key.hash = 0;
     for (size_t endpos = startpos; endpos < tp.GetSize() ; ++endpos) {
-      w += tp.GetWord(endpos).GetFactor(0)->GetString().as_string();
-      it = m_cache.find(w);
+      ExtendKey(key, tp.GetWord(endpos).GetFactor(0));
+      decaying_cache_t::const_iterator it = cache.find(key);
 
-      if (it != m_cache.end()) { //found!
-        score += ((*it).second).second;
-        VERBOSE(3,"cblm::Evaluate_All_Substrings: found w:|" << w << "| actual score:|" << ((*it).second).second << "| score:|" << score << "|" << std::endl);
+      if (it != cache.end()) { //found!
+        score += it->second.value.second;
+        VERBOSE(3,"cblm::Evaluate_All_Substrings: found w:|" << it->second.ngram << "| actual score:|" << it->second.value.second << "| score:|" << score << "|" << std::endl);
       } else {
         score += m_lower_score;
       }
-
-      if (endpos == startpos) {
-        w += " ";
-      }
-
     }
   }
   VERBOSE(3,"cblm::Evaluate_All_Substrings: returning score:|" << score << "|" << std::endl);
@@ -168,55 +196,42 @@ float DynamicCacheBasedLanguageModel::Evaluate_All_Substrings(const TargetPhrase
 
 void DynamicCacheBasedLanguageModel::Print() const
 {
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> read_lock(m_cacheLock);
-#endif
+  boost::shared_ptr<const decaying_cache_t> snapshot = GetCache();
+  const decaying_cache_t &cache = *snapshot;
   decaying_cache_t::const_iterator it;
   std::cout << "Content of the cache of Cache-Based Language Model" << std::endl;
-  std::cout << "Size of the cache of Cache-Based Language Model:|" << m_cache.size() << "|" << std::endl;
-  for ( it=m_cache.begin() ; it != m_cache.end(); it++ ) {
-    std::cout << "word:|" << (*it).first << "| age:|" << ((*it).second).first << "| score:|" << ((*it).second).second << "|" << std::endl;
+  std::cout << "Size of the cache of Cache-Based Language Model:|" << cache.size() << "|" << std::endl;
+  for ( it=cache.begin() ; it != cache.end(); it++ ) {
+    std::cout << "word:|" << it->second.ngram << "| age:|" << it->second.value.first << "| score:|" << it->second.value.second << "|" << std::endl;
   }
 }
 
-void DynamicCacheBasedLanguageModel::Decay()
+void DynamicCacheBasedLanguageModel::Decay(const decaying_cache_t &cache, decaying_cache_t &decayed)
 {
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(m_cacheLock);
-#endif
-  decaying_cache_t::iterator it;
+  decaying_cache_t::const_iterator it;
 
   unsigned int age;
   float score;
-  for ( it=m_cache.begin() ; it != m_cache.end(); it++ ) {
-    age=((*it).second).first + 1;
-    if (age > m_maxAge) {
-      m_cache.erase(it);
-      it--;
-    } else {
+  for ( it=cache.begin() ; it != cache.end(); it++ ) {
+    age=it->second.value.first + 1;
+    if (age <= m_maxAge) {
       score = GetPreComputedScores(age);
-//      score = decaying_score(age);
-      decaying_cache_value_t p (age, score);
-      (*it).second = p;
+      decaying_cache_entry_t &entry = decayed[it->first];
+      entry.ngram = it->second.ngram;
+      entry.value = decaying_cache_value_t(age, score);
     }
   }
 }
 
-void DynamicCacheBasedLanguageModel::Update(std::vector<std::string> words, int age)
+void DynamicCacheBasedLanguageModel::Update(decaying_cache_t &cache, std::vector<std::string> words, int age)
 {
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(m_cacheLock);
-#endif
   VERBOSE(3,"words.size():|" << words.size() << "|" << std::endl);
   for (size_t j=0; j<words.size(); j++) {
     words[j] = Trim(words[j]);
-//    VERBOSE(3,"CacheBasedLanguageModel::Update   word[" << j << "]:"<< words[j] << " age:" << age << " decaying_score(age):" << decaying_score(age) << std::endl);
-//    decaying_cache_value_t p (age,decaying_score(age));
     VERBOSE(3,"CacheBasedLanguageModel::Update   word[" << j << "]:"<< words[j] << " age:" << age << " GetPreComputedScores(age):" << GetPreComputedScores(age) << std::endl);
-    decaying_cache_value_t p (age,GetPreComputedScores(age));
-    std::pair<std::string, decaying_cache_value_t> e (words[j],p);
-    m_cache.erase(words[j]); //always erase the element (do nothing if the entry does not exist)
-    m_cache.insert(e); //insert the entry
+    decaying_cache_entry_t &entry = cache[GetKey(words[j])]; //replaces an existing entry
+    entry.ngram = words[j];
+    entry.value = decaying_cache_value_t(age, GetPreComputedScores(age));
   }
 }
 
@@ -233,14 +248,16 @@ void DynamicCacheBasedLanguageModel::ClearEntries(std::string &entries)
 void DynamicCacheBasedLanguageModel::ClearEntries(std::vector<std::string> words)
 {
 #ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(m_cacheLock);
+  boost::unique_lock<boost::mutex> lock(m_updateLock);
 #endif
+  boost::shared_ptr<decaying_cache_t> cache(new decaying_cache_t(*m_cache));
   VERBOSE(3,"words.size():|" << words.size() << "|" << std::endl);
   for (size_t j=0; j<words.size(); j++) {
     words[j] = Trim(words[j]);
     VERBOSE(3,"CacheBasedLanguageModel::ClearEntries   word[" << j << "]:"<< words[j] << std::endl);
-    m_cache.erase(words[j]); //always erase the element (do nothing if the entry does not exist)
+    cache->erase(GetKey(words[j])); //always erase the element (do nothing if the entry does not exist)
   }
+  Publish(cache);
 }
 
 void DynamicCacheBasedLanguageModel::Insert(std::string &entries)
@@ -256,10 +273,20 @@ void DynamicCacheBasedLanguageModel::Insert(std::string &entries)
 void DynamicCacheBasedLanguageModel::Insert(std::vector<std::string> ngrams)
 {
   VERBOSE(3,"DynamicCacheBasedLanguageModel Insert ngrams.size():|" << ngrams.size() << "|" << std::endl);
-  if (m_constant == false) {
-    Decay();
+  {
+#ifdef WITH_THREADS
+    boost::unique_lock<boost::mutex> lock(m_updateLock);
+#endif
+    // decay and insert in one copy, readers see both or neither
+    boost::shared_ptr<decaying_cache_t> cache(new decaying_cache_t());
+    if (m_constant == false) {
+      Decay(*m_cache, *cache);
+    } else {
+      *cache = *m_cache;
+    }
+    Update(*cache, ngrams, 1);
+    Publish(cache);
   }
-  Update(ngrams,1);
   IFVERBOSE(3) Print();
 }
 
@@ -318,9 +345,9 @@ void DynamicCacheBasedLanguageModel::Execute_Single_Command(std::string command)
 void DynamicCacheBasedLanguageModel::Clear()
 {
 #ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(m_cacheLock);
+  boost::unique_lock<boost::mutex> lock(m_updateLock);
 #endif
-  m_cache.clear();
+  Publish(boost::shared_ptr<const decaying_cache_t>(new decaying_cache_t()));
 }
 
 void DynamicCacheBasedLanguageModel::Load(AllOptions::ptr const& opts)
@@ -369,15 +396,23 @@ void DynamicCacheBasedLanguageModel::Load_Single_File(const std::string file)
   int age;
   std::vector<std::string> words;
 
-  while (getline(cacheFile, line)) {
-    std::vector<std::string> vecStr = TokenizeMultiCharSeparator( line , "||" );
-    if (vecStr.size() >= 2) {
-      age = Scan<int>(vecStr[0]);
-      vecStr.erase(vecStr.begin());
-      Update(vecStr,age);
-    } else {
-      UTIL_THROW_IF2(false, "The format of the loaded file is wrong: " << line);
+  {
+#ifdef WITH_THREADS
+    boost::unique_lock<boost::mutex> lock(m_updateLock);
+#endif
+    // the whole file goes into one new snapshot
+    boost::shared_ptr<decaying_cache_t> cache(new decaying_cache_t(*m_cache));
+    while (getline(cacheFile, line)) {
+      std::vector<std::string> vecStr = TokenizeMultiCharSeparator( line , "||" );
+      if (vecStr.size() >= 2) {
+        age = Scan<int>(vecStr[0]);
+        vecStr.erase(vecStr.begin());
+        Update(*cache, vecStr, age);
+      } else {
+        UTIL_THROW_IF2(false, "The format of the loaded file is wrong: " << line);
+      }
     }
+    Publish(cache);
   }
   IFVERBOSE(2) Print();
 }
@@ -385,7 +420,7 @@ void DynamicCacheBasedLanguageModel::Load_Single_File(const std::string file)
 void DynamicCacheBasedLanguageModel::SetQueryType(size_t type)
 {
 #ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> read_lock(m_cacheLock);
+  boost::unique_lock<boost::mutex> lock(m_updateLock);
 #endif
 
   m_query_type = type;
@@ -401,7 +436,7 @@ void DynamicCacheBasedLanguageModel::SetQueryType(size_t type)
 void DynamicCacheBasedLanguageModel::SetScoreType(size_t type)
 {
 #ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> read_lock(m_cacheLock);
+  boost::unique_lock<boost::mutex> lock(m_updateLock);
 #endif
   m_score_type = type;
   if ( m_score_type != CBLM_SCORE_TYPE_HYPERBOLA
@@ -420,7 +455,7 @@ void DynamicCacheBasedLanguageModel::SetScoreType(size_t type)
 void DynamicCacheBasedLanguageModel::SetMaxAge(unsigned int age)
 {
 #ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> read_lock(m_cacheLock);
+  boost::unique_lock<boost::mutex> lock(m_updateLock);
 #endif
   m_maxAge = age;
   VERBOSE(2, "CacheBasedLanguageModel MaxAge:  " << m_maxAge << std::endl);
@@ -3,16 +3,44 @@
 #ifndef moses_DynamicCacheBasedLanguageModel_h
 #define moses_DynamicCacheBasedLanguageModel_h
 
+#include <stdint.h>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
 #include "Util.h"
 #include "FeatureFunction.h"
 
 #ifdef WITH_THREADS
-#include <boost/thread/shared_mutex.hpp>
+#include <boost/thread/mutex.hpp>
 #include <boost/thread/locks.hpp>
 #endif
 
 typedef std::pair<int, float> decaying_cache_value_t;
-typedef std::map<std::string, decaying_cache_value_t > decaying_cache_t;
+struct decaying_cache_entry_t {
+  std::string ngram; // as inserted, for printing
+  decaying_cache_value_t value; // age and score
+};
+// an n-gram as the factor ids of its words, with their hash extended word by word
+// (see DynamicCacheBasedLanguageModel::ExtendKey()); the ids are compared on lookup
+struct decaying_cache_key_t {
+  std::vector<size_t> ids;
+  uint64_t hash;
+
+  decaying_cache_key_t() : hash(0) {}
+
+  bool operator==(const decaying_cache_key_t &other) const {
+    return hash == other.hash && ids == other.ids;
+  }
+};
+
+struct decaying_cache_key_hash {
+  size_t operator()(const decaying_cache_key_t &key) const {
+    return key.hash;
+  }
+};
+
+typedef boost::unordered_map<decaying_cache_key_t, decaying_cache_entry_t, decaying_cache_key_hash> decaying_cache_t;
 
 #define CBLM_QUERY_TYPE_UNDEFINED (-1)
 #define CBLM_QUERY_TYPE_ALLSUBSTRINGS 0
@@ -33,13 +61,27 @@ namespace Moses
 
 class Range;
 
+class Factor;
+
 /** Calculates score for the Dynamic Cache-Based pseudo LM
+ *
+ * The cache is an immutable snapshot. Every update (insert with decay, clear, file load)
+ * builds a new snapshot from a copy and publishes it with an atomic store, read-copy-update
+ * style, like the feature weights of StaticData. A lookup loads the current snapshot and
+ * holds it for the phrase being scored, so updates never modify a cache being read.
+ *
+ * The price is paid by updates: each one copies the whole cache, in time and, until the
+ * readers move on, in memory. A decaying insert rewrites every entry anyway; a constant
+ * insert, a cleared entry or a loaded file pay for the copy, so they are meant to be
+ * occasional (one per document or file), not per sentence.
  */
 class DynamicCacheBasedLanguageModel : public StatelessFeatureFunction
 {
   // data structure for the cache;
-  // the key is the word and the value is the decaying score
-  decaying_cache_t m_cache;
+  // the key is the n-gram (factor ids) and the value is the decaying score
+  // read with boost::atomic_load(), replaced with boost::atomic_store() (see Publish());
+  // updates hold m_updateLock, the only one to replace it, and read it directly
+  boost::shared_ptr<const decaying_cache_t> m_cache;
   size_t m_query_type; //way of querying the cache
   size_t m_score_type; //way of scoring entries of the cache
   std::string m_initfiles; // vector of files loaded in the initialization phase
@@ -50,10 +92,16 @@ class DynamicCacheBasedLanguageModel : public StatelessFeatureFunction
   unsigned int m_maxAge;
 
 #ifdef WITH_THREADS
-  //multiple readers - single writer lock
-  mutable boost::shared_mutex m_cacheLock;
+  // serializes updates and parameter changes
+  boost::mutex m_updateLock;
 #endif
 
+  static void ExtendKey(decaying_cache_key_t &key, const Factor *factor);
+  static decaying_cache_key_t GetKey(const std::string &ngram);
+
+  boost::shared_ptr<const decaying_cache_t> GetCache() const;
+  void Publish(const boost::shared_ptr<const decaying_cache_t> &cache);
+
   float decaying_score(unsigned int age);
   void SetPreComputedScores();
   float GetPreComputedScores(const unsigned int age);
@@ -61,8 +109,8 @@ class DynamicCacheBasedLanguageModel : public StatelessFeatureFunction
   float Evaluate_Whole_String( const TargetPhrase&) const;
   float Evaluate_All_Substrings( const TargetPhrase&) const;
 
-  void Decay();
-  void Update(std::vector<std::string> words, int age);
+  void Decay(const decaying_cache_t &cache, decaying_cache_t &decayed);
+  void Update(decaying_cache_t &cache, std::vector<std::string> words, int age);
 
   void ClearEntries(std::vector<std::string> entries);
 
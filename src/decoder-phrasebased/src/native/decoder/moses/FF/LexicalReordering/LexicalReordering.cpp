@@ -107,7 +107,8 @@ EvaluateWhenApplied(const Hypothesis& hypo,
                     ScoreComponentCollection* out) const
 {
   const LRState *prev = static_cast<const LRState *>(prev_state);
-  LRState *next_state = prev->Expand(hypo.GetTranslationOption(), hypo.GetInput(), out);
+  LRState *next_state = prev->Expand(hypo.GetTranslationOption(), hypo.GetWordsBitmap(),
+                                     hypo.GetInput(), out);
 
   return next_state;
 }
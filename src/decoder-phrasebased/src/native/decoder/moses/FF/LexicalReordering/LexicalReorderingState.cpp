@@ -1,12 +1,14 @@
 // -*- c++ -*-
 #include <vector>
 #include <string>
+#include <cstring>
 
 #include "FF/FFState.h"
 #include "Hypothesis.h"
 #include "Range.h"
 #include "TranslationOption.h"
 #include "Util.h"
+#include "util/murmur_hash.hh"
 
 #include "LexicalReordering.h"
 #include "LexicalReorderingState.h"
@@ -196,43 +198,151 @@ LRState *
 LRModel::
 CreateLRState(const InputType &input) const
 {
-  LRState *bwd = NULL, *fwd = NULL;
-  size_t offset = 0;
-
-  switch(m_direction) {
-  case Backward:
-  case Bidirectional:
-    if (m_phraseBased)
-      bwd = new PhraseBasedReorderingState(*this, Backward, offset);
-    else
-      bwd = new HReorderingBackwardState(*this, offset);
-    offset += m_collapseScores ? 1 : GetNumberOfTypes();
-    if (m_direction == Backward) return bwd; // else fall through
-  case Forward:
-    if (m_phraseBased)
-      fwd = new PhraseBasedReorderingState(*this, Forward, offset);
-    else
-      fwd = new HReorderingForwardState(*this, input.GetSize(), offset);
-    offset += m_collapseScores ? 1 : GetNumberOfTypes();
-    if (m_direction == Forward) return fwd;
+  return new LRState(*this);
+}
+
+// ===========================================================================
+// LEXICAL REORDERING STATE
+// ===========================================================================
+bool LRState::m_useFirstBackwardScore = true;
+
+LRState::
+LRState(const LRModel &config)
+  : m_configuration(config)
+  , m_prevOption(NULL)
+{
+  memset(&m_key, 0, sizeof(m_key));
+  m_key.backward.prevStart = m_key.backward.prevEnd = kNoPosition;
+  m_key.forward.prevStart = m_key.forward.prevEnd = kNoPosition;
+  m_hash = util::MurmurHashNative(&m_key, sizeof(m_key), m_reoStack.hash());
+}
+
+LRState::
+LRState(const LRState &prev, const TranslationOption &topt)
+  : m_configuration(prev.m_configuration)
+  , m_prevOption(&topt)
+  , m_hash(0)
+  , m_key(prev.m_key)
+  , m_reoStack(prev.m_reoStack)
+{ }
+
+bool
+LRState::
+operator==(const FFState& o) const
+{
+  const LRState &other = static_cast<const LRState&>(o);
+  return (m_hash == other.m_hash
+          && memcmp(&m_key, &other.m_key, sizeof(m_key)) == 0
+          && m_reoStack == other.m_reoStack);
+}
+
+LRState*
+LRState::
+Expand(const TranslationOption& topt, const Bitmap &coverage,
+       const InputType& input, ScoreComponentCollection* scores) const
+{
+  LRState *next = new LRState(*this, topt);
+  if (m_configuration.GetDirection() != LRModel::Forward)
+    ExpandBackward(topt, input, scores, *next);
+  if (m_configuration.GetDirection() != LRModel::Backward)
+    ExpandForward(topt, coverage, input, scores, *next);
+  next->m_hash = util::MurmurHashNative(&next->m_key, sizeof(next->m_key),
+                                        next->m_reoStack.hash());
+  return next;
+}
+
+void
+LRState::
+ExpandBackward(const TranslationOption& topt, const InputType& input,
+               ScoreComponentCollection* scores, LRState &next) const
+{
+  const Range cur = topt.GetSourceWordsRange();
+
+  if (!m_configuration.IsPhraseBased()) {
+    int reoDistance = next.m_reoStack.ShiftReduce(cur);
+    CopyScores(scores, topt, input, m_configuration.GetOrientation(reoDistance),
+               LRModel::Backward);
+    return;
+  }
+
+  const DirectionKey &key = m_key.backward;
+  const bool first = (key.prevStart == kNoPosition);
+  if (m_useFirstBackwardScore || !first) {
+    ReorderingType reoType = (first ? m_configuration.GetOrientation(cur)
+                              : m_configuration.GetOrientation(Range(key.prevStart, key.prevEnd), cur));
+    CopyScores(scores, topt, input, reoType, LRModel::Backward);
+  }
+  next.m_key.backward.prevStart = cur.GetStartPos();
+  next.m_key.backward.prevEnd = cur.GetEndPos();
+}
+
+// For compatibility with the phrase-based reordering model, scoring is one
+// step delayed.
+// The hierarchical forward model determines orientations heuristically as
+// follows:
+//  mono:   if the next phrase comes after the conditioning phrase and
+//          - there is a gap to the right of the conditioning phrase, or
+//          - the next phrase immediately follows it
+//  swap:   if the next phrase goes before the conditioning phrase and
+//          - there is a gap to the left of the conditioning phrase, or
+//          - the next phrase immediately precedes it
+//  dright: if the next phrase follows the conditioning phrase and other
+//          stuff comes in between
+//  dleft:  if the next phrase precedes the conditioning phrase and other
+//          stuff comes in between
+void
+LRState::
+ExpandForward(const TranslationOption& topt, const Bitmap &coverage,
+              const InputType& input, ScoreComponentCollection* scores,
+              LRState &next) const
+{
+  const Range cur = topt.GetSourceWordsRange();
+
+  const DirectionKey &key = m_key.forward;
+  if (key.prevStart != kNoPosition) {
+    const Range prev(key.prevStart, key.prevEnd);
+    ReorderingType reoType = (m_configuration.IsPhraseBased()
+                              ? m_configuration.GetOrientation(prev, cur)
+                              : m_configuration.GetOrientation(prev, cur, coverage));
+    CopyScores(scores, topt, input, reoType, LRModel::Forward);
+  }
+
+  // topt conditions the next orientation: keep the scores it will be given
+  DirectionKey &nextKey = next.m_key.forward;
+  memset(&nextKey, 0, sizeof(nextKey));
+  nextKey.prevStart = cur.GetStartPos();
+  nextKey.prevEnd = cur.GetEndPos();
+
+  const Scores *cached = topt.GetLexReorderingScores(m_configuration.GetScoreProducer());
+  if (cached) {
+    nextKey.prevScored = 1;
+    const size_t offset = GetOffset(LRModel::Forward);
+    const size_t numTypes = m_configuration.GetNumberOfTypes();
+    for (size_t i = 0; i < numTypes && offset + i < cached->size(); ++i) {
+      // + 0.0f turns -0 into 0, they have to compare equal bitwise
+      nextKey.prevScores[i] = (*cached)[offset + i] + 0.0f;
+    }
   }
-  return new BidirectionalReorderingState(*this, bwd, fwd, 0);
 }
 
+size_t
+LRState::
+GetOffset(LRModel::Direction dir) const
+{
+  if (dir == LRModel::Forward && m_configuration.GetDirection() == LRModel::Bidirectional)
+    return m_configuration.CollapseScores() ? 1 : m_configuration.GetNumberOfTypes();
+  return 0;
+}
 
 void
 LRState::
 CopyScores(ScoreComponentCollection*  accum,
            const TranslationOption &topt,
            const InputType& input,
-           ReorderingType reoType) const
+           ReorderingType reoType,
+           LRModel::Direction dir) const
 {
-  // don't call this on a bidirectional object
-  UTIL_THROW_IF2(m_direction != LRModel::Backward &&
-                 m_direction != LRModel::Forward,
-                 "Unknown direction: " << m_direction);
-
-  TranslationOption const* relevantOpt = ((m_direction == LRModel::Backward)
+  TranslationOption const* relevantOpt = ((dir == LRModel::Backward)
                                           ? &topt : m_prevOption);
 
   LexicalReordering* producer = m_configuration.GetScoreProducer();
@@ -240,8 +350,9 @@ CopyScores(ScoreComponentCollection*  accum,
 
   // The approach here is bizarre! Why create a whole vector and do
   // vector addition (acumm->PlusEquals) to update a single value? - UG
-  size_t off_remote = m_offset + reoType;
-  size_t off_local  = m_configuration.CollapseScores() ? m_offset : off_remote;
+  const size_t offset = GetOffset(dir);
+  size_t off_remote = offset + reoType;
+  size_t off_local  = m_configuration.CollapseScores() ? offset : off_remote;
 
   UTIL_THROW_IF2(off_local >= producer->GetNumScoreComponents(),
                  "offset out of vector bounds!");
@@ -264,243 +375,6 @@ CopyScores(ScoreComponentCollection*  accum,
 
   const SparseReordering* sparse = m_configuration.GetSparseReordering();
   if (sparse) sparse->CopyScores(*relevantOpt, m_prevOption, input, reoType,
-                                   m_direction, accum);
-}
-
-
-int
-LRState::
-ComparePrevScores(const TranslationOption *other) const
-{
-  LexicalReordering* producer = m_configuration.GetScoreProducer();
-  const Scores* myScores = m_prevOption->GetLexReorderingScores(producer);
-  const Scores* yrScores = other->GetLexReorderingScores(producer);
-
-  if(myScores == yrScores) return 0;
-
-  // The pointers are NULL if a phrase pair isn't found in the reordering table.
-  if(yrScores == NULL) return -1;
-  if(myScores == NULL) return  1;
-
-  size_t stop = m_offset + m_configuration.GetNumberOfTypes();
-  for(size_t i = m_offset; i < stop; i++) {
-    if((*myScores)[i] < (*yrScores)[i]) return -1;
-    if((*myScores)[i] > (*yrScores)[i]) return  1;
-  }
-  return 0;
-}
-
-// ===========================================================================
-// PHRASE BASED REORDERING STATE
-// ===========================================================================
-bool PhraseBasedReorderingState::m_useFirstBackwardScore = true;
-
-PhraseBasedReorderingState::
-PhraseBasedReorderingState(const PhraseBasedReorderingState *prev,
-                           const TranslationOption &topt)
-  : LRState(prev, topt)
-  , m_prevRange(topt.GetSourceWordsRange())
-  , m_first(false)
-{ }
-
-
-PhraseBasedReorderingState::
-PhraseBasedReorderingState(const LRModel &config,
-                           LRModel::Direction dir, size_t offset)
-  : LRState(config, dir, offset)
-  , m_prevRange(NOT_FOUND,NOT_FOUND)
-  , m_first(true)
-{ }
-
-
-size_t PhraseBasedReorderingState::hash() const
-{
-  size_t ret;
-  ret = hash_value(m_prevRange);
-  boost::hash_combine(ret, m_direction);
-
-  return ret;
-}
-
-bool PhraseBasedReorderingState::operator==(const FFState& o) const
-{
-  if (&o == this) return true;
-
-  const PhraseBasedReorderingState &other = static_cast<const PhraseBasedReorderingState&>(o);
-  if (m_prevRange == other.m_prevRange) {
-    if (m_direction == LRModel::Forward) {
-      int compareScore = ComparePrevScores(other.m_prevOption);
-      return compareScore == 0;
-    } else {
-      return true;
-    }
-  } else {
-    return false;
-  }
-}
-
-LRState*
-PhraseBasedReorderingState::
-Expand(const TranslationOption& topt, const InputType& input,
-       ScoreComponentCollection* scores) const
-{
-  // const LRModel::ModelType modelType = m_configuration.GetModelType();
-
-  if ((m_direction != LRModel::Forward && m_useFirstBackwardScore) || !m_first) {
-    LRModel const& lrmodel = m_configuration;
-    Range const cur = topt.GetSourceWordsRange();
-    LRModel::ReorderingType reoType = (m_first ? lrmodel.GetOrientation(cur)
-                                       : lrmodel.GetOrientation(m_prevRange,cur));
-    CopyScores(scores, topt, input, reoType);
-  }
-  return new PhraseBasedReorderingState(this, topt);
-}
-
-
-///////////////////////////
-//BidirectionalReorderingState
-
-size_t BidirectionalReorderingState::hash() const
-{
-  size_t ret = m_backward->hash();
-  boost::hash_combine(ret, m_forward->hash());
-  return ret;
-}
-
-bool BidirectionalReorderingState::operator==(const FFState& o) const
-{
-  if (&o == this) return 0;
-
-  BidirectionalReorderingState const &other
-  = static_cast<BidirectionalReorderingState const&>(o);
-
-  bool ret = (*m_backward == *other.m_backward) && (*m_forward == *other.m_forward);
-  return ret;
-}
-
-LRState*
-BidirectionalReorderingState::
-Expand(const TranslationOption& topt, const InputType& input,
-       ScoreComponentCollection* scores) const
-{
-  LRState *newbwd = m_backward->Expand(topt,input, scores);
-  LRState *newfwd = m_forward->Expand(topt, input, scores);
-  return new BidirectionalReorderingState(m_configuration, newbwd, newfwd, m_offset);
-}
-
-///////////////////////////
-//HierarchicalReorderingBackwardState
-
-HReorderingBackwardState::
-HReorderingBackwardState(const HReorderingBackwardState *prev,
-                         const TranslationOption &topt,
-                         ReorderingStack reoStack)
-  : LRState(prev, topt),  m_reoStack(reoStack)
-{ }
-
-HReorderingBackwardState::
-HReorderingBackwardState(const LRModel &config, size_t offset)
-  : LRState(config, LRModel::Backward, offset)
-{ }
-
-size_t HReorderingBackwardState::hash() const
-{
-  size_t ret = m_reoStack.hash();
-  return ret;
-}
-
-bool HReorderingBackwardState::operator==(const FFState& o) const
-{
-  const HReorderingBackwardState& other
-  = static_cast<const HReorderingBackwardState&>(o);
-  bool ret = m_reoStack == other.m_reoStack;
-  return ret;
-}
-
-LRState*
-HReorderingBackwardState::
-Expand(const TranslationOption& topt, const InputType& input,
-       ScoreComponentCollection*  scores) const
-{
-  HReorderingBackwardState* nextState;
-  nextState = new HReorderingBackwardState(this, topt, m_reoStack);
-  Range swrange = topt.GetSourceWordsRange();
-  int reoDistance = nextState->m_reoStack.ShiftReduce(swrange);
-  ReorderingType reoType = m_configuration.GetOrientation(reoDistance);
-  CopyScores(scores, topt, input, reoType);
-  return nextState;
-}
-
-///////////////////////////
-//HReorderingForwardState
-
-HReorderingForwardState::
-HReorderingForwardState(const LRModel &config,
-                        size_t size, size_t offset)
-  : LRState(config, LRModel::Forward, offset)
-  , m_first(true)
-  , m_prevRange(NOT_FOUND,NOT_FOUND)
-  , m_coverage(size)
-{ }
-
-HReorderingForwardState::
-HReorderingForwardState(const HReorderingForwardState *prev,
-                        const TranslationOption &topt)
-  : LRState(prev, topt)
-  , m_first(false)
-  , m_prevRange(topt.GetSourceWordsRange())
-  , m_coverage(prev->m_coverage, topt.GetSourceWordsRange())
-{
+                                   dir, accum);
 }
-
-size_t HReorderingForwardState::hash() const
-{
-  size_t ret;
-  ret = hash_value(m_prevRange);
-  return ret;
-}
-
-bool HReorderingForwardState::operator==(const FFState& o) const
-{
-  if (&o == this) return true;
-
-  HReorderingForwardState const& other
-  = static_cast<HReorderingForwardState const&>(o);
-
-  int compareScores = ((m_prevRange == other.m_prevRange)
-                       ? ComparePrevScores(other.m_prevOption)
-                       : (m_prevRange < other.m_prevRange) ? -1 : 1);
-  return compareScores == 0;
 }
-
-// For compatibility with the phrase-based reordering model, scoring is one
-// step delayed.
-// The forward model takes determines orientations heuristically as follows:
-//  mono:   if the next phrase comes after the conditioning phrase and
-//          - there is a gap to the right of the conditioning phrase, or
-//          - the next phrase immediately follows it
-//  swap:   if the next phrase goes before the conditioning phrase and
-//          - there is a gap to the left of the conditioning phrase, or
-//          - the next phrase immediately precedes it
-//  dright: if the next phrase follows the conditioning phrase and other
-//          stuff comes in between
-//  dleft:  if the next phrase precedes the conditioning phrase and other
-//          stuff comes in between
-
-LRState*
-HReorderingForwardState::
-Expand(TranslationOption const& topt, InputType const& input,
-       ScoreComponentCollection* scores) const
-{
-  const Range cur = topt.GetSourceWordsRange();
-  // keep track of the current coverage ourselves so we don't need the hypothesis
-  Bitmap cov(m_coverage, cur);
-  if (!m_first) {
-    LRModel::ReorderingType reoType;
-    reoType = m_configuration.GetOrientation(m_prevRange,cur,cov);
-    CopyScores(scores, topt, input, reoType);
-  }
-  return new HReorderingForwardState(this, topt);
-}
-}
-
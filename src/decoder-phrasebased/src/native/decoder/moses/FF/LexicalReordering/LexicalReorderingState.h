@@ -2,6 +2,7 @@
 #pragma once
 #include <vector>
 #include <string>
+#include <stdint.h>
 
 #include <boost/scoped_ptr.hpp>
 
@@ -136,173 +137,83 @@ private:
   boost::scoped_ptr<SparseReordering> m_sparse;
 };
 
-//! Abstract class for lexical reordering model states
+//! State of a lexical reordering model, for all of its directions.
+//!
+//! Phrase-based directions remember the previous source phrase, the
+//! hierarchical backward direction its shift-reduce stack (see Galley and
+//! Manning, A Simple and Effective Hierarchical Phrase Reordering Model,
+//! EMNLP 2008). Forward directions score the previous phrase once the next one
+//! is known, so they also keep its reordering scores: hypotheses can only
+//! recombine if these would be the same.
+//!
+//! Everything recombination looks at is packed into a zero-initialized Key,
+//! fingerprinted once when the state is created: hash() returns the
+//! fingerprint and operator== is a memcmp. A state is a single fixed-size
+//! object, bidirectional models do not nest one state per direction.
 class LRState : public FFState
 {
 public:
 
   typedef LRModel::ReorderingType ReorderingType;
 
-  virtual
-  LRState*
-  Expand(const TranslationOption& hypo, const InputType& input,
-         ScoreComponentCollection* scores) const = 0;
-
-  static
-  LRState*
-  CreateLRState(const std::vector<std::string>& config,
-                LRModel::Direction dir,
-                const InputType &input);
-
-protected:
-
-  const LRModel& m_configuration;
-
-  // The following is the true direction of the object, which can be
-  // Backward or Forward even if the Configuration has Bidirectional.
-  LRModel::Direction m_direction;
-  size_t m_offset;
-  //forward scores are conditioned on prev option, so need to remember it
-  const TranslationOption *m_prevOption;
-
-  inline
-  LRState(const LRState *prev,
-          const TranslationOption &topt)
-    : m_configuration(prev->m_configuration)
-    , m_direction(prev->m_direction)
-    , m_offset(prev->m_offset)
-    , m_prevOption(&topt)
-  { }
-
-  inline
-  LRState(const LRModel &config,
-          LRModel::Direction dir,
-          size_t offset)
-    : m_configuration(config)
-    , m_direction(dir)
-    , m_offset(offset)
-    , m_prevOption(NULL)
-  { }
+  static bool m_useFirstBackwardScore;
 
-  // copy the right scores in the right places, taking into account
-  // forward/backward, offset, collapse
-  void
-  CopyScores(ScoreComponentCollection* scores,
-             const TranslationOption& topt,
-             const InputType& input, ReorderingType reoType) const;
+  //! state of the empty hypothesis
+  explicit LRState(const LRModel &config);
 
-  int
-  ComparePrevScores(const TranslationOption *other) const;
-};
+  //! @param coverage source words covered after topt has been applied
+  LRState*
+  Expand(const TranslationOption& topt, const Bitmap &coverage,
+         const InputType& input, ScoreComponentCollection* scores) const;
 
-//! @todo what is this?
-class BidirectionalReorderingState
-  : public LRState
-{
-private:
-  const LRState *m_backward;
-  const LRState *m_forward;
-public:
-  BidirectionalReorderingState(const LRModel &config,
-                               const LRState *bw,
-                               const LRState *fw, size_t offset)
-    : LRState(config,
-              LRModel::Bidirectional,
-              offset)
-    , m_backward(bw)
-    , m_forward(fw)
-  { }
-
-  ~BidirectionalReorderingState() {
-    delete m_backward;
-    delete m_forward;
+  virtual size_t hash() const {
+    return m_hash;
   }
-
-  virtual size_t hash() const;
   virtual bool operator==(const FFState& other) const;
 
-  LRState*
-  Expand(const TranslationOption& topt, const InputType& input,
-         ScoreComponentCollection*  scores) const;
-};
-
-//! State for the standard Moses implementation of lexical reordering models
-//! (see Koehn et al, Edinburgh System Description for the 2005 NIST MT
-//! Evaluation)
-class PhraseBasedReorderingState
-  : public LRState
-{
 private:
-  Range m_prevRange;
-  bool m_first;
-public:
-  static bool m_useFirstBackwardScore;
-  PhraseBasedReorderingState(const LRModel &config,
-                             LRModel::Direction dir,
-                             size_t offset);
-  PhraseBasedReorderingState(const PhraseBasedReorderingState *prev,
-                             const TranslationOption &topt);
+  static const uint32_t kNoPosition = 0xffffffff;
 
-  virtual size_t hash() const;
-  virtual bool operator==(const FFState& other) const;
-
-  virtual
-  LRState*
-  Expand(const TranslationOption& topt,const InputType& input,
-         ScoreComponentCollection*  scores) const;
-
-  ReorderingType GetOrientationTypeMSD(Range currRange) const;
-  ReorderingType GetOrientationTypeMSLR(Range currRange) const;
-  ReorderingType GetOrientationTypeMonotonic(Range currRange) const;
-  ReorderingType GetOrientationTypeLeftRight(Range currRange) const;
-};
-
-//! State for a hierarchical reordering model (see Galley and Manning, A
-//! Simple and Effective Hierarchical Phrase Reordering Model, EMNLP 2008)
-//! backward state (conditioned on the previous phrase)
-class HReorderingBackwardState : public LRState
-{
-private:
-  ReorderingStack m_reoStack;
-public:
-  HReorderingBackwardState(const LRModel &config, size_t offset);
-  HReorderingBackwardState(const HReorderingBackwardState *prev,
-                           const TranslationOption &topt,
-                           ReorderingStack reoStack);
-  virtual size_t hash() const;
-  virtual bool operator==(const FFState& other) const;
+  //! what one direction needs to tell states apart
+  struct DirectionKey {
+    uint32_t prevStart, prevEnd; //! previous source phrase, kNoPosition before the first one
+    uint32_t prevScored; //! forward: 1 if the previous phrase is in the reordering table
+    float prevScores[LRModel::MAX + 1]; //! forward: its scores for this direction
+  };
 
-  virtual LRState* Expand(const TranslationOption& hypo, const InputType& input,
-                          ScoreComponentCollection*  scores) const;
+  struct Key {
+    DirectionKey backward;
+    DirectionKey forward;
+  };
 
-private:
-  ReorderingType GetOrientationTypeMSD(int reoDistance) const;
-  ReorderingType GetOrientationTypeMSLR(int reoDistance) const;
-  ReorderingType GetOrientationTypeMonotonic(int reoDistance) const;
-  ReorderingType GetOrientationTypeLeftRight(int reoDistance) const;
-};
+  const LRModel& m_configuration;
+  //! forward scores are conditioned on prev option, so need to remember it
+  const TranslationOption *m_prevOption;
+  size_t m_hash;
+  Key m_key;
+  ReorderingStack m_reoStack; //! hierarchical backward direction only
 
+  LRState(const LRState &prev, const TranslationOption &topt);
 
-//!forward state (conditioned on the next phrase)
-class HReorderingForwardState : public LRState
-{
-private:
-  bool m_first;
-  Range m_prevRange;
-  Bitmap m_coverage;
+  void
+  ExpandBackward(const TranslationOption& topt, const InputType& input,
+                 ScoreComponentCollection* scores, LRState &next) const;
 
-public:
-  HReorderingForwardState(const LRModel &config, size_t sentenceLength,
-                          size_t offset);
-  HReorderingForwardState(const HReorderingForwardState *prev,
-                          const TranslationOption &topt);
+  void
+  ExpandForward(const TranslationOption& topt, const Bitmap &coverage,
+                const InputType& input, ScoreComponentCollection* scores,
+                LRState &next) const;
 
-  virtual size_t hash() const;
-  virtual bool operator==(const FFState& other) const;
+  //! first score component of a direction
+  size_t
+  GetOffset(LRModel::Direction dir) const;
 
-  virtual LRState* Expand(const TranslationOption& hypo,
-                          const InputType& input,
-                          ScoreComponentCollection* scores) const;
+  // copy the right scores in the right places, taking into account
+  // forward/backward, offset, collapse
+  void
+  CopyScores(ScoreComponentCollection* scores,
+             const TranslationOption& topt,
+             const InputType& input, ReorderingType reoType,
+             LRModel::Direction dir) const;
 };
 }
-
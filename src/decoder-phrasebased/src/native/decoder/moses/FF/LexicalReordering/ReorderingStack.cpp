@@ -6,34 +6,85 @@
 
 #include "ReorderingStack.h"
 #include <vector>
+#include <cstring>
+#include "util/murmur_hash.hh"
 
 namespace Moses
 {
+ReorderingStack::ReorderingStack()
+  : m_spans(m_inlineSpans)
+  , m_size(0)
+  , m_capacity(kInlineSpans)
+{
+}
+
+ReorderingStack::ReorderingStack(const ReorderingStack &other)
+  : m_spans(m_inlineSpans)
+  , m_size(0)
+  , m_capacity(kInlineSpans)
+{
+  *this = other;
+}
+
+ReorderingStack::~ReorderingStack()
+{
+  if (m_spans != m_inlineSpans)
+    delete[] m_spans;
+}
+
+ReorderingStack &ReorderingStack::operator=(const ReorderingStack &other)
+{
+  if (&other == this)
+    return *this;
+
+  if (other.m_size > m_capacity) {
+    if (m_spans != m_inlineSpans)
+      delete[] m_spans;
+    m_spans = new Span[other.m_capacity];
+    m_capacity = other.m_capacity;
+  }
+  m_size = other.m_size;
+  memcpy(m_spans, other.m_spans, m_size * sizeof(Span));
+  return *this;
+}
+
 size_t ReorderingStack::hash() const
 {
-  std::size_t ret = boost::hash_range(m_stack.begin(), m_stack.end());
-  return ret;
+  return util::MurmurHashNative(m_spans, m_size * sizeof(Span));
 }
 
-bool ReorderingStack::operator==(const ReorderingStack& o) const
+bool ReorderingStack::operator==(const ReorderingStack& other) const
 {
-  const ReorderingStack& other = static_cast<const ReorderingStack&>(o);
-  return m_stack == other.m_stack;
+  return m_size == other.m_size && memcmp(m_spans, other.m_spans, m_size * sizeof(Span)) == 0;
+}
+
+void ReorderingStack::Push(const Range &span)
+{
+  if (m_size == m_capacity) {
+    Span *spans = new Span[2 * m_capacity];
+    memcpy(spans, m_spans, m_size * sizeof(Span));
+    if (m_spans != m_inlineSpans)
+      delete[] m_spans;
+    m_spans = spans;
+    m_capacity *= 2;
+  }
+  m_spans[m_size].start = span.GetStartPos();
+  m_spans[m_size].end = span.GetEndPos();
+  ++m_size;
 }
 
-// Method to push (shift element into the stack and reduce if reqd)
 int ReorderingStack::ShiftReduce(Range input_span)
 {
   int distance;  // value to return: the initial distance between this and previous span
 
   // stack is empty
-  if(m_stack.empty()) {
-    m_stack.push_back(input_span);
+  if(m_size == 0) {
+    Push(input_span);
     return input_span.GetStartPos() + 1; // - (-1)
   }
 
   // stack is non-empty
-  Range prev_span = m_stack.back(); //access last element added
+  Range prev_span = Back(); //access last element added
 
   //calculate the distance we are returning
   if(input_span.GetStartPos() > prev_span.GetStartPos()) {
@@ -43,15 +94,15 @@ int ReorderingStack::ShiftReduce(Range input_span)
   }
 
   if(distance == 1) { //monotone
-    m_stack.pop_back();
+    --m_size;
     Range new_span(prev_span.GetStartPos(), input_span.GetEndPos());
     Reduce(new_span);
   } else if(distance == -1) { //swap
-    m_stack.pop_back();
+    --m_size;
     Range new_span(input_span.GetStartPos(), prev_span.GetEndPos());
     Reduce(new_span);
   } else {      // discontinuous
-    m_stack.push_back(input_span);
+    Push(input_span);
   }
 
   return distance;
@@ -62,16 +113,16 @@ void ReorderingStack::Reduce(Range current)
 {
   bool cont_loop = true;
 
-  while (cont_loop && m_stack.size() > 0) {
+  while (cont_loop && m_size > 0) {
 
-    Range previous = m_stack.back();
+    Range previous = Back();
 
     if(current.GetStartPos() - previous.GetEndPos() == 1) { //mono&merge
-      m_stack.pop_back();
+      --m_size;
       Range t(previous.GetStartPos(), current.GetEndPos());
       current = t;
     } else if(previous.GetStartPos() - current.GetEndPos() == 1) { //swap&merge
-      m_stack.pop_back();
+      --m_size;
       Range t(current.GetStartPos(), previous.GetEndPos());
       current = t;
     } else { // discontinuous, no more merging
@@ -80,7 +131,7 @@ void ReorderingStack::Reduce(Range current)
   } // finished reducing, exit
 
   // add to stack
-  m_stack.push_back(current);
+  Push(current);
 }
 
 }
@@ -8,6 +8,7 @@
 
 //#include <string>
 #include <vector>
+#include <stdint.h>
 //#include "Factor.h"
 //#include "Phrase.h"
 //#include "TypeDef.h"
@@ -17,15 +18,20 @@
 namespace Moses
 {
 
-/** @todo what is this?
+/** Shift-reduce stack of the hierarchical reordering model: the blocks of
+ * source spans that could not be merged yet, most recent last.
+ *
+ * Spans are stored packed, in an inline array for the usual shallow stacks
+ * and on the heap only for deeper ones, so that copying a stack for the next
+ * state does not allocate and two stacks compare with memcmp.
  */
 class ReorderingStack
 {
-private:
-
-  std::vector<Range> m_stack;
-
 public:
+  ReorderingStack();
+  ReorderingStack(const ReorderingStack &other);
+  ~ReorderingStack();
+  ReorderingStack &operator=(const ReorderingStack &other);
 
   size_t hash() const;
   bool operator==(const ReorderingStack& other) const;
@@ -33,8 +39,22 @@ public:
   int ShiftReduce(Range input_span);
 
 private:
+  struct Span {
+    uint32_t start, end;
+  };
+
+  static const size_t kInlineSpans = 6;
+
+  Span *m_spans; //! m_inlineSpans, or a heap array once the stack outgrows it
+  uint32_t m_size;
+  uint32_t m_capacity;
+  Span m_inlineSpans[kInlineSpans];
+
   void Reduce(Range input_span);
+  void Push(const Range &span);
+  Range Back() const {
+    return Range(m_spans[m_size - 1].start, m_spans[m_size - 1].end);
+  }
 };
 
-
 }
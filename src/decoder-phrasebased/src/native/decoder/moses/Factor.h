@@ -27,6 +27,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "Util.h"
 #include "util/string_piece.hh"
 
+#include <mmt/sentence.h>
+
 namespace Moses
 {
 
@@ -48,12 +50,13 @@ class Factor
   // This is mutable so the pointer can be changed to pool-backed memory.
   mutable StringPiece m_string;
   size_t			m_id;
+  mmt::wid_t	m_wid;
 
   //! protected constructor. only friend class, FactorCollection, is allowed to create Factor objects
   Factor() {}
 
   // Needed for STL containers.  They'll delegate through FactorFriend, which is never exposed publicly.
-  Factor(const Factor &factor) : m_string(factor.m_string), m_id(factor.m_id) {}
+  Factor(const Factor &factor) : m_string(factor.m_string), m_id(factor.m_id), m_wid(factor.m_wid) {}
 
   // Not implemented.  Shouldn't be called.
   Factor &operator=(const Factor &factor);
@@ -68,6 +71,11 @@ public:
     return m_id;
   }
 
+  //! MMT word id, when the string is the decimal form of one (kVocabularyUnknownWord otherwise)
+  inline mmt::wid_t GetWid() const {
+    return m_wid;
+  }
+
   /** transitive comparison between 2 factors.
   *	-1 = less than
   *	+1 = more than
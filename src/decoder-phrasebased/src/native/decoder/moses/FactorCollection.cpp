@@ -23,83 +23,194 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifdef WITH_THREADS
 #include <boost/thread/locks.hpp>
 #endif
+#include <cstdio>
+#include <cstring>
 #include <ostream>
 #include <string>
 #include "FactorCollection.h"
 #include "Util.h"
 #include "util/pool.hh"
 
+#include <mmt/vocabulary/Vocabulary.h>
+
 using namespace std;
 
 namespace Moses
 {
 FactorCollection FactorCollection::s_instance;
 
+static const size_t kInitialTableSize = 1 << 14;
+
+// MMT word id spelled by a factor string, parsed once when the factor is created
+static mmt::wid_t ParseWordId(const StringPiece &str)
+{
+  if (str.empty() || str.size() > 10)
+    return mmt::kVocabularyUnknownWord;
+
+  uint64_t value = 0;
+  for (size_t i = 0; i < str.size(); ++i) {
+    if (str[i] < '0' || str[i] > '9')
+      return mmt::kVocabularyUnknownWord;
+    value = value * 10 + (str[i] - '0');
+  }
+
+  return value > UINT32_MAX ? mmt::kVocabularyUnknownWord : (mmt::wid_t) value;
+}
+
+FactorCollection::Table::Table(size_t size) : mask(size - 1)
+{
+  slots = new Slot[size];
+  for (size_t i = 0; i < size; ++i)
+    slots[i].store(NULL, boost::memory_order_relaxed);
+}
+
+FactorCollection::Table::~Table()
+{
+  delete[] slots;
+}
+
+const Factor *FactorCollection::Table::Find(const StringPiece &factorString, size_t hash) const
+{
+  for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+    const Factor *factor = slots[i].load(boost::memory_order_acquire);
+    if (factor == NULL || factor->m_string == factorString)
+      return factor;
+  }
+}
+
+void FactorCollection::Table::Insert(const Factor *factor, size_t hash)
+{
+  size_t i = hash & mask;
+  while (slots[i].load(boost::memory_order_relaxed) != NULL)
+    i = (i + 1) & mask;
+
+  // publishes the factor, its string included
+  slots[i].store(factor, boost::memory_order_release);
+}
+
+FactorCollection::FactorCollection()
+  : m_factorIdNonTerminal(0)
+  , m_factorId(moses_MaxNumNonterminals)
+{
+  for (size_t i = 0; i < 2; ++i) {
+    m_tables[i].store(new Table(kInitialTableSize), boost::memory_order_relaxed);
+    m_sizes[i] = 0;
+  }
+
+  m_wordChunks = new boost::atomic<Slot *>[kWordChunkCount];
+  for (size_t i = 0; i < kWordChunkCount; ++i)
+    m_wordChunks[i].store(NULL, boost::memory_order_relaxed);
+}
+
 const Factor *FactorCollection::AddFactor(const StringPiece &factorString, bool isNonTerminal)
 {
-  FactorFriend to_ins;
-  to_ins.in.m_string = factorString;
-  to_ins.in.m_id = (isNonTerminal) ? m_factorIdNonTerminal : m_factorId;
-  Set & set = (isNonTerminal) ? m_set : m_setNonTerminal;
-  // If we're threaded, hope a read-only lock is sufficient.
+  boost::atomic<Table *> &tableRef = m_tables[isNonTerminal ? 1 : 0];
+  size_t hash = Hash(factorString);
+
+  const Factor *factor = tableRef.load(boost::memory_order_acquire)->Find(factorString, hash);
+  if (factor) return factor;
+
 #ifdef WITH_THREADS
-  {
-    // read=lock scope
-    boost::shared_lock<boost::shared_mutex> read_lock(m_accessLock);
-    Set::const_iterator i = set.find(to_ins);
-    if (i != set.end()) return &i->in;
-  }
-  boost::unique_lock<boost::shared_mutex> lock(m_accessLock);
-#endif // WITH_THREADS
-  std::pair<Set::iterator, bool> ret(set.insert(to_ins));
-  if (ret.second) {
-    ret.first->in.m_string.set(
-      memcpy(m_string_backing.Allocate(factorString.size()), factorString.data(), factorString.size()),
-      factorString.size());
-    if (isNonTerminal) {
-      m_factorIdNonTerminal++;
-      UTIL_THROW_IF2(m_factorIdNonTerminal >= moses_MaxNumNonterminals, "Number of non-terminals exceeds maximum size reserved. Adjust parameter moses_MaxNumNonterminals, then recompile");
-    } else {
-      m_factorId++;
+  boost::unique_lock<boost::mutex> lock(m_insertLock);
+#endif
+  // the factor may have been added, or the table replaced, in the meantime
+  Table *table = tableRef.load(boost::memory_order_relaxed);
+  factor = table->Find(factorString, hash);
+  if (factor) return factor;
+
+  size_t &size = m_sizes[isNonTerminal ? 1 : 0];
+  if ((size + 1) * 2 > table->mask + 1) {
+    // keep the load factor under 1/2: copy into a table twice as big and publish it
+    Table *bigger = new Table((table->mask + 1) * 2);
+    for (size_t i = 0; i <= table->mask; ++i) {
+      const Factor *old = table->slots[i].load(boost::memory_order_relaxed);
+      if (old) bigger->Insert(old, Hash(old->m_string));
     }
+
+    tableRef.store(bigger, boost::memory_order_release);
+    m_retiredTables.push_back(table);
+    table = bigger;
   }
-  return &ret.first->in;
+
+  FactorFriend *newFactor = new (m_factor_backing.Allocate(sizeof(FactorFriend))) FactorFriend();
+  newFactor->in.m_string.set(
+    memcpy(m_string_backing.Allocate(factorString.size()), factorString.data(), factorString.size()),
+    factorString.size());
+  newFactor->in.m_wid = ParseWordId(factorString);
+
+  if (isNonTerminal) {
+    newFactor->in.m_id = m_factorIdNonTerminal++;
+    UTIL_THROW_IF2(m_factorIdNonTerminal >= moses_MaxNumNonterminals, "Number of non-terminals exceeds maximum size reserved. Adjust parameter moses_MaxNumNonterminals, then recompile");
+  } else {
+    newFactor->in.m_id = m_factorId++;
+  }
+
+  table->Insert(&newFactor->in, hash);
+  size++;
+
+  return &newFactor->in;
 }
 
 const Factor *FactorCollection::GetFactor(const StringPiece &factorString, bool isNonTerminal)
 {
-  FactorFriend to_find;
-  to_find.in.m_string = factorString;
-  to_find.in.m_id = (isNonTerminal) ? m_factorIdNonTerminal : m_factorId;
-  Set & set = (isNonTerminal) ? m_set : m_setNonTerminal;
-  {
-    // read=lock scope
-#ifdef WITH_THREADS
-    boost::shared_lock<boost::shared_mutex> read_lock(m_accessLock);
-#endif // WITH_THREADS
-    Set::const_iterator i = set.find(to_find);
-    if (i != set.end()) return &i->in;
-  }
-  return NULL;
+  const Table *table = m_tables[isNonTerminal ? 1 : 0].load(boost::memory_order_acquire);
+  return table->Find(factorString, Hash(factorString));
 }
 
+const Factor *FactorCollection::AddFactor(mmt::wid_t wid)
+{
+  boost::atomic<Slot *> &chunkRef = m_wordChunks[wid >> kWordChunkBits];
+  Slot *chunk = chunkRef.load(boost::memory_order_acquire);
+
+  if (chunk) {
+    const Factor *factor = chunk[wid & (kWordChunkSize - 1)].load(boost::memory_order_acquire);
+    if (factor) return factor;
+  } else {
+    Slot *newChunk = new Slot[kWordChunkSize];
+    for (size_t i = 0; i < kWordChunkSize; ++i)
+      newChunk[i].store(NULL, boost::memory_order_relaxed);
+
+    if (chunkRef.compare_exchange_strong(chunk, newChunk, boost::memory_order_acq_rel)) {
+      chunk = newChunk;
+    } else {
+      delete[] newChunk;
+    }
+  }
+
+  char buffer[16];
+  int length = sprintf(buffer, "%u", (unsigned int) wid);
+  const Factor *factor = AddFactor(StringPiece(buffer, length));
 
-FactorCollection::~FactorCollection() {}
+  // racing threads find the same factor, the store is idempotent
+  chunk[wid & (kWordChunkSize - 1)].store(factor, boost::memory_order_release);
+  return factor;
+}
+
+FactorCollection::~FactorCollection()
+{
+  for (size_t i = 0; i < 2; ++i)
+    delete m_tables[i].load(boost::memory_order_relaxed);
+  for (size_t i = 0; i < m_retiredTables.size(); ++i)
+    delete m_retiredTables[i];
+
+  for (size_t i = 0; i < kWordChunkCount; ++i)
+    delete[] m_wordChunks[i].load(boost::memory_order_relaxed);
+  delete[] m_wordChunks;
+}
 
 TO_STRING_BODY(FactorCollection);
 
 // friend
 ostream& operator<<(ostream& out, const FactorCollection& factorCollection)
 {
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(factorCollection.m_accessLock);
-#endif
-  for (FactorCollection::Set::const_iterator i = factorCollection.m_set.begin(); i != factorCollection.m_set.end(); ++i) {
-    out << i->in;
+  for (size_t t = 0; t < 2; ++t) {
+    const FactorCollection::Table *table = factorCollection.m_tables[t].load(boost::memory_order_acquire);
+    for (size_t i = 0; i <= table->mask; ++i) {
+      const Factor *factor = table->slots[i].load(boost::memory_order_acquire);
+      if (factor) out << *factor;
+    }
   }
   return out;
 }
 
 }
-
-
@@ -28,15 +28,18 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #endif
 
 #ifdef WITH_THREADS
-#include <boost/thread/shared_mutex.hpp>
+#include <boost/thread/mutex.hpp>
 #endif
 
-#include "util/murmur_hash.hh"
-#include <boost/unordered_set.hpp>
+#include <boost/atomic.hpp>
 
 #include <functional>
 #include <string>
+#include <vector>
+
+#include <mmt/sentence.h>
 
+#include "util/murmur_hash.hh"
 #include "util/string_piece.hh"
 #include "util/pool.hh"
 #include "Factor.h"
@@ -62,40 +65,56 @@ struct FactorFriend {
  * from being created on the stack, etc), their memory addresses can
  * be used as keys to uniquely identify them.
  * Only 1 FactorCollection object should be created.
+ *
+ * Factors are never removed: lookups go through open addressing tables that
+ * are only appended to, and replaced by bigger copies when half full, so
+ * readers never lock. Inserts are serialized by a mutex.
  */
 class FactorCollection
 {
   friend std::ostream& operator<<(std::ostream&, const FactorCollection&);
 
-  struct HashFactor : public std::unary_function<const FactorFriend &, std::size_t> {
-    std::size_t operator()(const FactorFriend &factor) const {
-      return util::MurmurHashNative(factor.in.m_string.data(), factor.in.m_string.size());
-    }
-  };
-  struct EqualsFactor : public std::binary_function<const FactorFriend &, const FactorFriend &, bool> {
-    bool operator()(const FactorFriend &left, const FactorFriend &right) const {
-      return left.in.GetString() == right.in.GetString();
-    }
+  typedef boost::atomic<const Factor *> Slot;
+
+  struct Table {
+    size_t mask;
+    Slot *slots;
+
+    Table(size_t size);
+    ~Table();
+
+    const Factor *Find(const StringPiece &factorString, size_t hash) const;
+    void Insert(const Factor *factor, size_t hash);
   };
-  typedef boost::unordered_set<FactorFriend, HashFactor, EqualsFactor> Set;
-  Set m_set;
-  Set m_setNonTerminal;
 
+  // one table for terminals, one for non-terminals
+  boost::atomic<Table *> m_tables[2];
+  size_t m_sizes[2];
+  std::vector<Table *> m_retiredTables; /**< replaced tables, lookups may still be running on them */
+
+  // direct access to the factors of MMT word ids, by chunks of 2^kWordChunkBits ids
+  static const size_t kWordChunkBits = 16;
+  static const size_t kWordChunkSize = 1 << kWordChunkBits;
+  static const size_t kWordChunkCount = (((size_t) UINT32_MAX) + 1) >> kWordChunkBits;
+  boost::atomic<Slot *> *m_wordChunks;
+
+  util::Pool m_factor_backing;
   util::Pool m_string_backing;
 
   static FactorCollection s_instance;
 #ifdef WITH_THREADS
-  //reader-writer lock
-  mutable boost::shared_mutex m_accessLock;
+  //writers lock
+  boost::mutex m_insertLock;
 #endif
 
   size_t m_factorIdNonTerminal; /**< unique, contiguous ids, starting from 0, for each non-terminal factor */
   size_t m_factorId; /**< unique, contiguous ids, starting from moses_MaxNumNonterminals, for each terminal factor */
 
   //! constructor. only the 1 static variable can be created
-  FactorCollection()
-    : m_factorIdNonTerminal(0)
-    , m_factorId(moses_MaxNumNonterminals) {
+  FactorCollection();
+
+  static size_t Hash(const StringPiece &factorString) {
+    return util::MurmurHashNative(factorString.data(), factorString.size());
   }
 
 public:
@@ -116,6 +135,9 @@ public:
 
   const Factor *GetFactor(const StringPiece &factorString, bool isNonTerminal = false);
 
+  /** factor of a MMT word id, the same as AddFactor() with the decimal string of the id */
+  const Factor *AddFactor(mmt::wid_t wid);
+
   // TODO: remove calls to this function, replacing them with the simpler AddFactor(factorString)
   const Factor *AddFactor(FactorDirection /*direction*/, FactorType /*factorType*/, const StringPiece &factorString, bool isNonTerminal = false) {
     return AddFactor(factorString, isNonTerminal);
@@ -19,6 +19,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <fstream>
 #include <sstream>
 #include <stdexcept>
@@ -27,6 +28,10 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <boost/thread/locks.hpp>
 #endif // WITH_THREADS
 
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
 #include "FeatureVector.h"
 #include "util/string_piece_hash.hh"
 #include "util/string_stream.hh"
@@ -162,21 +167,158 @@ bool FName::operator!=(const FName& rhs) const
   return ! (*this == rhs);
 }
 
-FVector::FVector(size_t coreFeatures) : m_coreFeatures(coreFeatures) {}
+// element-wise loops over the core features, which are added and multiplied per hypothesis
+
+static void AddCore(FValue *lhs, const FValue *rhs, size_t size)
+{
+  size_t i = 0;
+#ifdef __SSE__
+  for (; i + 4 <= size; i += 4)
+    _mm_storeu_ps(lhs + i, _mm_add_ps(_mm_loadu_ps(lhs + i), _mm_loadu_ps(rhs + i)));
+#endif
+  for (; i < size; ++i)
+    lhs[i] += rhs[i];
+}
+
+static void SubtractCore(FValue *lhs, const FValue *rhs, size_t size)
+{
+  size_t i = 0;
+#ifdef __SSE__
+  for (; i + 4 <= size; i += 4)
+    _mm_storeu_ps(lhs + i, _mm_sub_ps(_mm_loadu_ps(lhs + i), _mm_loadu_ps(rhs + i)));
+#endif
+  for (; i < size; ++i)
+    lhs[i] -= rhs[i];
+}
+
+static FValue InnerProductCore(const FValue *lhs, const FValue *rhs, size_t size)
+{
+  FValue product = 0.0;
+  size_t i = 0;
+#ifdef __SSE__
+  if (size >= 4) {
+    __m128 sum4 = _mm_setzero_ps();
+    for (; i + 4 <= size; i += 4)
+      sum4 = _mm_add_ps(sum4, _mm_mul_ps(_mm_loadu_ps(lhs + i), _mm_loadu_ps(rhs + i)));
+
+    float lanes[4];
+    _mm_storeu_ps(lanes, sum4);
+    product = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+  }
+#endif
+  for (; i < size; ++i)
+    product += lhs[i] * rhs[i];
+  return product;
+}
+
+FVector::FVector(size_t coreFeatures)
+  : m_coreFeatures(m_inlineCoreFeatures), m_coreSize(0), m_features(NULL)
+{
+  resize(coreFeatures);
+}
+
+FVector::FVector(const FVector& rhs)
+  : m_coreFeatures(m_inlineCoreFeatures), m_coreSize(0), m_features(NULL)
+{
+  assignCore(rhs.m_coreFeatures, rhs.m_coreSize);
+  if (rhs.m_features && !rhs.m_features->empty())
+    m_features = new FNVmap(*rhs.m_features);
+}
+
+FVector::~FVector()
+{
+  if (!isInline())
+    delete[] m_coreFeatures;
+  delete m_features;
+}
+
+FVector& FVector::operator=( const FVector& rhs )
+{
+  if (this == &rhs)
+    return *this;
+
+  assignCore(rhs.m_coreFeatures, rhs.m_coreSize);
+  if (rhs.m_features && !rhs.m_features->empty())
+    sparse() = *rhs.m_features;
+  else if (m_features)
+    m_features->clear();
+  return *this;
+}
+
+void FVector::assignCore(const FValue *values, size_t size)
+{
+  if (size != m_coreSize) {
+    if (!isInline())
+      delete[] m_coreFeatures;
+    m_coreFeatures = (size <= MAX_NUM_DENSE_FEATURES) ? m_inlineCoreFeatures : new FValue[size];
+    m_coreSize = size;
+  }
+  if (size)
+    memcpy(m_coreFeatures, values, size * sizeof(FValue));
+}
+
+FVector::FNVmap &FVector::sparse()
+{
+  if (!m_features)
+    m_features = new FNVmap();
+  return *m_features;
+}
+
+FVector::FNVmap &FVector::emptySparse()
+{
+  // never modified, only iterated
+  static FNVmap empty;
+  return empty;
+}
+
+void FVector::swap(FVector &other)
+{
+  std::swap(m_features, other.m_features);
+
+  if (!isInline() && !other.isInline()) {
+    std::swap(m_coreFeatures, other.m_coreFeatures);
+    std::swap(m_coreSize, other.m_coreSize);
+  } else {
+    // at least one side is inline, so its values fit a buffer of the same size
+    FVector &inlined = isInline() ? *this : other;
+    FVector &rest = isInline() ? other : *this;
+    FValue values[MAX_NUM_DENSE_FEATURES];
+    const size_t size = inlined.m_coreSize;
+    std::copy(inlined.m_coreFeatures, inlined.m_coreFeatures + size, values);
+    inlined.assignCore(rest.m_coreFeatures, rest.m_coreSize);
+    rest.assignCore(values, size);
+  }
+}
 
 void FVector::resize(size_t newsize)
 {
-  valarray<FValue> oldValues(m_coreFeatures);
-  m_coreFeatures.resize(newsize);
-  for (size_t i = 0; i < min(m_coreFeatures.size(), oldValues.size()); ++i) {
-    m_coreFeatures[i] = oldValues[i];
+  if (newsize == m_coreSize)
+    return;
+
+  FValue *oldValues = m_coreFeatures;
+  const bool oldInline = isInline();
+  const size_t kept = min(m_coreSize, newsize);
+
+  if (newsize <= MAX_NUM_DENSE_FEATURES) {
+    m_coreFeatures = m_inlineCoreFeatures;
+    if (!oldInline)
+      std::copy(oldValues, oldValues + kept, m_coreFeatures);
+  } else {
+    m_coreFeatures = new FValue[newsize];
+    std::copy(oldValues, oldValues + kept, m_coreFeatures);
   }
+  std::fill(m_coreFeatures + kept, m_coreFeatures + newsize, 0);
+  m_coreSize = newsize;
+
+  if (!oldInline)
+    delete[] oldValues;
 }
 
 void FVector::clear()
 {
-  m_coreFeatures.resize(m_coreFeatures.size(), 0);
-  m_features.clear();
+  std::fill(m_coreFeatures, m_coreFeatures + m_coreSize, 0);
+  if (m_features)
+    m_features->clear();
 }
 
 bool FVector::load(const std::string& filename)
@@ -235,10 +377,10 @@ bool FVector::operator== (const FVector& rhs) const
   if (this == &rhs) {
     return true;
   }
-  if (m_coreFeatures.size() != rhs.m_coreFeatures.size()) {
+  if (m_coreSize != rhs.m_coreSize) {
     return false;
   }
-  for (size_t i = 0; i < m_coreFeatures.size(); ++i) {
+  for (size_t i = 0; i < m_coreSize; ++i) {
     if (!equalsTolerance(m_coreFeatures[i], rhs.m_coreFeatures[i])) return false;
   }
   for (const_iterator i  = cbegin(); i != cend(); ++i) {
@@ -282,9 +424,9 @@ FValue FVector::operator[](size_t index) const
 ostream& FVector::print(ostream& out) const
 {
   out << "core=(";
-  for (size_t i = 0; i < m_coreFeatures.size(); ++i) {
+  for (size_t i = 0; i < m_coreSize; ++i) {
     out << m_coreFeatures[i];
-    if (i + 1 < m_coreFeatures.size()) {
+    if (i + 1 < m_coreSize) {
       out << ",";
     }
   }
@@ -305,8 +447,10 @@ ostream& operator<<(ostream& out, const FVector& fv)
 const FValue& FVector::get(const FName& name) const
 {
   static const FValue DEFAULT = 0;
-  const_iterator fi = m_features.find(name);
-  if (fi == m_features.end()) {
+  if (!m_features)
+    return DEFAULT;
+  const_iterator fi = m_features->find(name);
+  if (fi == m_features->end()) {
     return DEFAULT;
   } else {
     return fi->second;
@@ -315,8 +459,10 @@ const FValue& FVector::get(const FName& name) const
 
 FValue FVector::getBackoff(const FName& name, float backoff) const
 {
-  const_iterator fi = m_features.find(name);
-  if (fi == m_features.end()) {
+  if (!m_features)
+    return backoff;
+  const_iterator fi = m_features->find(name);
+  if (fi == m_features->end()) {
     return backoff;
   } else {
     return fi->second;
@@ -351,15 +497,15 @@ void FVector::capMin(FValue minValue)
 
 void FVector::set(const FName& name, const FValue& value)
 {
-  m_features[name] = value;
+  sparse()[name] = value;
 }
 
 void FVector::printCoreFeatures()
 {
   cerr << "core=(";
-  for (size_t i = 0; i < m_coreFeatures.size(); ++i) {
+  for (size_t i = 0; i < m_coreSize; ++i) {
     cerr << m_coreFeatures[i];
-    if (i + 1 < m_coreFeatures.size()) {
+    if (i + 1 < m_coreSize) {
       cerr << ",";
     }
   }
@@ -368,12 +514,11 @@ void FVector::printCoreFeatures()
 
 FVector& FVector::operator+= (const FVector& rhs)
 {
-  if (rhs.m_coreFeatures.size() > m_coreFeatures.size())
-    resize(rhs.m_coreFeatures.size());
+  if (rhs.m_coreSize > m_coreSize)
+    resize(rhs.m_coreSize);
   for (const_iterator i = rhs.cbegin(); i != rhs.cend(); ++i)
     set(i->first, get(i->first) + i->second);
-  for (size_t i = 0; i < rhs.m_coreFeatures.size(); ++i)
-    m_coreFeatures[i] += rhs.m_coreFeatures[i];
+  AddCore(m_coreFeatures, rhs.m_coreFeatures, rhs.m_coreSize);
   return *this;
 }
 
@@ -387,16 +532,15 @@ void FVector::sparsePlusEquals(const FVector& rhs)
 // add only core features
 void FVector::corePlusEquals(const FVector& rhs)
 {
-  if (rhs.m_coreFeatures.size() > m_coreFeatures.size())
-    resize(rhs.m_coreFeatures.size());
-  for (size_t i = 0; i < rhs.m_coreFeatures.size(); ++i)
-    m_coreFeatures[i] += rhs.m_coreFeatures[i];
+  if (rhs.m_coreSize > m_coreSize)
+    resize(rhs.m_coreSize);
+  AddCore(m_coreFeatures, rhs.m_coreFeatures, rhs.m_coreSize);
 }
 
 // assign only core features
 void FVector::coreAssign(const FVector& rhs)
 {
-  for (size_t i = 0; i < rhs.m_coreFeatures.size(); ++i)
+  for (size_t i = 0; i < rhs.m_coreSize; ++i)
     m_coreFeatures[i] = rhs.m_coreFeatures[i];
 }
 
@@ -451,7 +595,7 @@ size_t FVector::pruneSparseFeatures(size_t threshold)
   }
 
   for (size_t i = 0; i < toErase.size(); ++i)
-    m_features.erase(toErase[i]);
+    m_features->erase(toErase[i]);
 
   return count;
 }
@@ -471,14 +615,14 @@ size_t FVector::pruneZeroWeightFeatures()
   }
 
   for (size_t i = 0; i < toErase.size(); ++i)
-    m_features.erase(toErase[i]);
+    m_features->erase(toErase[i]);
 
   return count;
 }
 
 void FVector::updateConfidenceCounts(const FVector& weightUpdate, bool signedCounts)
 {
-  for (size_t i = 0; i < weightUpdate.m_coreFeatures.size(); ++i) {
+  for (size_t i = 0; i < weightUpdate.m_coreSize; ++i) {
     if (signedCounts) {
       //int sign = weightUpdate.m_coreFeatures[i] >= 0 ? 1 : -1;
       //m_coreFeatures[i] += (weightUpdate.m_coreFeatures[i] * weightUpdate.m_coreFeatures[i]) * sign;
@@ -505,7 +649,7 @@ void FVector::updateConfidenceCounts(const FVector& weightUpdate, bool signedCou
 
 void FVector::updateLearningRates(float decay_core, float decay_sparse, const FVector &confidenceCounts, float core_r0, float sparse_r0)
 {
-  for (size_t i = 0; i < confidenceCounts.m_coreFeatures.size(); ++i) {
+  for (size_t i = 0; i < confidenceCounts.m_coreSize; ++i) {
     m_coreFeatures[i] = 1.0/(1.0/core_r0 + decay_core * abs(confidenceCounts.m_coreFeatures[i]));
   }
 
@@ -521,14 +665,14 @@ void FVector::setToBinaryOf(const FVector& rhs)
   for (const_iterator i = rhs.cbegin(); i != rhs.cend(); ++i)
     if (rhs.get(i->first) != 0)
       set(i->first, 1);
-  for (size_t i = 0; i < rhs.m_coreFeatures.size(); ++i)
+  for (size_t i = 0; i < rhs.m_coreSize; ++i)
     m_coreFeatures[i] = 1;
 }
 
 // divide only core features by scalar
 FVector& FVector::coreDivideEquals(float scalar)
 {
-  for (size_t i = 0; i < m_coreFeatures.size(); ++i)
+  for (size_t i = 0; i < m_coreSize; ++i)
     m_coreFeatures[i] /= scalar;
   return *this;
 }
@@ -536,40 +680,36 @@ FVector& FVector::coreDivideEquals(float scalar)
 // lhs vector is a sum of vectors, rhs vector holds number of non-zero summands
 FVector& FVector::divideEquals(const FVector& rhs)
 {
-  assert(m_coreFeatures.size() == rhs.m_coreFeatures.size());
+  assert(m_coreSize == rhs.m_coreSize);
   for (const_iterator i = rhs.cbegin(); i != rhs.cend(); ++i)
     set(i->first, get(i->first)/rhs.get(i->first)); // divide by number of summands
-  for (size_t i = 0; i < rhs.m_coreFeatures.size(); ++i)
+  for (size_t i = 0; i < rhs.m_coreSize; ++i)
     m_coreFeatures[i] /= rhs.m_coreFeatures[i]; // divide by number of summands
   return *this;
 }
 
 FVector& FVector::operator-= (const FVector& rhs)
 {
-  if (rhs.m_coreFeatures.size() > m_coreFeatures.size())
-    resize(rhs.m_coreFeatures.size());
+  if (rhs.m_coreSize > m_coreSize)
+    resize(rhs.m_coreSize);
   for (const_iterator i = rhs.cbegin(); i != rhs.cend(); ++i)
     set(i->first, get(i->first) -(i->second));
-  for (size_t i = 0; i < m_coreFeatures.size(); ++i) {
-    if (i < rhs.m_coreFeatures.size()) {
-      m_coreFeatures[i] -= rhs.m_coreFeatures[i];
-    }
-  }
+  SubtractCore(m_coreFeatures, rhs.m_coreFeatures, rhs.m_coreSize);
   return *this;
 }
 
 FVector& FVector::operator*= (const FVector& rhs)
 {
-  if (rhs.m_coreFeatures.size() > m_coreFeatures.size()) {
-    resize(rhs.m_coreFeatures.size());
+  if (rhs.m_coreSize > m_coreSize) {
+    resize(rhs.m_coreSize);
   }
   for (iterator i = begin(); i != end(); ++i) {
     FValue lhsValue = i->second;
     FValue rhsValue = rhs.get(i->first);
     set(i->first,lhsValue*rhsValue);
   }
-  for (size_t i = 0; i < m_coreFeatures.size(); ++i) {
-    if (i < rhs.m_coreFeatures.size()) {
+  for (size_t i = 0; i < m_coreSize; ++i) {
+    if (i < rhs.m_coreSize) {
       m_coreFeatures[i] *= rhs.m_coreFeatures[i];
     } else {
       m_coreFeatures[i] = 0;
@@ -580,16 +720,16 @@ FVector& FVector::operator*= (const FVector& rhs)
 
 FVector& FVector::operator/= (const FVector& rhs)
 {
-  if (rhs.m_coreFeatures.size() > m_coreFeatures.size()) {
-    resize(rhs.m_coreFeatures.size());
+  if (rhs.m_coreSize > m_coreSize) {
+    resize(rhs.m_coreSize);
   }
   for (iterator i = begin(); i != end(); ++i) {
     FValue lhsValue = i->second;
     FValue rhsValue = rhs.get(i->first);
     set(i->first, lhsValue / rhsValue) ;
   }
-  for (size_t i = 0; i < m_coreFeatures.size(); ++i) {
-    if (i < rhs.m_coreFeatures.size()) {
+  for (size_t i = 0; i < m_coreSize; ++i) {
+    if (i < rhs.m_coreSize) {
       m_coreFeatures[i] /= rhs.m_coreFeatures[i];
     } else {
       if (m_coreFeatures[i] < 0) {
@@ -608,7 +748,8 @@ FVector& FVector::operator*= (const FValue& rhs)
   for (iterator i = begin(); i != end(); ++i) {
     i->second *= rhs;
   }
-  m_coreFeatures *= rhs;
+  for (size_t i = 0; i < m_coreSize; ++i)
+    m_coreFeatures[i] *= rhs;
   return *this;
 }
 
@@ -617,22 +758,23 @@ FVector& FVector::operator/= (const FValue& rhs)
   for (iterator i = begin(); i != end(); ++i) {
     i->second /= rhs;
   }
-  m_coreFeatures /= rhs;
+  for (size_t i = 0; i < m_coreSize; ++i)
+    m_coreFeatures[i] /= rhs;
   return *this;
 }
 
 FVector& FVector::multiplyEqualsBackoff(const FVector& rhs, float backoff)
 {
-  if (rhs.m_coreFeatures.size() > m_coreFeatures.size()) {
-    resize(rhs.m_coreFeatures.size());
+  if (rhs.m_coreSize > m_coreSize) {
+    resize(rhs.m_coreSize);
   }
   for (iterator i = begin(); i != end(); ++i) {
     FValue lhsValue = i->second;
     FValue rhsValue = rhs.getBackoff(i->first, backoff);
     set(i->first,lhsValue*rhsValue);
   }
-  for (size_t i = 0; i < m_coreFeatures.size(); ++i) {
-    if (i < rhs.m_coreFeatures.size()) {
+  for (size_t i = 0; i < m_coreSize; ++i) {
+    if (i < rhs.m_coreSize) {
       m_coreFeatures[i] *= rhs.m_coreFeatures[i];
     } else {
       m_coreFeatures[i] = 0;
@@ -643,7 +785,7 @@ FVector& FVector::multiplyEqualsBackoff(const FVector& rhs, float backoff)
 
 FVector& FVector::multiplyEquals(float core_r0, float sparse_r0)
 {
-  for (size_t i = 0; i < m_coreFeatures.size(); ++i) {
+  for (size_t i = 0; i < m_coreSize; ++i) {
     m_coreFeatures[i] *= core_r0;
   }
   for (iterator i = begin(); i != end(); ++i)
@@ -657,7 +799,7 @@ FValue FVector::l1norm() const
   for (const_iterator i = cbegin(); i != cend(); ++i) {
     norm += abs(i->second);
   }
-  for (size_t i = 0; i < m_coreFeatures.size(); ++i) {
+  for (size_t i = 0; i < m_coreSize; ++i) {
     norm += abs(m_coreFeatures[i]);
   }
   return norm;
@@ -667,7 +809,7 @@ FValue FVector::l1norm_coreFeatures() const
 {
   FValue norm = 0;
   // ignore Bleu score feature (last feature)
-  for (size_t i = 0; i < m_coreFeatures.size()-1; ++i)
+  for (size_t i = 0; i < m_coreSize-1; ++i)
     norm += abs(m_coreFeatures[i]);
   return norm;
 }
@@ -685,7 +827,7 @@ FValue FVector::linfnorm() const
     if (absValue > norm)
       norm = absValue;
   }
-  for (size_t i = 0; i < m_coreFeatures.size(); ++i) {
+  for (size_t i = 0; i < m_coreSize; ++i) {
     float absValue = abs(m_coreFeatures[i]);
     if (absValue > norm)
       norm = absValue;
@@ -695,7 +837,7 @@ FValue FVector::linfnorm() const
 
 size_t FVector::l1regularize(float lambda)
 {
-  for (size_t i = 0; i < m_coreFeatures.size(); ++i) {
+  for (size_t i = 0; i < m_coreSize; ++i) {
     float value = m_coreFeatures[i];
     if (value > 0) {
       m_coreFeatures[i] = max(0.0f, value - lambda);
@@ -726,14 +868,14 @@ size_t FVector::l1regularize(float lambda)
 
   // erase features that have become zero
   for (size_t i = 0; i < toErase.size(); ++i)
-    m_features.erase(toErase[i]);
+    m_features->erase(toErase[i]);
   numberPruned -= size();
   return numberPruned;
 }
 
 void FVector::l2regularize(float lambda)
 {
-  for (size_t i = 0; i < m_coreFeatures.size(); ++i) {
+  for (size_t i = 0; i < m_coreSize; ++i) {
     m_coreFeatures[i] *= (1 - lambda);
   }
 
@@ -744,7 +886,7 @@ void FVector::l2regularize(float lambda)
 
 size_t FVector::sparseL1regularize(float lambda)
 {
-  /*for (size_t i = 0; i < m_coreFeatures.size(); ++i) {
+  /*for (size_t i = 0; i < m_coreSize; ++i) {
     float value = m_coreFeatures[i];
     if (value > 0) {
       m_coreFeatures[i] = max(0.0f, value - lambda);
@@ -776,14 +918,14 @@ size_t FVector::sparseL1regularize(float lambda)
 
   // erase features that have become zero
   for (size_t i = 0; i < toErase.size(); ++i)
-    m_features.erase(toErase[i]);
+    m_features->erase(toErase[i]);
   numberPruned -= size();
   return numberPruned;
 }
 
 void FVector::sparseL2regularize(float lambda)
 {
-  /*for (size_t i = 0; i < m_coreFeatures.size(); ++i) {
+  /*for (size_t i = 0; i < m_coreSize; ++i) {
     m_coreFeatures[i] *= (1 - lambda);
     }*/
 
@@ -798,27 +940,28 @@ FValue FVector::sum() const
   for (const_iterator i = cbegin(); i != cend(); ++i) {
     sum += i->second;
   }
-  sum += m_coreFeatures.sum();
+  for (size_t i = 0; i < m_coreSize; ++i)
+    sum += m_coreFeatures[i];
   return sum;
 }
 
 FValue FVector::inner_product(const FVector& rhs) const
 {
-  assert(m_coreFeatures.size() == rhs.m_coreFeatures.size());
+  assert(m_coreSize == rhs.m_coreSize);
   FValue product = 0.0;
-  for (const_iterator i = cbegin(); i != cend(); ++i) {
-    product += ((i->second)*(rhs.get(i->first)));
-  }
-  for (size_t i = 0; i < m_coreFeatures.size(); ++i) {
-    product += m_coreFeatures[i]*rhs.m_coreFeatures[i];
+  if (m_features) {
+    for (const_iterator i = cbegin(); i != cend(); ++i) {
+      product += ((i->second)*(rhs.get(i->first)));
+    }
   }
+  product += InnerProductCore(m_coreFeatures, rhs.m_coreFeatures, m_coreSize);
   return product;
 }
 
 void FVector::merge(const FVector &other)
 {
   // dense
-  for (size_t i = 0; i < m_coreFeatures.size(); ++i) {
+  for (size_t i = 0; i < m_coreSize; ++i) {
     FValue &thisVal = m_coreFeatures[i];
     const FValue otherVal = other.m_coreFeatures[i];
 
@@ -830,10 +973,10 @@ void FVector::merge(const FVector &other)
 
   // sparse
   FNVmap::const_iterator iter;
-  for (iter = other.m_features.begin(); iter != other.m_features.end(); ++iter) {
+  for (iter = other.cbegin(); iter != other.cend(); ++iter) {
     const FName  &otherKey = iter->first;
     const FValue otherVal = iter->second;
-    m_features[otherKey] = otherVal;
+    sparse()[otherKey] = otherVal;
   }
 }
 
@@ -26,7 +26,6 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <map>
 #include <sstream>
 #include <string>
-#include <valarray>
 #include <vector>
 
 #include <boost/functional/hash.hpp>
@@ -37,7 +36,6 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <boost/serialization/split_member.hpp>
 #include <boost/serialization/string.hpp>
 #include <boost/serialization/vector.hpp>
-#include <boost/serialization/valarray.hpp>
 #endif
 
 #ifdef WITH_THREADS
@@ -47,6 +45,12 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "util/exception.hh"
 #include "util/string_piece.hh"
 
+// Dense (core) features live inside the FVector up to this many, and on the heap beyond.
+// Set by the build system to the size of the model, like MAX_NUM_FACTORS.
+#ifndef MAX_NUM_DENSE_FEATURES
+#define MAX_NUM_DENSE_FEATURES 32
+#endif
+
 namespace Moses
 {
 
@@ -122,19 +126,18 @@ struct FNameHash
 class ProxyFVector;
 
 /**
- * A sparse feature (or weight) vector.
+ * A feature (or weight) vector: a dense array of core features, followed by
+ * sparse features that are only allocated when the first one is set.
  **/
 class FVector
 {
 public:
   /** Empty feature vector */
   FVector(size_t coreFeatures = 0);
+  FVector(const FVector& rhs);
+  ~FVector();
 
-  FVector& operator=( const FVector& rhs ) {
-    m_features = rhs.m_features;
-    m_coreFeatures = rhs.m_coreFeatures;
-    return *this;
-  }
+  FVector& operator=( const FVector& rhs );
 
   /*
    * Change the number of core features
@@ -146,20 +149,20 @@ public:
   typedef FNVmap::iterator iterator;
   typedef FNVmap::const_iterator const_iterator;
   iterator begin() {
-    return m_features.begin();
+    return m_features ? m_features->begin() : emptySparse().begin();
   }
   iterator end() {
-    return m_features.end();
+    return m_features ? m_features->end() : emptySparse().end();
   }
   const_iterator cbegin() const {
-    return m_features.cbegin();
+    return m_features ? m_features->cbegin() : emptySparse().cbegin();
   }
   const_iterator cend() const {
-    return m_features.cend();
+    return m_features ? m_features->cend() : emptySparse().cend();
   }
 
   bool hasNonDefaultValue(FName name) const {
-    return m_features.find(name) != m_features.end();
+    return m_features && m_features->find(name) != m_features->end();
   }
   void clear();
 
@@ -177,15 +180,11 @@ public:
 
   /** Size */
   size_t size() const {
-    return m_features.size() + m_coreFeatures.size();
+    return (m_features ? m_features->size() : 0) + m_coreSize;
   }
 
   size_t coreSize() const {
-    return m_coreFeatures.size();
-  }
-
-  const std::valarray<FValue> &getCoreFeatures() const {
-    return m_coreFeatures;
+    return m_coreSize;
   }
 
   /** Equality */
@@ -260,6 +259,8 @@ public:
 
   void merge(const FVector &other);
 
+  void swap(FVector &other);
+
 #ifdef MPI_ENABLE
   friend class boost::serialization::access;
 #endif
@@ -272,8 +273,21 @@ private:
   FValue getBackoff(const FName& name, float backoff) const;
   void set(const FName& name, const FValue& value);
 
-  FNVmap m_features;
-  std::valarray<FValue> m_coreFeatures;
+  //! the sparse features, allocated on first use
+  FNVmap &sparse();
+  //! iterated over when there are no sparse features
+  static FNVmap &emptySparse();
+
+  bool isInline() const {
+    return m_coreFeatures == m_inlineCoreFeatures;
+  }
+  //! sets size and values of the core features
+  void assignCore(const FValue *values, size_t size);
+
+  FValue *m_coreFeatures; //! m_inlineCoreFeatures, or a heap array if there are more
+  size_t m_coreSize;
+  FNVmap *m_features; //! NULL until a sparse feature is set
+  FValue m_inlineCoreFeatures[MAX_NUM_DENSE_FEATURES];
 
 #ifdef MPI_ENABLE
   //serialization
@@ -287,9 +301,10 @@ private:
       names.push_back(ostr.str());
       values.push_back(i->second);
     }
+    std::vector<FValue> core(m_coreFeatures, m_coreFeatures + m_coreSize);
     ar << names;
     ar << values;
-    ar << m_coreFeatures;
+    ar << core;
   }
 
   template<class Archive>
@@ -297,9 +312,11 @@ private:
     clear();
     std::vector<std::string> names;
     std::vector<FValue> values;
+    std::vector<FValue> core;
     ar >> names;
     ar >> values;
-    ar >> m_coreFeatures;
+    ar >> core;
+    assignCore(core.empty() ? NULL : &core[0], core.size());
     UTIL_THROW_IF2(names.size() != values.size(), "Error");
     for (size_t i = 0; i < names.size(); ++i) {
       set(FName(names[i]), values[i]);
@@ -314,8 +331,7 @@ private:
 
 inline void swap(FVector &first, FVector &second)
 {
-  swap(first.m_features, second.m_features);
-  swap(first.m_coreFeatures, second.m_coreFeatures);
+  first.swap(second);
 }
 
 std::ostream& operator<<( std::ostream& out, const FVector& fv);
@@ -363,19 +379,19 @@ public:
   }
 
   /*operator FValue&() {
-   return m_fv->m_features[m_name];
+   return m_fv->sparse()[m_name];
    }*/
 
   FValue operator++() {
-    return ++m_fv->m_features[m_name];
+    return ++m_fv->sparse()[m_name];
   }
 
   FValue operator +=(FValue lhs) {
-    return (m_fv->m_features[m_name] += lhs);
+    return (m_fv->sparse()[m_name] += lhs);
   }
 
   FValue operator -=(FValue lhs) {
-    return (m_fv->m_features[m_name] -= lhs);
+    return (m_fv->sparse()[m_name] -= lhs);
   }
 
 private:
@@ -306,6 +306,40 @@ BOOST_AUTO_TEST_CASE(ip)
   BOOST_CHECK_CLOSE((FValue)p1, 1.1*0.5 + -0.1*0.25 + 2.2*2.4, TOL);
 }
 
+BOOST_AUTO_TEST_CASE(core_storage)
+{
+  // one vector fits the inline storage, the other does not
+  const size_t large = MAX_NUM_DENSE_FEATURES + 5;
+  FVector f1(3);
+  FVector f2(large);
+  FName n1("a");
+  for (size_t i = 0; i < large; ++i)
+    f2[i] = i;
+  f1[0] = -1;
+  f1[n1] = 0.5;
+
+  FVector copy1(f1);
+  FVector copy2(f2);
+  BOOST_CHECK_EQUAL(copy1, f1);
+  BOOST_CHECK_EQUAL(copy2, f2);
+
+  swap(f1, f2);
+  BOOST_CHECK_EQUAL(f1, copy2);
+  BOOST_CHECK_EQUAL(f2, copy1);
+  BOOST_CHECK_EQUAL(f1.size(), large);
+  BOOST_CHECK_EQUAL(f2.size(), 4);
+
+  f2 += f1;
+  BOOST_CHECK_EQUAL(f2.coreSize(), large);
+  BOOST_CHECK_CLOSE((FValue)f2[0], -1, TOL);
+  BOOST_CHECK_CLOSE((FValue)f2[large - 1], large - 1, TOL);
+  BOOST_CHECK_CLOSE((FValue)f2[n1], 0.5, TOL);
+
+  f2 -= f1;
+  f2.resize(3);
+  BOOST_CHECK_EQUAL(f2, copy1);
+}
+
 
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -60,14 +60,16 @@ Hypothesis(Manager& manager, InputType const& source, const TranslationOption &i
   , m_transOpt(initialTransOpt)
   , m_manager(manager)
   , m_id(id)
+  , m_recombinationHash(0)
 {
   // used for initial seeding of trans process
   // initialize scores
-  //_hash_computed = false;
   //s_HypothesesCreated = 1;
   const vector<const StatefulFeatureFunction*>& ffs = StatefulFeatureFunction::GetStatefulFeatureFunctions();
   for (unsigned i = 0; i < ffs.size(); ++i)
     m_ffStates[i] = ffs[i]->EmptyHypothesisState(source);
+
+  ComputeRecombinationHash();
 }
 
 /***
@@ -90,8 +92,10 @@ Hypothesis(const Hypothesis &prevHypo, const TranslationOption &transOpt, const
   , m_transOpt(transOpt)
   , m_manager(prevHypo.GetManager())
   , m_id(id)
+  , m_recombinationHash(0)
 {
-  m_currScoreBreakdown.PlusEquals(transOpt.GetScoreBreakdown());
+  // the scores of transOpt are not copied: they enter the total through its weighted
+  // score, the breakdown is only materialized by GetScoreBreakdown()
   m_wordDeleted = transOpt.IsDeletionOption();
 }
 
@@ -106,9 +110,7 @@ Hypothesis::
     for (iter = m_arcList->begin() ; iter != m_arcList->end() ; ++iter) {
       delete *iter;
     }
-    m_arcList->clear();
-
-    delete m_arcList;
+    m_manager.GetHypothesisPool().ReleaseArcList(m_arcList);
     m_arcList = NULL;
   }
 }
@@ -122,7 +124,7 @@ AddArc(Hypothesis *loserHypo)
       this->m_arcList = loserHypo->m_arcList;  // take ownership, we'll delete
       loserHypo->m_arcList = 0;                // prevent a double deletion
     } else {
-      this->m_arcList = new ArcList();
+      this->m_arcList = m_manager.GetHypothesisPool().NewArcList();
     }
   } else {
     if (loserHypo->m_arcList) {  // both have an arc list: merge. delete loser
@@ -130,7 +132,7 @@ AddArc(Hypothesis *loserHypo)
       size_t add_size = loserHypo->m_arcList->size();
       this->m_arcList->resize(my_size + add_size, 0);
       std::memcpy(&(*m_arcList)[0] + my_size, &(*loserHypo->m_arcList)[0], add_size * sizeof(Hypothesis *));
-      delete loserHypo->m_arcList;
+      m_manager.GetHypothesisPool().ReleaseArcList(loserHypo->m_arcList);
       loserHypo->m_arcList = 0;
     } else { // loserHypo doesn't have any arcs
       // DO NOTHING
@@ -149,9 +151,9 @@ EvaluateWhenApplied(float estimatedScore, const ScoreComponentCollection& weight
   const StaticData &staticData = StaticData::Instance();
 
   // some stateless score producers cache their values in the translation
-  // option: add these here
+  // option: they are added below, already weighted
   // language model scores for n-grams completely contained within a target
-  // phrase are also included here
+  // phrase are also included there
 
   // compute values of stateless feature functions that were not
   // cached in the translation option
@@ -178,8 +180,23 @@ EvaluateWhenApplied(float estimatedScore, const ScoreComponentCollection& weight
   m_estimatedScore = estimatedScore;
 
   // TOTAL
-  m_futureScore = m_currScoreBreakdown.GetWeightedScore(weights) + m_estimatedScore;
+  m_futureScore = m_transOpt.GetWeightedScore() + m_currScoreBreakdown.GetWeightedScore(weights) + m_estimatedScore;
   if (m_prevHypo) m_futureScore += m_prevHypo->GetScore();
+
+  ComputeRecombinationHash();
+}
+
+const ScoreComponentCollection& Hypothesis::GetScoreBreakdown() const
+{
+  if (!m_scoreBreakdown) {
+    m_scoreBreakdown.reset(new ScoreComponentCollection);
+    m_scoreBreakdown->PlusEquals(m_transOpt.GetScoreBreakdown());
+    m_scoreBreakdown->PlusEquals(m_currScoreBreakdown);
+    if (m_prevHypo) {
+      m_scoreBreakdown->PlusEquals(m_prevHypo->GetScoreBreakdown());
+    }
+  }
+  return *(m_scoreBreakdown.get());
 }
 
 const Hypothesis* Hypothesis::GetPrevHypo()const
@@ -223,7 +240,7 @@ PrintHypothesis() const
   //	TRACE_ERR( "\tlanguage model cost "); // <<m_score[ScoreType::LanguageModelScore]<<endl;
   //	TRACE_ERR( "\tword penalty "); // <<(m_score[ScoreType::WordPenalty]*weightWordPenalty)<<endl;
   TRACE_ERR( "\tscore "<<m_futureScore - m_estimatedScore<<" + future cost "<<m_estimatedScore<<" = "<<m_futureScore<<endl);
-  TRACE_ERR(  "\tunweighted feature scores: " << m_currScoreBreakdown << endl);
+  TRACE_ERR(  "\tunweighted feature scores: " << m_transOpt.GetScoreBreakdown() << " + " << m_currScoreBreakdown << endl);
   //PrintLMScores();
 }
 
@@ -393,7 +410,7 @@ GetPlaceholders(const Hypothesis &hypo, FactorType placeholderFactor) const
   return ret;
 }
 
-size_t Hypothesis::hash() const
+void Hypothesis::ComputeRecombinationHash()
 {
   size_t seed;
 
@@ -410,10 +427,18 @@ size_t Hypothesis::hash() const
   // states
   for (size_t i = 0; i < m_ffStates.size(); ++i) {
     const FFState *state = m_ffStates[i];
-    size_t hash = state->hash();
+    size_t hash = state ? state->hash() : 0;
     boost::hash_combine(seed, hash);
   }
-  return seed;
+
+  // final mix, the recombination set indexes its slots with the low bits
+  uint64_t h = seed;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  m_recombinationHash = h;
 }
 
 bool Hypothesis::operator==(const Hypothesis& other) const
@@ -36,6 +36,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "ScoreComponentCollection.h"
 #include "InputType.h"
 #include "ObjectPool.h"
+#include "HypothesisPool.h"
 #include "xmlrpc-c.h"
 
 namespace Moses
@@ -45,15 +46,12 @@ class SquareMatrix;
 class StaticData;
 class TranslationOption;
 class Range;
-class Hypothesis;
 class FFState;
 class StatelessFeatureFunction;
 class StatefulFeatureFunction;
 class Manager;
 struct ReportingOptions;
 
-typedef std::vector<Hypothesis*> ArcList;
-
 /** Used to store a state in the beam search
     for the best translation. With its link back to the previous hypothesis
     m_prevHypo, we can trace back to the sentence start to read of the
@@ -76,7 +74,7 @@ protected:
   float							m_estimatedScore; /*! estimated future cost to translate rest of sentence */
   /*! sum of scores of this hypothesis, and previous hypotheses. Lazily initialised.  */
   mutable boost::scoped_ptr<ScoreComponentCollection> m_scoreBreakdown;
-  ScoreComponentCollection m_currScoreBreakdown; /*! scores for this hypothesis only */
+  ScoreComponentCollection m_currScoreBreakdown; /*! scores for this hypothesis only, without the ones cached in the translation option */
   std::vector<const FFState*> m_ffStates;
   const Hypothesis 	*m_winningHypo;
   ArcList 					*m_arcList; /*! all arcs that end at the same trellis point as this hypothesis */
@@ -84,6 +82,9 @@ protected:
   Manager& m_manager;
 
   int m_id; /*! numeric ID of this hypothesis, used for logging */
+  uint64_t m_recombinationHash; /*! fingerprint of coverage and FF states, computed once the states are final */
+
+  void ComputeRecombinationHash();
 
 public:
   /*! used by initial seeding of the translation process */
@@ -92,6 +93,21 @@ public:
   Hypothesis(const Hypothesis &prevHypo, const TranslationOption &transOpt, const Bitmap &bitmap, int id);
   ~Hypothesis();
 
+  /*! allocation from the Manager's pool: new (manager.GetHypothesisPool()) Hypothesis(...) */
+  static void *operator new(size_t size, HypothesisPool &pool) {
+    return pool.Allocate(size);
+  }
+  static void *operator new(size_t size) {
+    return HypothesisPool::AllocateUnpooled(size);
+  }
+  /*! plain delete works for both pooled and unpooled hypotheses */
+  static void operator delete(void *ptr) {
+    HypothesisPool::Release(ptr);
+  }
+  static void operator delete(void *ptr, HypothesisPool &) {
+    HypothesisPool::Release(ptr);
+  }
+
   void PrintHypothesis() const;
 
   const InputType& GetInput() const {
@@ -122,6 +138,9 @@ public:
 
   void EvaluateWhenApplied(float estimatedScore, const ScoreComponentCollection& weights);
 
+  void SetId(int id) {
+    m_id = id;
+  }
   int GetId()const {
     return m_id;
   }
@@ -208,16 +227,7 @@ public:
   inline const ArcList* GetArcList() const {
     return m_arcList;
   }
-  const ScoreComponentCollection& GetScoreBreakdown() const {
-    if (!m_scoreBreakdown) {
-      m_scoreBreakdown.reset(new ScoreComponentCollection);
-      m_scoreBreakdown->PlusEquals(m_currScoreBreakdown);
-      if (m_prevHypo) {
-        m_scoreBreakdown->PlusEquals(m_prevHypo->GetScoreBreakdown());
-      }
-    }
-    return *(m_scoreBreakdown.get());
-  }
+  const ScoreComponentCollection& GetScoreBreakdown() const;
   float GetFutureScore() const {
     return m_futureScore;
   }
@@ -247,8 +257,13 @@ public:
   // creates a map of TARGET positions which should be replaced by word using placeholder
   std::map<size_t, const Moses::Factor*> GetPlaceholders(const Moses::Hypothesis &hypo, Moses::FactorType placeholderFactor) const;
 
-  // for unordered_set in stack
-  size_t hash() const;
+  // for the recombination set in stack
+  size_t hash() const {
+    return (size_t) m_recombinationHash;
+  }
+  uint64_t GetRecombinationHash() const {
+    return m_recombinationHash;
+  }
   bool operator==(const Hypothesis& other) const;
 
 #ifdef HAVE_XMLRPC_C
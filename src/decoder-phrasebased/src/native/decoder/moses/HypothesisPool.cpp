@@ -0,0 +1,102 @@
+#include <cstdlib>
+#include <new>
+#include "HypothesisPool.h"
+#include "util/exception.hh"
+
+namespace Moses
+{
+
+// payload starts after the slot header, aligned as malloc() would
+static const size_t kHeaderSize = (sizeof(void*) + alignof(std::max_align_t) - 1)
+                                  / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+HypothesisPool::HypothesisPool()
+  : m_slotSize(0)
+  , m_slabUsed(kSlabSlots)
+  , m_freeSlots(NULL)
+{}
+
+HypothesisPool::~HypothesisPool()
+{
+  for (size_t i = 0; i < m_slabs.size(); ++i)
+    free(m_slabs[i]);
+  for (size_t i = 0; i < m_arcLists.size(); ++i)
+    delete m_arcLists[i];
+}
+
+void *HypothesisPool::Allocate(size_t size)
+{
+  if (m_slotSize == 0)
+    m_slotSize = (kHeaderSize + size + alignof(std::max_align_t) - 1)
+                 / alignof(std::max_align_t) * alignof(std::max_align_t);
+  UTIL_THROW_IF2(kHeaderSize + size > m_slotSize, "HypothesisPool: object size changed from a previous allocation");
+
+  Slot *slot;
+  if (m_freeSlots) {
+    slot = m_freeSlots;
+    m_freeSlots = slot->next;
+  } else {
+    if (m_slabUsed == kSlabSlots) {
+      char *slab = (char*) malloc(m_slotSize * kSlabSlots);
+      if (!slab)
+        throw std::bad_alloc();
+
+      m_slabs.push_back(slab);
+      m_slabUsed = 0;
+    }
+
+    slot = (Slot*) (m_slabs.back() + m_slotSize * m_slabUsed++);
+  }
+
+  slot->owner = this;
+
+  return ((char*) slot) + kHeaderSize;
+}
+
+void *HypothesisPool::AllocateUnpooled(size_t size)
+{
+  Slot *slot = (Slot*) malloc(kHeaderSize + size);
+  if (!slot)
+    throw std::bad_alloc();
+
+  slot->owner = NULL;
+
+  return ((char*) slot) + kHeaderSize;
+}
+
+void HypothesisPool::Release(void *ptr)
+{
+  if (!ptr)
+    return;
+
+  Slot *slot = (Slot*) (((char*) ptr) - kHeaderSize);
+  HypothesisPool *owner = slot->owner;
+
+  if (owner) {
+    slot->next = owner->m_freeSlots;
+    owner->m_freeSlots = slot;
+  } else {
+    free(slot);
+  }
+}
+
+ArcList *HypothesisPool::NewArcList()
+{
+  if (m_freeArcLists.empty()) {
+    m_arcLists.push_back(new ArcList());
+    return m_arcLists.back();
+  }
+
+  // recycled lists keep their capacity
+  ArcList *arcList = m_freeArcLists.back();
+  m_freeArcLists.pop_back();
+  return arcList;
+}
+
+void HypothesisPool::ReleaseArcList(ArcList *arcList)
+{
+  arcList->clear();
+  m_freeArcLists.push_back(arcList);
+}
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace Moses
+{
+
+class Hypothesis;
+typedef std::vector<Hypothesis*> ArcList;
+
+/** Per-sentence slab allocator for Hypothesis objects and their arc lists.
+ *
+ * Owned by the Manager: memory is carved out of large slabs, recycled through free lists
+ * when hypotheses are pruned or recombined, and returned to the system in bulk when the
+ * Manager (and so the pool) is destroyed. Hypothesis destructors still run as usual, the
+ * pool only replaces the malloc/free pair behind them.
+ *
+ * Not thread-safe: a pool must only be used by one thread at a time. With intra-sentence
+ * parallelism, every expansion thread has a pool of its own (see SearchNormal).
+ */
+class HypothesisPool
+{
+public:
+  HypothesisPool();
+  ~HypothesisPool();
+
+  //! raw storage for a Hypothesis (see Hypothesis::operator new)
+  void *Allocate(size_t size);
+  //! give back storage obtained from Allocate(), or from the heap if the hypothesis was not pooled
+  static void Release(void *ptr);
+
+  ArcList *NewArcList();
+  void ReleaseArcList(ArcList *arcList);
+
+  //! storage for a Hypothesis that does not belong to any pool
+  static void *AllocateUnpooled(size_t size);
+
+private:
+  struct Slot {
+    // while in use, the owner pool (NULL when allocated from the heap); while free, the next free slot
+    union {
+      HypothesisPool *owner;
+      Slot *next;
+    };
+  };
+
+  static const size_t kSlabSlots = 1024;
+
+  std::vector<char*> m_slabs;
+  size_t m_slotSize;
+  size_t m_slabUsed;
+  Slot *m_freeSlots;
+
+  std::vector<ArcList*> m_arcLists;
+  std::vector<ArcList*> m_freeArcLists;
+
+  HypothesisPool(HypothesisPool const&);
+  void operator=(HypothesisPool const&);
+};
+
+}
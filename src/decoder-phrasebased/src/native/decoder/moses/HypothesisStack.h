@@ -3,8 +3,8 @@
 
 #include <vector>
 #include <set>
-#include <boost/unordered_set.hpp>
 #include "Hypothesis.h"
+#include "RecombinationSet.h"
 #include "Bitmap.h"
 
 namespace Moses
@@ -19,7 +19,7 @@ class HypothesisStack
 {
 
 protected:
-  typedef boost::unordered_set< Hypothesis*, UnorderedComparer<Hypothesis>, UnorderedComparer<Hypothesis> > _HCType;
+  typedef RecombinationSet _HCType;
   _HCType m_hypos; /**< contains hypotheses */
   Manager& m_manager;
 
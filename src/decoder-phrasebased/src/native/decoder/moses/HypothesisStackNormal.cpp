@@ -20,6 +20,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
 #include <algorithm>
+#include <functional>
 #include <set>
 #include <queue>
 #include "HypothesisStackNormal.h"
@@ -101,9 +102,7 @@ bool HypothesisStackNormal::AddPrune(Hypothesis *hypo)
 
   // too bad for stack. don't bother adding hypo into collection
   if (m_manager.options()->search.disable_discarding == false
-      && hypo->GetFutureScore() < m_worstScore
-      && ! ( m_minHypoStackDiversity > 0
-             && hypo->GetFutureScore() >= GetWorstScoreForBitmap( hypo->GetWordsBitmap() ) ) ) {
+      && IsDiscarded(hypo->GetFutureScore(), hypo->GetWordsBitmap().GetID())) {
     m_manager.GetSentenceStats().AddDiscarded();
     VERBOSE(3,"discarded, too bad for stack" << std::endl);
     delete hypo;
@@ -111,9 +110,12 @@ bool HypothesisStackNormal::AddPrune(Hypothesis *hypo)
   }
 
   // over threshold, try to add to collection
+  // Add() may prune the stack, new hypothesis included
+  float score = hypo->GetFutureScore();
   std::pair<iterator, bool> addRet = Add(hypo);
   if (addRet.second) {
     // nothing found. add to collection
+    UpdateTopScores(score);
     return true;
   }
 
@@ -144,6 +146,8 @@ bool HypothesisStackNormal::AddPrune(Hypothesis *hypo)
     return false;
   } else {
     // already storing the best hypo. discard current hypo
+    // (on recombination the top scores are left alone: the score tracked for this state
+    // may only be lower than the actual one, which keeps the threshold safe)
     VERBOSE(3,"worse than matching hyp " << hypoExisting->GetId() << ", recombining" << std::endl)
     if (m_nBestIsEnabled) {
       hypoExisting->AddArc(hypo);
@@ -154,11 +158,69 @@ bool HypothesisStackNormal::AddPrune(Hypothesis *hypo)
   }
 }
 
+void HypothesisStackNormal::UpdateTopScores(float score)
+{
+  if (m_maxHypoStackSize == 0) return; // no limit
+
+  if (m_topScores.size() < m_maxHypoStackSize) {
+    m_topScores.push_back(score);
+    push_heap(m_topScores.begin(), m_topScores.end(), std::greater<float>());
+  } else if (score > m_topScores.front()) {
+    pop_heap(m_topScores.begin(), m_topScores.end(), std::greater<float>());
+    m_topScores.back() = score;
+    push_heap(m_topScores.begin(), m_topScores.end(), std::greater<float>());
+  } else {
+    return;
+  }
+
+  if (m_topScores.size() == m_maxHypoStackSize && m_topScores.front() > m_worstScore)
+    m_worstScore = m_topScores.front();
+}
+
 void HypothesisStackNormal::PruneToSize(size_t newSize)
 {
   if ( newSize == 0) return; // no limit
   if ( size() <= newSize ) return; // ok, if not over the limit
 
+  if ( m_minHypoStackDiversity > 0 ) {
+    PruneToSizeWithDiversity(newSize);
+    return;
+  }
+
+  // select the best newSize hypotheses, without sorting them
+  vector< Hypothesis* > hypos(m_hypos.begin(), m_hypos.end());
+  nth_element(hypos.begin(), hypos.begin() + newSize - 1, hypos.end(), CompareHypothesisTotalScore());
+
+  // delete the others, as well as the selected ones that fell out of the beam
+  float beamThreshold = m_bestScore + m_beamWidth;
+  size_t kept = 0;
+
+  for (size_t i = 0; i < hypos.size(); i++) {
+    if (i < newSize && hypos[i]->GetFutureScore() > beamThreshold) {
+      kept++;
+    } else {
+      Remove(m_hypos.find(hypos[i]));
+      m_manager.GetSentenceStats().AddPruning();
+    }
+  }
+
+  if (kept == newSize && hypos[newSize - 1]->GetFutureScore() > m_worstScore)
+    m_worstScore = hypos[newSize - 1]->GetFutureScore();
+
+  // some reporting....
+  VERBOSE(3,", pruned to size " << size() << endl);
+  IFVERBOSE(3) {
+    TRACE_ERR("stack now contains: ");
+    for(iterator iter = m_hypos.begin(); iter != m_hypos.end(); iter++) {
+      Hypothesis *hypo = *iter;
+      TRACE_ERR( hypo->GetId() << " (" << hypo->GetFutureScore() << ") ");
+    }
+    TRACE_ERR( endl);
+  }
+}
+
+void HypothesisStackNormal::PruneToSizeWithDiversity(size_t newSize)
+{
   // we need to store a temporary list of hypotheses
   vector< Hypothesis* > hypos = GetSortedListNOTCONST();
   bool* included = (bool*) malloc(sizeof(bool) * hypos.size());
@@ -171,21 +233,19 @@ void HypothesisStackNormal::PruneToSize(size_t newSize)
   }
 
   // add best hyps for each coverage according to minStackDiversity
-  if ( m_minHypoStackDiversity > 0 ) {
-    map< WordsBitmapID, size_t > diversityCount;
-    for(size_t i=0; i<hypos.size(); i++) {
-      Hypothesis *hyp = hypos[i];
-      WordsBitmapID coverage = hyp->GetWordsBitmap().GetID();;
-      if (diversityCount.find( coverage ) == diversityCount.end())
-        diversityCount[ coverage ] = 0;
-
-      if (diversityCount[ coverage ] < m_minHypoStackDiversity) {
-        m_hypos.insert( hyp );
-        included[i] = true;
-        diversityCount[ coverage ]++;
-        if (diversityCount[ coverage ] == m_minHypoStackDiversity)
-          SetWorstScoreForBitmap( coverage, hyp->GetFutureScore());
-      }
+  map< WordsBitmapID, size_t > diversityCount;
+  for(size_t i=0; i<hypos.size(); i++) {
+    Hypothesis *hyp = hypos[i];
+    WordsBitmapID coverage = hyp->GetWordsBitmap().GetID();;
+    if (diversityCount.find( coverage ) == diversityCount.end())
+      diversityCount[ coverage ] = 0;
+
+    if (diversityCount[ coverage ] < m_minHypoStackDiversity) {
+      m_hypos.insert( hyp );
+      included[i] = true;
+      diversityCount[ coverage ]++;
+      if (diversityCount[ coverage ] == m_minHypoStackDiversity)
+        SetWorstScoreForBitmap( coverage, hyp->GetFutureScore());
     }
   }
 
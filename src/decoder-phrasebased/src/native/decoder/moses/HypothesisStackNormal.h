@@ -47,6 +47,12 @@ protected:
   size_t m_maxHypoStackSize; /**< maximum number of hypothesis allowed in this stack */
   size_t m_minHypoStackDiversity; /**< minimum number of hypothesis with different source word coverage */
   bool m_nBestIsEnabled; /**< flag to determine whether to keep track of old arcs */
+  std::vector<float> m_topScores; /**< min-heap with the best m_maxHypoStackSize scores added so far */
+
+  /** track the score of a newly added hypothesis: once the stack has seen m_maxHypoStackSize
+   * hypotheses, nothing worse than the worst of the best ones can survive pruning, so
+   * m_worstScore tightens as hypotheses arrive instead of only after pruning */
+  void UpdateTopScores(float score);
 
   /** add hypothesis to stack. Prune if necessary.
    * Returns false if equiv hypo exists in collection, otherwise returns true
@@ -61,6 +67,14 @@ protected:
   }
 
 public:
+  /** true if a hypothesis with this score and coverage is too bad for the stack.
+   * Also the early discarding test of the search, before a hypothesis is built:
+   * then the score is an estimate, and margin the early discarding threshold */
+  bool IsDiscarded(float futureScore, WordsBitmapID coverage, float margin = 0.0f) {
+    return futureScore < m_worstScore + margin
+           && !(m_minHypoStackDiversity > 0 && futureScore >= GetWorstScoreForBitmap(coverage) + margin);
+  }
+
   float GetWorstScoreForBitmap( WordsBitmapID id ) {
     if (m_diversityWorstScore.find( id ) == m_diversityWorstScore.end())
       return -std::numeric_limits<float>::infinity();
@@ -89,6 +103,8 @@ public:
   inline void SetMaxHypoStackSize(size_t maxHypoStackSize, size_t minHypoStackDiversity) {
     m_maxHypoStackSize = maxHypoStackSize;
     m_minHypoStackDiversity = minHypoStackDiversity;
+    m_topScores.clear();
+    m_topScores.reserve(maxHypoStackSize);
   }
 
   /** set beam threshold, hypotheses in the stack must not be worse than
@@ -112,9 +128,14 @@ public:
    * The threshold is chosen so that exactly newSize top items remain on the
    * stack in fact, in situations where some of the hypothesis fell below
    * m_beamWidth, the stack will contain less items.
+   * Without stack diversity, the threshold is found by selection and the
+   * losers are removed in place.
    * \param newSize maximum size */
   void PruneToSize(size_t newSize);
 
+  /** PruneToSize() keeping at least m_minHypoStackDiversity hypotheses for each coverage */
+  void PruneToSizeWithDiversity(size_t newSize);
+
   //! return the hypothesis with best score. Used to get the translated at end of decoding
   const Hypothesis *GetBestHypothesis() const;
   //! return all hypothesis, sorted by descending score. Used in creation of N best list
@@ -30,8 +30,6 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "StaticData.h"
 #include "TranslationTask.h"
 
-#define ParseWord(w) (boost::lexical_cast<wid_t>((w)))
-
 using namespace std;
 using namespace Moses;
 
@@ -119,8 +117,7 @@ MMTInterpolatedLM::TransformPhrase(const Phrase &phrase, std::vector<wid_t> &phr
         phrase_vec.push_back(kVocabularyStartSymbol); //insert start symbol
     }
     for (size_t i = 0; i < phrase.GetSize(); ++i) {
-        wid_t id = ParseWord(phrase.GetWord(i).GetString(m_factorType).as_string());
-        phrase_vec.push_back(id);
+        phrase_vec.push_back(phrase.GetFactor(i, m_factorType)->GetWid());
     }
     for (size_t i = 0; i < endGaps; ++i) {
         phrase_vec.push_back(kVocabularyEndSymbol); //insert end symbol
@@ -135,7 +132,7 @@ MMTInterpolatedLM::SetWordVector(const Hypothesis &hypo, std::vector<wid_t> &phr
     }
 
     for (size_t position = from; position < to; ++position) {
-        phrase_vec.push_back(ParseWord(hypo.GetWord(position).GetString(m_factorType).as_string()));
+        phrase_vec.push_back(hypo.GetFactor(position, m_factorType)->GetWid());
     }
 
     for (size_t i = 0; i < endGaps; ++i) {
@@ -324,8 +321,8 @@ void MMTInterpolatedLM::InitializeForInput(ttasksptr const &ttask) {
 #ifdef TRACE_CACHE
     m_lmtb->sentence_id++;
 #endif
-    // we assume here that translation is run in one single thread for each ttask
-    // (no parallelization at a finer granularity involving MMT InterpolatedLM)
+    // with search-threads, this is also called by each thread expanding the stacks
+    // of the ttask (see SearchNormal), so that every one gets its own context and cache
 
     // This function is called prior to actual translation and allows the class
     // to set up thread-specific information such as context weights
@@ -333,24 +330,27 @@ void MMTInterpolatedLM::InitializeForInput(ttasksptr const &ttask) {
     // DO NOT modify members of 'this' here. We are being called from different
     // threads, and there is no locking here.
     SPTR<ContextScope> const &scope = ttask->GetScope();
-    SPTR<weightmap_t const> weights = scope->GetContextWeights();
-
-    if (weights) {
-        context_t *context_vec = new context_t;
-
-        for (weightmap_t::const_iterator it = weights->begin(); it != weights->end(); ++it) {
-            context_vec->push_back(cscore_t(ParseWord(it->first), it->second));
+    SPTR<context_t const> context = scope->GetContext();
+
+    // normalization is computed once per scope and shared by all the sentences translated with it
+    SPTR<context_t> normalized;
+    if (context) {
+        normalized = scope->get<context_t>(this);
+        if (!normalized) {
+            normalized.reset(new context_t(*context));
+            m_lm->NormalizeContext(normalized.get());
+            scope->set(this, normalized);
         }
-
-        m_lm->NormalizeContext(context_vec);
-        t_context_vec.reset(context_vec);
     }
 
+    ContextScope::AssignThreadContext(t_context_vec, normalized.get());
+
     t_cached_lm.reset(new CachedLM(m_lm, 5));
 }
 
 void MMTInterpolatedLM::CleanUpAfterSentenceProcessing(const InputType &source) {
-    t_context_vec.reset();
+    if (t_context_vec.get())
+        t_context_vec->clear();
     t_cached_lm.reset();
 }
 
@@ -34,7 +34,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "Util.h"
 #include "TargetPhrase.h"
 #include "TrellisPath.h"
-#include "TrellisPathCollection.h"
+#include "TrellisKBestExtractor.h"
 #include "TranslationOption.h"
 #include "TranslationOptionCollection.h"
 #include "Timer.h"
@@ -68,6 +68,7 @@ Manager::Manager(ttasksptr const& ttask)
   : BaseManager(ttask)
   , interrupted_flag(0)
   , m_hypoId(0)
+  , m_timeBudget(0)
 {
   boost::shared_ptr<InputType> source = ttask->GetSource();
   m_transOptColl = source->CreateTranslationOptionCollection(ttask);
@@ -236,7 +237,7 @@ printThisHypothesis(long translationId, const Hypothesis* hypo,
 /**
  * After decoding, the hypotheses in the stacks and additional arcs
  * form a search graph that can be mined for n-best lists.
- * The heavy lifting is done in the TrellisPath and TrellisPathCollection
+ * The paths are extracted lazily by the TrellisKBestExtractor,
  * this function controls this for one sentence.
  *
  * \param count the number of n-best translations to produce
@@ -254,51 +255,13 @@ void Manager::CalcNBest(size_t count, TrellisPathList &ret, bool onlyDistinct) c
   if (sortedPureHypo.size() == 0)
     return;
 
-  TrellisPathCollection contenders;
-
-  set<Phrase> distinctHyps;
-
-  // add all pure paths
-  vector<const Hypothesis*>::const_iterator iterBestHypo;
-  for (iterBestHypo = sortedPureHypo.begin()
-                      ; iterBestHypo != sortedPureHypo.end()
-       ; ++iterBestHypo) {
-    contenders.Add(new TrellisPath(*iterBestHypo));
-  }
-
   // factor defines stopping point for distinct n-best list if too
   // many candidates identical
   size_t nBestFactor = options()->nbest.factor;
   if (nBestFactor < 1) nBestFactor = 1000; // 0 = unlimited
 
-  // MAIN loop
-  for (size_t iteration = 0 ; (onlyDistinct ? distinctHyps.size() : ret.GetSize()) < count && contenders.GetSize() > 0 && (iteration < count * nBestFactor) ; iteration++) {
-    // get next best from list of contenders
-    TrellisPath *path = contenders.pop();
-    UTIL_THROW_IF2(path == NULL, "path is NULL");
-    // create deviations from current best
-    path->CreateDeviantPaths(contenders);
-    if(onlyDistinct) {
-      Phrase tgtPhrase = path->GetSurfacePhrase();
-      if (distinctHyps.insert(tgtPhrase).second) {
-        ret.Add(path);
-      } else {
-        delete path;
-        path = NULL;
-      }
-    } else {
-      ret.Add(path);
-    }
-
-
-    if(onlyDistinct) {
-      const size_t nBestFactor = options()->nbest.factor;
-      if (nBestFactor > 0)
-        contenders.Prune(count * nBestFactor);
-    } else {
-      contenders.Prune(count);
-    }
-  }
+  TrellisKBestExtractor extractor(options()->output.factor_order);
+  extractor.Extract(sortedPureHypo, count, onlyDistinct, count * nBestFactor, ret);
 }
 
 struct SGNReverseCompare {
@@ -1425,6 +1388,17 @@ const Hypothesis *Manager::GetBestHypothesis() const
   return m_search->GetBestHypothesis();
 }
 
+void Manager::SetTimeBudget(const Timer &clock, double seconds)
+{
+  m_budgetClock = clock;
+  m_timeBudget = seconds;
+}
+
+SearchDegradation Manager::GetSearchDegradation() const
+{
+  return m_search->GetDegradation();
+}
+
 int Manager::GetNextHypoId()
 {
   GetSentenceStats().AddCreated(); // count created hypotheses
@@ -1671,25 +1645,21 @@ OutputNBest(std::vector<hypothesis_t> &nBest) const
 
   Moses::NBestOptions const& nbo = options()->nbest;
   CalcNBest(nbo.nbest_size, nBestList, nbo.only_distinct);
-  OutputNBest(cout, nBestList);
+
+  nBest.reserve(nBestList.GetSize());
 
   BOOST_FOREACH(Moses::TrellisPath const* path, nBestList) {
     vector<const Hypothesis *> const& E = path->GetEdges();
     if (!E.size()) continue;
-    std::string target_string = GetTranslation(E);
 
-    // reported in a more structured manner
-    ostringstream buf;
-    bool with_labels = nbo.include_feature_labels; // default true
-    path->GetScoreBreakdown()->OutputAllFeatureScores(buf, with_labels);
+    nBest.push_back(hypothesis_t());
+    hypothesis_t &hyp = nBest.back();
 
-    hypothesis_t hyp;
-    hyp.text = target_string;
-    hyp.fvals = buf.str();
+    hyp.text = GetTranslation(E);
+    // dense feature scores, labels are implied by the feature order
+    path->GetScoreBreakdown()->GetAllFeatureScores(hyp.scores);
     // weighted total score
     hyp.score = path->GetFutureScore();
-
-    nBest.push_back(hyp);
   }
 }
 
@@ -36,6 +36,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "Search.h"
 #include "SearchCubePruning.h"
 #include "BaseManager.h"
+#include "Timer.h"
 #include "MosesDecoder.h"
 
 namespace Moses
@@ -121,6 +122,9 @@ protected:
   size_t interrupted_flag;
   std::unique_ptr<SentenceStats> m_sentenceStats;
   int m_hypoId; //used to number the hypos as they are created.
+  Timer m_budgetClock; /**< running since the time budget started */
+  double m_timeBudget; /**< seconds, 0 for none */
+  HypothesisPool m_hypothesisPool; /**< storage of this sentence's hypotheses, released with the Manager */
 
   void GetConnectedGraph(
     std::map< int, bool >* pConnected,
@@ -167,6 +171,21 @@ public:
   const  TranslationOptionCollection* getSntTranslationOptions();
 
   void Decode();
+
+  /** Give the search a wall-clock budget of the given seconds, measured on a running clock
+   * that may have been started before the Manager (e.g. when the request arrived).
+   * The search is simplified as the budget runs out, see SearchDegradation */
+  void SetTimeBudget(const Timer &clock, double seconds);
+  bool HasTimeBudget() const {
+    return m_timeBudget > 0;
+  }
+  //! fraction of the time budget used so far, may exceed 1
+  double GetTimeBudgetUsed() const {
+    return m_budgetClock.get_elapsed_time() / m_timeBudget;
+  }
+  //! how much the search had to be simplified to fit the time budget
+  SearchDegradation GetSearchDegradation() const;
+
   const Hypothesis *GetBestHypothesis() const;
   const Hypothesis *GetActualBestHypothesis() const;
   void CalcNBest(size_t count, TrellisPathList &ret,bool onlyDistinct=0) const;
@@ -177,6 +196,9 @@ public:
   void GetOutputLanguageModelOrder( std::ostream &out, const Hypothesis *hypo ) const;
   void GetWordGraph(long translationId, std::ostream &outputWordGraphStream) const;
   int GetNextHypoId();
+  HypothesisPool &GetHypothesisPool() {
+    return m_hypothesisPool;
+  }
 
   void OutputLatticeMBRNBest(std::ostream& out, const std::vector<LatticeMBRSolution>& solutions,long translationId) const;
   void OutputBestHypo(const std::vector<Moses::Word>&  mbrBestHypo, std::ostream& out) const;
@@ -3,9 +3,14 @@
 //
 
 #include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
 #include <unordered_map>
+#include <boost/make_shared.hpp>
 
 #include "MosesDecoder.h"
+#include "SessionStore.h"
 
 #include "TranslationTask.h"
 #include "StaticData.h"
@@ -13,6 +18,9 @@
 #include "Manager.h"
 #include "IOWrapper.h"
 #include "FF/StatefulFeatureFunction.h"
+#include "ThreadPool.h"
+#include "Timer.h"
+#include "parameters/ServerOptions.h"
 
 using namespace std;
 using namespace mmt;
@@ -22,13 +30,18 @@ namespace mmt {
     namespace decoder {
 
         class MosesDecoderImpl : public MosesDecoder {
-            std::mutex m_sessionsMutex;
-            unordered_map<uint64_t, boost::shared_ptr<Moses::ContextScope>> m_sessions;
+            SessionStore m_sessions;
             std::vector<feature_t> m_features;
             std::vector<IncrementalModel *> m_incrementalModels;
+            boost::scoped_ptr<Moses::ThreadPool> m_batchPool;
+            size_t m_batchThreads;
 
-            uint64_t createSession(const std::map<std::string, float> *translationContext = NULL,
-                                  const std::map<std::string, std::vector<float>> *featureWeights = NULL);
+            boost::shared_ptr<Moses::ContextScope> getScope(uint64_t session,
+                                                            const mmt::context_t *translationContext);
+
+            boost::shared_ptr<Moses::ContextScope> createScope(const mmt::context_t *translationContext,
+                                                               const std::map<std::string, std::vector<float>> *featureWeights,
+                                                               size_t *outFootprint = NULL);
         public:
 
             MosesDecoderImpl(Moses::Parameter &param);
@@ -40,14 +53,22 @@ namespace mmt {
             virtual void
             setDefaultFeatureWeights(const std::map<std::string, std::vector<float>> &featureWeights) override;
 
-            virtual int64_t openSession(const std::map<std::string, float> &translationContext,
+            virtual int64_t openSession(const mmt::context_t &translationContext,
                                         const std::map<std::string, std::vector<float>> *featureWeights = NULL) override;
 
             virtual void closeSession(uint64_t session) override;
 
+            virtual size_t getActiveSessionsCount() const override;
+
+            virtual size_t getSessionsMemoryUsage() const override;
+
             virtual translation_t translate(const std::string &text, uint64_t session,
-                                            const std::map<std::string, float> *translationContext,
-                                            size_t nbestListSize) override;
+                                            const mmt::context_t *translationContext,
+                                            size_t nbestListSize, int64_t timeout = 0) override;
+
+            virtual std::vector<translation_t> translate(const std::vector<std::string> &texts, uint64_t session,
+                                                         const mmt::context_t *translationContext,
+                                                         size_t nbestListSize, int64_t timeout = 0) override;
 
             virtual const vector<IncrementalModel *> &GetIncrementalModels() const override;
         };
@@ -70,7 +91,22 @@ MosesDecoder *MosesDecoder::createInstance(const char *inifile, Aligner *aligner
     return new MosesDecoderImpl(params);
 }
 
-MosesDecoderImpl::MosesDecoderImpl(Moses::Parameter &param) : m_features() {
+static std::chrono::seconds GetSessionTimeout(const Moses::Parameter &param) {
+    const Moses::PARAM_VEC *spec = param.GetParam("session-timeout");
+    if (spec == NULL || spec->empty())
+        return std::chrono::hours(24);
+
+    return std::chrono::seconds(Moses::parse_timespec(spec->at(0)));
+}
+
+MosesDecoderImpl::MosesDecoderImpl(Moses::Parameter &param) : m_sessions(GetSessionTimeout(param)), m_features() {
+    int threads = Moses::StaticData::Instance().ThreadCount();
+    m_batchThreads = threads > 1 ? (size_t) threads : 1;
+
+    // the calling thread always takes part in a batch, the pool provides the remaining workers
+    if (m_batchThreads > 1)
+        m_batchPool.reset(new Moses::ThreadPool(m_batchThreads - 1));
+
     const std::vector<const Moses::StatelessFeatureFunction *> &slf = Moses::StatelessFeatureFunction::GetStatelessFeatureFunctions();
     for (size_t i = 0; i < slf.size(); ++i) {
         const Moses::FeatureFunction *feature = slf[i];
@@ -112,7 +148,7 @@ std::vector<float> MosesDecoderImpl::getFeatureWeights(feature_t &_feature) {
     std::vector<float> weights;
 
     if (feature->IsTuneable()) {
-        weights = Moses::StaticData::Instance().GetAllWeightsNew().GetScoresForProducer(feature);
+        weights = Moses::StaticData::Instance().GetAllWeightsSnapshot()->GetScoresForProducer(feature);
 
         for (size_t i = 0; i < feature->GetNumScoreComponents(); ++i) {
             if (!feature->IsTuneableComponent(i)) {
@@ -129,52 +165,75 @@ void MosesDecoderImpl::setDefaultFeatureWeights(const std::map<std::string, std:
 }
 
 
-int64_t MosesDecoderImpl::openSession(const std::map<std::string, float> &translationContext,
+int64_t MosesDecoderImpl::openSession(const mmt::context_t &translationContext,
                                       const std::map<std::string, std::vector<float>> *featureWeights)
 {
-    return createSession(&translationContext, featureWeights);
+    size_t footprint;
+    boost::shared_ptr<Moses::ContextScope> scope = createScope(&translationContext, featureWeights, &footprint);
+
+    return m_sessions.Put(scope, footprint);
 }
 
-uint64_t MosesDecoderImpl::createSession(const std::map<std::string, float> *translationContext,
-                                         const std::map<std::string, std::vector<float>> *featureWeights)
+boost::shared_ptr<Moses::ContextScope> MosesDecoderImpl::createScope(const mmt::context_t *translationContext,
+                                                                     const std::map<std::string, std::vector<float>> *featureWeights,
+                                                                     size_t *outFootprint)
 {
-    boost::shared_ptr<Moses::ContextScope> scope(new Moses::ContextScope(Moses::StaticData::Instance().GetAllWeightsNew()));
+    boost::shared_ptr<Moses::ContextScope> scope(new Moses::ContextScope(Moses::StaticData::Instance().GetAllWeightsSnapshot()));
+    size_t footprint = sizeof(Moses::ContextScope);
 
     if(translationContext != NULL) {
-        boost::shared_ptr<std::map<std::string, float> > cw(new std::map<std::string, float>(*translationContext));
-        scope->SetContextWeights(cw);
+        boost::shared_ptr<mmt::context_t> context(new mmt::context_t(*translationContext));
+        scope->SetContext(context);
+
+        footprint += sizeof(mmt::context_t) + context->capacity() * sizeof(mmt::cscore_t);
     }
 
     if (featureWeights != NULL) {
         boost::shared_ptr<std::map<std::string, std::vector<float> > > fw(
             new std::map<std::string, std::vector<float> >(*featureWeights));
         scope->SetFeatureWeights(fw);
-    }
 
-    uint64_t session_id;
-    {
-        std::lock_guard<std::mutex> lock(m_sessionsMutex);
-        // start with session ID 1 (when passed to translate(), session ID 0 means 'no session')
-        session_id = m_sessions.size() + 1;
-        m_sessions.insert(std::make_pair(session_id, scope));
+        for (auto it = fw->begin(); it != fw->end(); ++it)
+            footprint += sizeof(*it) + it->first.capacity() + it->second.capacity() * sizeof(float);
     }
-    return session_id;
+
+    if (outFootprint)
+        *outFootprint = footprint;
+
+    return scope;
 }
 
 void MosesDecoderImpl::closeSession(uint64_t session) {
-    std::lock_guard<std::mutex> lock(m_sessionsMutex);
-    m_sessions.erase(session);
+    m_sessions.Remove(session);
 }
 
-static void DoTranslate(translation_request_t const& request, boost::shared_ptr<Moses::ContextScope> scope, translation_t &result) {
-    boost::shared_ptr<Moses::AllOptions> opts(new Moses::AllOptions());
-    *opts = *Moses::StaticData::Instance().options();
+size_t MosesDecoderImpl::getActiveSessionsCount() const {
+    return m_sessions.GetSize();
+}
 
-    if (request.nBestListSize > 0) {
-        opts->nbest.only_distinct = true;
-        opts->nbest.nbest_size = request.nBestListSize;
-        opts->nbest.enabled = true;
-    }
+size_t MosesDecoderImpl::getSessionsMemoryUsage() const {
+    return m_sessions.GetMemoryUsage();
+}
+
+static Moses::AllOptions::ptr GetOptions(size_t nBestListSize) {
+    // the global options are immutable once loaded: share them unless the request needs its own n-best settings
+    Moses::AllOptions::ptr const &defaults = Moses::StaticData::Instance().options();
+    if (nBestListSize == 0)
+        return defaults;
+
+    boost::shared_ptr<Moses::AllOptions> opts(new Moses::AllOptions(*defaults));
+    opts->nbest.only_distinct = true;
+    opts->nbest.nbest_size = nBestListSize;
+    opts->nbest.enabled = true;
+
+    return opts;
+}
+
+static void DoTranslate(translation_request_t const& request, Moses::AllOptions::ptr const& opts,
+                        boost::shared_ptr<Moses::ContextScope> scope, const Moses::Timer &requestClock,
+                        translation_t &result) {
+    Moses::Timer timer;
+    timer.start();
 
     boost::shared_ptr<Moses::InputType> source(new Moses::Sentence(opts, 0, request.sourceSent));
     boost::shared_ptr<Moses::IOWrapper> ioWrapperNone;
@@ -184,6 +243,8 @@ static void DoTranslate(translation_request_t const& request, boost::shared_ptr<
     // note: ~Manager() must run while we still own TranslationTask (because it only has a weak_ptr)
     {
         Moses::Manager manager(ttask);
+        if (request.timeout > 0)
+            manager.SetTimeBudget(requestClock, request.timeout / 1000.);
         manager.Decode();
 
         result.text = manager.GetBestTranslation();
@@ -191,36 +252,120 @@ static void DoTranslate(translation_request_t const& request, boost::shared_ptr<
 
         if (manager.GetSource().options()->nbest.nbest_size)
             manager.OutputNBest(result.hypotheses);
+
+        result.degradation = manager.GetSearchDegradation();
     }
+
+    result.elapsed = (int64_t) (timer.get_elapsed_time() * 1000.);
 }
 
-translation_t MosesDecoderImpl::translate(const std::string &text, uint64_t session,
-                                          const std::map<std::string, float> *translationContext,
-                                          size_t nbestListSize) {
+namespace {
+
+    /*
+     * Shared state of a batch translation: every worker (pool threads and calling thread) pulls
+     * the next untranslated sentence from an atomic cursor until the batch is exhausted, so faster
+     * workers naturally take over the sentences that slower ones did not reach.
+     */
+    class BatchState {
+    public:
+        BatchState(const std::vector<std::string> &texts, boost::shared_ptr<Moses::ContextScope> scope,
+                   size_t nbestListSize, int64_t timeout, std::vector<translation_t> &results)
+                : texts(texts), count(texts.size()), scope(scope), nbestListSize(nbestListSize),
+                  timeout(timeout), options(GetOptions(nbestListSize)), results(results),
+                  cursor(0), pending(texts.size()) {
+            clock.start();
+        }
 
-    // Retrieve the ContextScope of the session, or create a temporary one
+        void Work() {
+            size_t index;
+
+            while ((index = cursor.fetch_add(1)) < count) {
+                translation_request_t request;
+                request.sourceSent = texts[index];
+                request.nBestListSize = nbestListSize;
+                request.timeout = timeout;
+
+                try {
+                    DoTranslate(request, options, scope, clock, results[index]);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!error)
+                        error = std::current_exception();
+                }
+
+                if (pending.fetch_sub(1) == 1) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    done.notify_all();
+                }
+            }
+        }
 
-    //bool have_session = (session != 0);
-    bool have_session;
-    boost::shared_ptr<Moses::ContextScope> scope;
-    {
-        std::lock_guard<std::mutex> lock(m_sessionsMutex);
-        auto it = m_sessions.find(session);
-        have_session = (it != m_sessions.end());
-        if(have_session) {
-            UTIL_THROW_IF2(translationContext != nullptr, "translate(): you cannot specify both session and translationContext");
-            scope = it->second;
+        void Wait() {
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [this] { return pending.load() == 0; });
+
+            if (error)
+                std::rethrow_exception(error);
         }
-    }
-    if(!have_session) {
-        // note: createSession() uses a lock.
-        session = createSession(translationContext, NULL);
-        {
-            std::lock_guard<std::mutex> lock(m_sessionsMutex);
-            scope = m_sessions.at(session);
+
+    private:
+        // texts and results are owned by the caller: they must not be accessed once pending reaches 0
+        const std::vector<std::string> &texts;
+        const size_t count;
+        const boost::shared_ptr<Moses::ContextScope> scope;
+        const size_t nbestListSize;
+        const int64_t timeout;
+        const Moses::AllOptions::ptr options;
+        Moses::Timer clock; //< started with the batch, the timeout is for all of it
+        std::vector<translation_t> &results;
+
+        std::atomic<size_t> cursor;
+        std::atomic<size_t> pending;
+        std::mutex mutex;
+        std::condition_variable done;
+        std::exception_ptr error;
+    };
+
+    class BatchWorker : public Moses::Task {
+    public:
+        BatchWorker(boost::shared_ptr<BatchState> state) : state(state) {}
+
+        virtual void Run() override {
+            state->Work();
         }
+
+    private:
+        boost::shared_ptr<BatchState> state;
+    };
+
+}
+
+boost::shared_ptr<Moses::ContextScope> MosesDecoderImpl::getScope(uint64_t session,
+                                                                   const mmt::context_t *translationContext) {
+    // Retrieve the ContextScope of the session, or create a temporary one that is never stored
+
+    if (session != 0) {
+        UTIL_THROW_IF2(translationContext != nullptr, "translate(): you cannot specify both session and translationContext");
+
+        // translating without the context and weights of the session would silently give other results
+        boost::shared_ptr<Moses::ContextScope> scope = m_sessions.Get(session);
+        if (!scope)
+            throw SessionNotFoundException(session);
+
+        return scope;
     }
 
+    return createScope(translationContext, NULL);
+}
+
+translation_t MosesDecoderImpl::translate(const std::string &text, uint64_t session,
+                                          const mmt::context_t *translationContext,
+                                          size_t nbestListSize, int64_t timeout) {
+    Moses::Timer clock;
+    clock.start();
+
+    boost::shared_ptr<Moses::ContextScope> scope = getScope(session, translationContext);
+
     // Execute translation request
 
     translation_request_t request;
@@ -228,15 +373,36 @@ translation_t MosesDecoderImpl::translate(const std::string &text, uint64_t sess
 
     request.sourceSent = text;
     request.nBestListSize = nbestListSize;
+    request.timeout = timeout;
 
-    DoTranslate(request, scope, response);
-
-    if(!have_session)
-        closeSession(session);
+    DoTranslate(request, GetOptions(nbestListSize), scope, clock, response);
 
     return response;
 }
 
+std::vector<translation_t> MosesDecoderImpl::translate(const std::vector<std::string> &texts, uint64_t session,
+                                                       const mmt::context_t *translationContext,
+                                                       size_t nbestListSize, int64_t timeout) {
+    std::vector<translation_t> results(texts.size());
+    if (texts.empty())
+        return results;
+
+    boost::shared_ptr<Moses::ContextScope> scope = getScope(session, translationContext);
+
+    boost::shared_ptr<BatchState> state = boost::make_shared<BatchState>(texts, scope, nbestListSize, timeout, results);
+
+    if (m_batchPool) {
+        size_t workers = std::min(m_batchThreads, texts.size()) - 1;
+        for (size_t i = 0; i < workers; ++i)
+            m_batchPool->Submit(boost::make_shared<BatchWorker>(state));
+    }
+
+    state->Work();
+    state->Wait();
+
+    return results;
+}
+
 const vector<IncrementalModel *> &MosesDecoderImpl::GetIncrementalModels() const {
     return m_incrementalModels;
 }
\ No newline at end of file
@@ -10,6 +10,7 @@
 #include <utility>
 #include <string>
 #include <map>
+#include <stdexcept>
 #include <float.h>
 #include <mmt/IncrementalModel.h>
 #include <mmt/aligner/Aligner.h>
@@ -25,7 +26,7 @@ typedef struct {
 typedef struct {
     std::string text;
     float score;
-    std::string fvals;
+    std::vector<float> scores; //< tuneable dense components of the tuneable features, in getFeatures() order (no sparse features)
 } hypothesis_t;
 
 typedef struct {
@@ -33,16 +34,31 @@ typedef struct {
     int64_t session;
     std::vector<hypothesis_t> hypotheses;
     std::vector<std::pair<size_t, size_t> > alignment;
+    int64_t elapsed; //< decoding time in milliseconds
+    int degradation; //< how much the search was simplified to meet the timeout (Moses::SearchDegradation), 0 for none
 } translation_t;
 
 typedef struct {
   std::string sourceSent;
   size_t nBestListSize; //< set to 0 if no n-best list requested
+  int64_t timeout; //< time budget of the whole request in milliseconds, 0 for none
 } translation_request_t;
 
 
 namespace mmt {
     namespace decoder {
+
+        /**
+         * Thrown by translate() for a session that was closed, expired or never opened.
+         */
+        class SessionNotFoundException : public std::runtime_error {
+        public:
+            SessionNotFoundException(uint64_t session) : std::runtime_error("session not found: " + std::to_string(session)),
+                                                         session(session) {}
+
+            const uint64_t session;
+        };
+
         class MosesDecoder {
         public:
             static constexpr float UNTUNEABLE_COMPONENT = FLT_MAX;
@@ -67,14 +83,25 @@ namespace mmt {
             /**
              * Open a new session with the given context weights.
              *
-             * @param translationContext  map of context weights
+             * @param translationContext  context weights (domain id, score)
              * @param featureWeights      map of feature weights (may be NULL to use default, global feature weights)
              */
-            virtual int64_t openSession(const std::map<std::string, float> &translationContext,
+            virtual int64_t openSession(const mmt::context_t &translationContext,
                                         const std::map<std::string, std::vector<float>> *featureWeights = NULL) = 0;
 
             virtual void closeSession(uint64_t session) = 0;
 
+            /**
+             * Returns the number of open sessions (sessions idle for longer than the "session-timeout"
+             * option, 24 hours by default, are closed automatically).
+             */
+            virtual size_t getActiveSessionsCount() const = 0;
+
+            /**
+             * Returns an estimate of the memory used by the open sessions, in bytes.
+             */
+            virtual size_t getSessionsMemoryUsage() const = 0;
+
             /**
              * Translate a sentence.
              *
@@ -82,10 +109,32 @@ namespace mmt {
              * @param session             either 0 to avoid use of sessions (translate individually), or session ID obtained from openSession()
              * @param translationContext  context weights may be passed here if session == 0
              * @param nbestListSize       if non-zero, produce an n-best list of this size in the translation_t result
+             * @param timeout             if non-zero, time budget in milliseconds: the search is simplified step by
+             *                            step when running late, and returns what it has when the budget is over
+             *                            (see translation_t::degradation)
+             * @throws SessionNotFoundException if session is not an open session
              */
             virtual translation_t translate(const std::string &text, uint64_t session,
-                                            const std::map<std::string, float> *translationContext,
-                                            size_t nbestListSize) = 0;
+                                            const mmt::context_t *translationContext,
+                                            size_t nbestListSize, int64_t timeout = 0) = 0;
+
+            /**
+             * Translate a batch of sentences sharing the same session or context.
+             *
+             * Sentences are decoded in parallel on the decoder internal thread pool, the calling thread
+             * takes part in the work as well. The ContextScope is created once for the whole batch.
+             *
+             * @param texts               source sentences with space-separated tokens
+             * @param session             either 0 to avoid use of sessions, or session ID obtained from openSession()
+             * @param translationContext  context weights may be passed here if session == 0
+             * @param nbestListSize       if non-zero, produce an n-best list of this size for every sentence
+             * @param timeout             if non-zero, time budget in milliseconds of the whole batch
+             * @return the translations, in the same order of the input sentences
+             * @throws SessionNotFoundException if session is not an open session
+             */
+            virtual std::vector<translation_t> translate(const std::vector<std::string> &texts, uint64_t session,
+                                                         const mmt::context_t *translationContext,
+                                                         size_t nbestListSize, int64_t timeout = 0) = 0;
 
             /**
              * Returns the list of internal incremental models.
@@ -87,6 +87,8 @@ Parameter::Parameter()
   AddParam(search_opts,"early-discarding-threshold", "edt", "threshold for constructing hypotheses based on estimate cost");
   AddParam(search_opts,"stack", "s", "maximum stack size for histogram pruning. 0 = unlimited stack size");
   AddParam(search_opts,"stack-diversity", "sd", "minimum number of hypothesis of each coverage in stack (default 0)");
+  AddParam(search_opts,"search-threads", "number of threads expanding the hypotheses of one stack (default 1, no intra-sentence parallelism)");
+  AddParam(search_opts,"search-threads-min-length", "minimum input length for using search-threads (default 30)");
 
   // feature weight-related options
   AddParam(search_opts,"weight-file", "wf", "feature weights file. Do *not* put weights for 'core' features in here - they go in moses.ini");
@@ -236,7 +238,7 @@ Parameter::Parameter()
   // session timeout and session cache size are for moses translation session handling
   // they have nothing to do with the abyss server (but relate to the moses server)
   AddParam(server_opts,"session-timeout",
-           "Timeout for sessions, e.g. '2h30m' or 1d (=24h)");
+           "Timeout for sessions, e.g. '2h30m' or 1d (=24h); idle MosesDecoder sessions expire after it (default 1d)");
   AddParam(server_opts,"session-cache-size", string("Max. number of sessions cached.")
            +"Least recently used session is dumped first.");
 
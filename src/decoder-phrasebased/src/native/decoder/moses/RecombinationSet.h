@@ -0,0 +1,197 @@
+#pragma once
+
+#include <cstddef>
+#include <stdint.h>
+#include <iterator>
+#include <utility>
+#include <vector>
+#include "Hypothesis.h"
+
+namespace Moses
+{
+
+/** Open-addressing (linear probing) set of hypotheses, keyed by recombination state.
+ *
+ * Every slot stores the hypothesis' cached recombination hash next to the pointer, so probing
+ * never dereferences a hypothesis and the full Hypothesis::operator== only runs on hash matches.
+ * Erased slots become tombstones, so iterators to other elements stay valid across erase()
+ * (as with boost::unordered_set); insertions may rehash and invalidate them.
+ */
+class RecombinationSet
+{
+  struct Slot {
+    uint64_t hash;
+    Hypothesis *hypo; // NULL for empty slots and tombstones
+    bool tombstone;
+  };
+
+  std::vector<Slot> m_slots;
+  size_t m_size;
+  size_t m_tombstones;
+
+public:
+  class iterator : public std::iterator<std::forward_iterator_tag, Hypothesis*>
+  {
+    friend class RecombinationSet;
+    const Slot *m_slot;
+    const Slot *m_end;
+
+    iterator(const Slot *slot, const Slot *end) : m_slot(slot), m_end(end) {
+      SkipEmpty();
+    }
+
+    void SkipEmpty() {
+      while (m_slot != m_end && m_slot->hypo == NULL)
+        ++m_slot;
+    }
+
+  public:
+    iterator() : m_slot(NULL), m_end(NULL) {}
+
+    Hypothesis* const &operator*() const {
+      return m_slot->hypo;
+    }
+    Hypothesis* const *operator->() const {
+      return &m_slot->hypo;
+    }
+
+    iterator &operator++() {
+      ++m_slot;
+      SkipEmpty();
+      return *this;
+    }
+    iterator operator++(int) {
+      iterator ret = *this;
+      ++*this;
+      return ret;
+    }
+
+    bool operator==(const iterator &other) const {
+      return m_slot == other.m_slot;
+    }
+    bool operator!=(const iterator &other) const {
+      return m_slot != other.m_slot;
+    }
+  };
+  typedef iterator const_iterator;
+
+  RecombinationSet() : m_slots(16), m_size(0), m_tombstones(0) {
+    ClearSlots();
+  }
+
+  iterator begin() const {
+    return iterator(m_slots.data(), m_slots.data() + m_slots.size());
+  }
+  iterator end() const {
+    const Slot *end = m_slots.data() + m_slots.size();
+    return iterator(end, end);
+  }
+
+  size_t size() const {
+    return m_size;
+  }
+  bool empty() const {
+    return m_size == 0;
+  }
+
+  iterator find(const Hypothesis *hypo) const {
+    uint64_t hash = hypo->GetRecombinationHash();
+    size_t mask = m_slots.size() - 1;
+
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+      const Slot &slot = m_slots[i];
+      if (slot.hypo == NULL) {
+        if (!slot.tombstone)
+          return end();
+      } else if (slot.hash == hash && *slot.hypo == *hypo) {
+        return MakeIterator(i);
+      }
+    }
+  }
+
+  /** inserts the hypothesis, unless an equivalent one is already in the set */
+  std::pair<iterator, bool> insert(Hypothesis *hypo) {
+    if ((m_size + m_tombstones + 1) * 4 > m_slots.size() * 3)
+      Rehash();
+
+    uint64_t hash = hypo->GetRecombinationHash();
+    size_t mask = m_slots.size() - 1;
+    size_t target = m_slots.size();
+
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+      const Slot &slot = m_slots[i];
+      if (slot.hypo == NULL) {
+        if (target == m_slots.size())
+          target = i;
+        if (!slot.tombstone)
+          break;
+      } else if (slot.hash == hash && *slot.hypo == *hypo) {
+        return std::make_pair(MakeIterator(i), false);
+      }
+    }
+
+    Slot &slot = m_slots[target];
+    if (slot.tombstone)
+      m_tombstones--;
+
+    slot.hash = hash;
+    slot.hypo = hypo;
+    slot.tombstone = false;
+    m_size++;
+
+    return std::make_pair(MakeIterator(target), true);
+  }
+
+  void erase(const iterator &iter) {
+    Slot &slot = m_slots[iter.m_slot - m_slots.data()];
+    slot.hypo = NULL;
+    slot.tombstone = true;
+    m_size--;
+    m_tombstones++;
+
+    // a fully emptied set (as during pruning) gets rid of its tombstones at once
+    if (m_size == 0)
+      ClearSlots();
+  }
+
+  void clear() {
+    m_size = 0;
+    ClearSlots();
+  }
+
+private:
+  iterator MakeIterator(size_t i) const {
+    return iterator(m_slots.data() + i, m_slots.data() + m_slots.size());
+  }
+
+  void ClearSlots() {
+    for (size_t i = 0; i < m_slots.size(); ++i) {
+      m_slots[i].hypo = NULL;
+      m_slots[i].tombstone = false;
+    }
+    m_tombstones = 0;
+  }
+
+  void Rehash() {
+    size_t capacity = m_slots.size();
+    while ((m_size + 1) * 2 > capacity)
+      capacity *= 2;
+
+    std::vector<Slot> old(capacity);
+    old.swap(m_slots);
+    ClearSlots();
+
+    size_t mask = capacity - 1;
+    for (size_t j = 0; j < old.size(); ++j) {
+      if (old[j].hypo == NULL)
+        continue;
+
+      size_t i = old[j].hash & mask;
+      while (m_slots[i].hypo != NULL)
+        i = (i + 1) & mask;
+      m_slots[i] = old[j];
+    }
+  }
+};
+
+}
@@ -382,6 +382,34 @@ OutputAllFeatureScores(std::ostream &out, bool with_labels) const
   }
 }
 
+void
+ScoreComponentCollection::
+GetAllFeatureScores(std::vector<float> &out) const
+{
+  // same order of StaticData feature listing (stateless first), so that callers can
+  // slice the vector by feature without sending labels along; sparse scores have no
+  // fixed position in that layout and are left out
+  const vector<const StatelessFeatureFunction*>& slf
+  = StatelessFeatureFunction::GetStatelessFeatureFunctions();
+  const vector<const StatefulFeatureFunction*>& sff
+  = StatefulFeatureFunction::GetStatefulFeatureFunctions();
+
+  std::vector<FeatureFunction const*> ffs(slf.begin(), slf.end());
+  ffs.insert(ffs.end(), sff.begin(), sff.end());
+
+  for (size_t i = 0; i < ffs.size(); ++i) {
+    const FeatureFunction *ff = ffs[i];
+    if (!ff->IsTuneable() || !ff->HasTuneableComponents())
+      continue;
+
+    size_t offset = ff->GetIndex();
+    for (size_t j = 0; j < ff->GetNumScoreComponents(); ++j) {
+      if (ff->IsTuneableComponent(j))
+        out.push_back(m_scores[offset + j]);
+    }
+  }
+}
+
 void
 ScoreComponentCollection::
 OutputFeatureScores(std::ostream& out, FeatureFunction const* ff,
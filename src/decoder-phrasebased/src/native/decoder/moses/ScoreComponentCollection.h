@@ -154,10 +154,6 @@ public:
     return m_scores;
   }
 
-  const std::valarray<FValue> &getCoreFeatures() const {
-    return m_scores.getCoreFeatures();
-  }
-
   size_t Size() const {
     return m_scores.size();
   }
@@ -442,6 +438,10 @@ public:
   }
 
   void OutputAllFeatureScores(std::ostream &out, bool with_labels) const;
+  //! Appends the tuneable dense scores, stateless features first as in the feature listing of
+  //! MosesDecoder::getFeatures() (OutputAllFeatureScores() prints the stateful ones first).
+  //! Sparse feature scores are not included: callers that need them must use OutputAllFeatureScores().
+  void GetAllFeatureScores(std::vector<float> &out) const;
   void OutputFeatureScores(std::ostream& out, Moses::FeatureFunction const* ff,
                            std::string &lastName, bool with_labels) const;
 
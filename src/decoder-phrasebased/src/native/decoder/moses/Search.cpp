@@ -15,6 +15,7 @@ Search::Search(Manager& manager)
   , m_initialTransOpt(manager.GetTtask())
   , m_bitmaps(manager.GetSource().GetSize(), manager.GetSource().m_sourceCompleted)
   , interrupted_flag(0)
+  , m_degradation(NoDegradation)
 {
   m_initialTransOpt.SetInputPath(m_inputPath);
 }
@@ -24,6 +25,13 @@ bool
 Search::
 out_of_time()
 {
+  if (m_manager.HasTimeBudget() && m_manager.GetTimeBudgetUsed() >= 1.0) {
+    VERBOSE(1,"Decoding is out of its time budget" << std::endl);
+    interrupted_flag = 1;
+    m_degradation = InterruptedSearch;
+    return true;
+  }
+
   int const& timelimit = m_options.search.timeout;
   if (!timelimit) return false;
   double elapsed_time = GetUserTime();
@@ -31,6 +39,7 @@ out_of_time()
   VERBOSE(1,"Decoding is out of time (" << elapsed_time << ","
           << timelimit << ")" << std::endl);
   interrupted_flag = 1;
+  m_degradation = InterruptedSearch;
   return true;
 }
 
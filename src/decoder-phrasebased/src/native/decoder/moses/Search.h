@@ -34,6 +34,11 @@ public:
   //! Decode the sentence according to the specified search algorithm.
   virtual void Decode() = 0;
 
+  //! how much the search was simplified to fit the time budget of the Manager
+  SearchDegradation GetDegradation() const {
+    return m_degradation;
+  }
+
   explicit Search(Manager& manager);
   virtual ~Search() {}
 
@@ -49,6 +54,7 @@ protected:
 
   /** flag indicating that decoder ran out of time (see switch -time-out) */
   size_t interrupted_flag;
+  SearchDegradation m_degradation;
 
   bool out_of_time();
 };
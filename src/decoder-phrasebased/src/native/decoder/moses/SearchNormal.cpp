@@ -3,13 +3,132 @@
 #include "SearchNormal.h"
 #include "SentenceStats.h"
 #include "TranslationTask.h"
+#include "HypothesisPool.h"
+#include "StaticData.h"
+#include "ThreadPool.h"
+#include "FF/FeatureFunction.h"
 
 #include <boost/foreach.hpp>
+#include <boost/atomic.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/thread/condition_variable.hpp>
+#endif
 
 using namespace std;
 
 namespace Moses
 {
+
+// share of the time budget after which the search is tightened, if behind schedule
+static const double kReducedBeamBudget = 0.5;
+static const double kMonotoneSearchBudget = 0.75;
+// stacks and option lists are shrunk by this factor with a reduced beam
+static const size_t kReducedBeamFactor = 4;
+// hypotheses expanded between two checks of the time budget within a stack
+static const size_t kTimeBudgetCheckInterval = 8;
+
+#ifdef WITH_THREADS
+namespace
+{
+
+boost::atomic<uint64_t> s_nextSearchId(1);
+
+//! the search whose sentence the stateful features of this thread are set up for
+thread_local uint64_t t_boundSearchId = 0;
+
+//! the stateful features that keep per-sentence data in thread-local storage (see MMTInterpolatedLM)
+std::vector<FeatureFunction*> GetThreadBoundFeatures()
+{
+  const StaticData &staticData = StaticData::Instance();
+  const vector<FeatureFunction*> &ffs = FeatureFunction::GetFeatureFunctions();
+
+  std::vector<FeatureFunction*> bound;
+  for (size_t i = 0; i < ffs.size(); ++i) {
+    if (!ffs[i]->IsStateless() && !staticData.IsFeatureFunctionIgnored(*ffs[i]))
+      bound.push_back(ffs[i]);
+  }
+  return bound;
+}
+
+//! workers shared by all the searches, for the slices of a stack beyond the first one.
+//! search-threads is a global option: every search asks for the same number of workers
+ThreadPool &GetExpansionPool(size_t workers)
+{
+  static ThreadPool *pool = new ThreadPool(workers);
+  return *pool;
+}
+
+//! waits for the slices running on the thread pool, and keeps the first error
+class ExpansionLatch
+{
+public:
+  ExpansionLatch(size_t count) : m_count(count) { }
+
+  void CountDown(std::exception_ptr error) {
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (error && !m_error)
+      m_error = error;
+    if (--m_count == 0)
+      m_done.notify_all();
+  }
+
+  std::exception_ptr Wait() {
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (m_count > 0)
+      m_done.wait(lock);
+    return m_error;
+  }
+
+private:
+  boost::mutex m_mutex;
+  boost::condition_variable m_done;
+  size_t m_count;
+  std::exception_ptr m_error;
+};
+
+}
+
+/** one slice of a stack, expanded on a thread of the expansion pool */
+class ExpansionTask : public Task
+{
+public:
+  ExpansionTask(SearchNormal &search, const std::vector<const Hypothesis*> &hypos,
+                size_t begin, size_t end, SearchNormal::Staging &staging, ExpansionLatch &latch)
+    : m_search(search), m_hypos(hypos), m_begin(begin), m_end(end), m_staging(staging), m_latch(latch) { }
+
+  void Run() {
+    std::exception_ptr error;
+
+    try {
+      // the workers are shared: swap in the context of this sentence if the last slice of
+      // this thread was for another one. The state of a sentence is kept until the next
+      // swap, so that its CachedLM lasts over all the stacks of the sentence
+      if (t_boundSearchId != m_search.m_searchId) {
+        ttasksptr ttask = m_search.m_manager.GetTtask();
+        std::vector<FeatureFunction*> ffs = GetThreadBoundFeatures();
+        for (size_t i = 0; i < ffs.size(); ++i)
+          ffs[i]->InitializeForInput(ttask);
+        t_boundSearchId = m_search.m_searchId;
+      }
+
+      m_search.ExpandSlice(m_hypos, m_begin, m_end, m_staging);
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    m_latch.CountDown(error);
+  }
+
+private:
+  SearchNormal &m_search;
+  const std::vector<const Hypothesis*> &m_hypos;
+  size_t m_begin;
+  size_t m_end;
+  SearchNormal::Staging &m_staging;
+  ExpansionLatch &m_latch;
+};
+#endif
 /**
  * Organizing main function
  *
@@ -21,10 +140,15 @@ SearchNormal(Manager& manager, const TranslationOptionCollection &transOptColl)
   : Search(manager)
   , m_hypoStackColl(manager.GetSource().GetSize() + 1)
   , m_transOptColl(transOptColl)
+  , m_stackSize(m_options.search.stack_size)
+  , m_maxOptionsPerSpan(0)
+  , m_maxDistortion(m_options.reordering.max_distortion)
+  , m_completed(NULL)
 {
   VERBOSE(1, "Translating: " << m_source << endl);
 
   m_contextScope = m_manager.GetTtask()->GetScope().get();
+  m_bitmaps.SetEstimatedScores(&transOptColl.GetEstimatedScores());
 
   // initialize the stacks: create data structure and set limits
   std::vector < HypothesisStackNormal >::iterator iterStack;
@@ -35,11 +159,30 @@ SearchNormal(Manager& manager, const TranslationOptionCollection &transOptColl)
     sourceHypoColl->SetBeamWidth(this->m_options.search.beam_width);
     m_hypoStackColl[ind] = sourceHypoColl;
   }
+
+  // intra-sentence parallelism: only without stack diversity, whose thresholds are
+  // not monotonic and could not be safely read while expanding
+  m_searchId = 0;
+#ifdef WITH_THREADS
+  if (m_options.search.threads > 1 && m_options.search.stack_diversity == 0
+      && m_source.GetSize() >= m_options.search.threads_min_length) {
+    m_searchId = s_nextSearchId++;
+    m_stagings.resize(m_options.search.threads);
+    m_stagings[0].pool = &m_manager.GetHypothesisPool();
+    for (size_t i = 1; i < m_stagings.size(); ++i)
+      m_stagings[i].pool = new HypothesisPool();
+  }
+#endif
 }
 
 SearchNormal::~SearchNormal()
 {
   RemoveAllInColl(m_hypoStackColl);
+  RemoveAllInColl(m_completion);
+
+  // the hypotheses built by the other threads are gone with the stacks
+  for (size_t i = 1; i < m_stagings.size(); ++i)
+    delete m_stagings[i].pool;
 }
 
 
@@ -55,19 +198,129 @@ ProcessOneStack(HypothesisStack* hstack)
   // the stack is pruned before processing (lazy pruning):
   VERBOSE(3,"processing hypothesis from next stack");
   IFVERBOSE(2) stats.StartTimeStack();
-  sourceHypoColl.PruneToSize(m_options.search.stack_size);
+  sourceHypoColl.PruneToSize(m_stackSize);
   VERBOSE(3,std::endl);
   sourceHypoColl.CleanupArcList();
   IFVERBOSE(2)  stats.StopTimeStack();
 
+  if (m_stagings.size() > 1 && sourceHypoColl.size() > 1)
+    return ProcessOneStackInParallel(sourceHypoColl);
+
   // go through each hypothesis on the stack and try to expand it
   // BOOST_FOREACH(Hypothesis* h, sourceHypoColl)
   HypothesisStackNormal::const_iterator h;
-  for (h = sourceHypoColl.begin(); h != sourceHypoColl.end(); ++h)
+  size_t expanded = 0;
+  for (h = sourceHypoColl.begin(); h != sourceHypoColl.end(); ++h) {
+    if (++expanded % kTimeBudgetCheckInterval == 0 && this->out_of_time()) return false;
     ProcessOneHypothesis(**h);
+  }
   return true;
 }
 
+/**
+ * Expand a stack with several threads, each one taking a contiguous slice of it.
+ * The threads only read the stacks: expansions are built and scored into staging
+ * areas, and then added to the stacks here, in the very order of the serial loop.
+ * Stack thresholds only grow while a stack is expanded, so whatever the serial
+ * search would have built is built by the slices too, and the early discarding
+ * test is repeated on commit: the result is the same as the serial search.
+ * Slices stop early once out of the time budget, and then false is returned.
+ */
+bool
+SearchNormal::
+ProcessOneStackInParallel(HypothesisStackNormal &sourceHypoColl)
+{
+#ifdef WITH_THREADS
+  std::vector<const Hypothesis*> hypos(sourceHypoColl.begin(), sourceHypoColl.end());
+  size_t slices = std::min(m_stagings.size(), hypos.size());
+  size_t sliceSize = (hypos.size() + slices - 1) / slices;
+  slices = (hypos.size() + sliceSize - 1) / sliceSize;
+
+  ThreadPool &pool = GetExpansionPool(m_stagings.size() - 1);
+  ExpansionLatch latch(slices - 1);
+
+  for (size_t i = 1; i < slices; ++i) {
+    size_t end = std::min(hypos.size(), (i + 1) * sliceSize);
+    pool.Submit(boost::shared_ptr<Task>(new ExpansionTask(*this, hypos, i * sliceSize, end, m_stagings[i], latch)));
+  }
+
+  std::exception_ptr error;
+  try {
+    ExpandSlice(hypos, 0, sliceSize, m_stagings[0]);
+  } catch (...) {
+    error = std::current_exception();
+  }
+
+  std::exception_ptr workerError = latch.Wait();
+  if (!error)
+    error = workerError;
+
+  bool interrupted = false;
+  for (size_t i = 0; i < slices; ++i) {
+    interrupted |= m_stagings[i].interrupted;
+    std::vector<StagedExpansion> &expansions = m_stagings[i].expansions;
+    for (size_t j = 0; j < expansions.size(); ++j) {
+      if (error)
+        delete expansions[j].hypo;
+      else
+        CommitExpansion(expansions[j]);
+    }
+    expansions.clear();
+  }
+
+  if (error)
+    std::rethrow_exception(error);
+
+  // out_of_time() marks the search as interrupted
+  if (interrupted && this->out_of_time())
+    return false;
+#endif
+  return true;
+}
+
+void
+SearchNormal::
+ExpandSlice(const std::vector<const Hypothesis*> &hypos, size_t begin, size_t end, Staging &staging)
+{
+  staging.interrupted = false;
+  for (size_t i = begin; i < end; ++i) {
+    // only the clock is read here, out_of_time() updates the search and is left to the decoding thread
+    if ((i - begin + 1) % kTimeBudgetCheckInterval == 0
+        && m_manager.HasTimeBudget() && m_manager.GetTimeBudgetUsed() >= 1.0) {
+      staging.interrupted = true;
+      return;
+    }
+    ProcessOneHypothesis(*hypos[i], &staging);
+  }
+}
+
+void
+SearchNormal::
+CommitExpansion(const StagedExpansion &expansion)
+{
+  SentenceStats &stats = m_manager.GetSentenceStats();
+  if (expansion.hypo == NULL) {
+    stats.AddNotBuilt(expansion.notBuilt);
+    return;
+  }
+
+  Hypothesis *newHypo = expansion.hypo;
+  if (m_options.search.UseEarlyDiscarding()) {
+    const Bitmap &bitmap = newHypo->GetWordsBitmap();
+    HypothesisStackNormal &stack = *static_cast<HypothesisStackNormal*>(m_hypoStackColl[bitmap.GetNumWordsCovered()]);
+
+    // the thresholds have grown since the slice was expanded: the serial search would not have built this one
+    if (stack.IsDiscarded(expansion.expectedScore, bitmap.GetID(), m_options.search.early_discarding_threshold)) {
+      stats.AddNotBuilt();
+      delete newHypo;
+      return;
+    }
+  }
+
+  newHypo->SetId(m_manager.GetNextHypoId());
+  AddToStack(newHypo);
+}
+
 
 /**
  * Main decoder loop that translates a sentence by expanding
@@ -77,16 +330,143 @@ void SearchNormal::Decode()
 {
   // initial seed hypothesis: nothing translated, no words produced
   const Bitmap &initBitmap = m_bitmaps.GetInitialBitmap();
-  Hypothesis *hypo = new Hypothesis(m_manager, m_source, m_initialTransOpt, initBitmap, m_manager.GetNextHypoId());
+  Hypothesis *hypo = new (m_manager.GetHypothesisPool()) Hypothesis(m_manager, m_source, m_initialTransOpt, initBitmap, m_manager.GetNextHypoId());
 
   m_hypoStackColl[0]->AddPrune(hypo);
 
   // go through each stack
-  BOOST_FOREACH(HypothesisStack* hstack, m_hypoStackColl) {
-    if (!ProcessOneStack(hstack)) return;
+  for (size_t i = 0; i < m_hypoStackColl.size(); ++i) {
+    HypothesisStack* hstack = m_hypoStackColl[i];
+    AdaptToTimeBudget(i);
+    if (!ProcessOneStack(hstack)) {
+      // out of time: better a rough translation of the whole sentence than part of it
+      CompleteBestHypothesis(hstack->size() > 0 ? *hstack : *actual_hypoStack);
+      return;
+    }
     IFVERBOSE(2) OutputHypoStackSize();
     actual_hypoStack = static_cast<HypothesisStackNormal*>(hstack);
   }
+
+  // the tightened limits may have left no way to the end: complete the furthest hypothesis
+  if (m_hypoStackColl.back()->size() == 0) {
+    for (size_t i = m_hypoStackColl.size() - 1; i-- > 0;) {
+      if (m_hypoStackColl[i]->size() > 0) {
+        CompleteBestHypothesis(*m_hypoStackColl[i]);
+        return;
+      }
+    }
+  }
+}
+
+/**
+ * Tighten the search when more than kReducedBeamBudget of the time budget is gone
+ * and the share of the stacks left is larger than the share of the budget left:
+ * smaller stacks and option lists first, then no reordering at kMonotoneSearchBudget,
+ * apart from the jumps back that fill the gaps already left (see ProcessOneHypothesis()).
+ * Searches on schedule are never changed.
+ */
+void
+SearchNormal::
+AdaptToTimeBudget(size_t stackIndex)
+{
+  if (!m_manager.HasTimeBudget()) return;
+
+  double used = m_manager.GetTimeBudgetUsed();
+  double progress = (double) stackIndex / m_hypoStackColl.size();
+  if (used <= progress) return;
+
+  if (m_degradation < ReducedBeam && used >= kReducedBeamBudget) {
+    size_t stackSize = m_stackSize ? m_stackSize : DEFAULT_MAX_HYPOSTACK_SIZE;
+    m_stackSize = std::max(stackSize / kReducedBeamFactor, (size_t) 1);
+    m_maxOptionsPerSpan = std::max(m_options.search.max_trans_opt_per_cov / kReducedBeamFactor, (size_t) 1);
+
+    for (size_t i = stackIndex; i < m_hypoStackColl.size(); ++i)
+      static_cast<HypothesisStackNormal*>(m_hypoStackColl[i])->SetMaxHypoStackSize(m_stackSize, m_options.search.stack_diversity);
+
+    m_degradation = ReducedBeam;
+    VERBOSE(1, "Behind schedule at stack " << stackIndex << ", reducing the beam to " << m_stackSize << endl);
+  }
+
+  if (m_degradation < MonotoneSearch && used >= kMonotoneSearchBudget) {
+    m_maxDistortion = 0; // widened for the hypotheses with a gap
+
+    m_degradation = MonotoneSearch;
+    VERBOSE(1, "Behind schedule at stack " << stackIndex << ", switching to monotone search" << endl);
+  }
+}
+
+/**
+ * Extend the best hypothesis of the stack with the best translation option, until
+ * the sentence is covered. Candidate spans follow the reordering rules of the search
+ * (see ProcessOneHypothesis()) and are compared by option score plus the future score
+ * of what is left, so that the longer ones are not favoured. If no option fits, the
+ * partial hypothesis is left as it is.
+ */
+void
+SearchNormal::
+CompleteBestHypothesis(const HypothesisStack &stack)
+{
+  const Hypothesis *hypo = stack.GetBestHypothesis();
+  if (hypo == NULL) return;
+
+  // the configured limit: the hypothesis may have been built before the switch to monotone search
+  const int maxDistortion = m_options.reordering.max_distortion;
+  const ReorderingConstraint &reoConstraint = m_source.GetReorderingConstraint();
+  const SquareMatrix &estimatedScores = m_transOptColl.GetEstimatedScores();
+  size_t const sourceSize = m_source.GetSize();
+
+  while (!hypo->GetWordsBitmap().IsComplete()) {
+    const Bitmap &bitmap = hypo->GetWordsBitmap();
+    const Range &prevRange = hypo->GetCurrSourceWordsRange();
+    size_t firstGapPos = bitmap.GetFirstGapPos();
+    Range firstGap(firstGapPos, firstGapPos);
+
+    const TranslationOption *best = NULL;
+    float bestScore = -numeric_limits<float>::infinity();
+
+    for (size_t startPos = firstGapPos; startPos < sourceSize; ++startPos) {
+      if (bitmap.GetValue(startPos)) continue;
+      if (maxDistortion >= 0
+          && m_source.ComputeDistortionDistance(prevRange, Range(startPos, startPos)) > maxDistortion)
+        continue;
+
+      TranslationOptionList const* tol;
+      size_t endPos = startPos;
+      for (tol = m_transOptColl.GetTranslationOptionList(startPos, endPos);
+           tol && endPos < sourceSize && !bitmap.GetValue(endPos);
+           tol = m_transOptColl.GetTranslationOptionList(startPos, ++endPos)) {
+        Range extRange(startPos, endPos);
+        if (tol->size() == 0 || !reoConstraint.Check(bitmap, startPos, endPos))
+          continue;
+
+        // away from the first gap, the jump back to it must stay within the limit
+        if (maxDistortion >= 0 && startPos != firstGapPos
+            && m_source.ComputeDistortionDistance(extRange, firstGap) > maxDistortion)
+          continue;
+
+        // lists are sorted, best option first
+        const TranslationOption *transOpt = *tol->begin();
+        float score = transOpt->GetFutureScore() + estimatedScores.CalcEstimatedScore(bitmap, startPos, endPos);
+        if (score > bestScore) {
+          best = transOpt;
+          bestScore = score;
+        }
+      }
+    }
+
+    if (best == NULL) break;
+
+    const Bitmap &nextBitmap = m_bitmaps.GetBitmap(bitmap, best->GetSourceWordsRange());
+    Hypothesis *newHypo = new (m_manager.GetHypothesisPool()) Hypothesis(*hypo, *best, nextBitmap, m_manager.GetNextHypoId());
+    newHypo->EvaluateWhenApplied(nextBitmap.GetEstimatedScore(), m_contextScope->GetFeatureWeights());
+
+    m_completion.push_back(newHypo);
+    hypo = newHypo;
+  }
+
+  m_completed = hypo;
+
+  VERBOSE(1, "Search incomplete, added " << m_completion.size() << " phrases to the best partial hypothesis" << endl);
 }
 
 
@@ -97,7 +477,7 @@ void SearchNormal::Decode()
  */
 void
 SearchNormal::
-ProcessOneHypothesis(const Hypothesis &hypothesis)
+ProcessOneHypothesis(const Hypothesis &hypothesis, Staging *staging)
 {
   // since we check for reordering limits, its good to have that limit handy
   bool isWordLattice = m_source.GetType() == WordLatticeInput;
@@ -109,8 +489,16 @@ ProcessOneHypothesis(const Hypothesis &hypothesis)
   ReorderingConstraint const&
   ReoConstraint = m_source.GetReorderingConstraint();
 
+  // in monotone search, a hypothesis left with a gap may still jump back to it, but
+  // no further: it fills the gap and goes on monotonically instead of being stranded
+  int maxDistortion = m_maxDistortion;
+  if (m_degradation == MonotoneSearch && hypoFirstGapPos != NOT_FOUND) {
+    Range firstGap(hypoFirstGapPos, hypoFirstGapPos);
+    maxDistortion = m_source.ComputeDistortionDistance(hypothesis.GetCurrSourceWordsRange(), firstGap);
+  }
+
   // no limit of reordering: only check for overlap
-  if (m_options.reordering.max_distortion < 0) {
+  if (maxDistortion < 0) {
 
     for (size_t startPos = hypoFirstGapPos ; startPos < sourceSize ; ++startPos) {
       TranslationOptionList const* tol;
@@ -125,7 +513,7 @@ ProcessOneHypothesis(const Hypothesis &hypothesis)
         }
 
         //TODO: does this method include incompatible WordLattice hypotheses?
-        ExpandAllHypotheses(hypothesis, startPos, endPos);
+        ExpandAllHypotheses(hypothesis, startPos, endPos, staging);
       }
     }
     return; // done with special case (no reordering limit)
@@ -166,7 +554,7 @@ ProcessOneHypothesis(const Hypothesis &hypothesis)
 
     Range currentStartRange(startPos, startPos);
     if(m_source.ComputeDistortionDistance(prevRange, currentStartRange)
-        > m_options.reordering.max_distortion)
+        > maxDistortion)
       continue;
 
     TranslationOptionList const* tol;
@@ -202,7 +590,7 @@ ProcessOneHypothesis(const Hypothesis &hypothesis)
 
       if (isLeftMostEdge) {
         // any length extension is okay if starting at left-most edge
-        ExpandAllHypotheses(hypothesis, startPos, endPos);
+        ExpandAllHypotheses(hypothesis, startPos, endPos, staging);
       } else { // starting somewhere other than left-most edge, use caution
         // the basic idea is this: we would like to translate a phrase
         // starting from a position further right than the left-most
@@ -215,10 +603,10 @@ ProcessOneHypothesis(const Hypothesis &hypothesis)
         Range bestNextExtension(hypoFirstGapPos, hypoFirstGapPos);
 
         if (m_source.ComputeDistortionDistance(extRange, bestNextExtension)
-            > m_options.reordering.max_distortion) continue;
+            > maxDistortion) continue;
 
         // everything is fine, we're good to go
-        ExpandAllHypotheses(hypothesis, startPos, endPos);
+        ExpandAllHypotheses(hypothesis, startPos, endPos, staging);
       }
     }
   }
@@ -230,19 +618,40 @@ ProcessOneHypothesis(const Hypothesis &hypothesis)
  * \param hypothesis hypothesis to be expanded upon
  * \param startPos first word position of span covered
  * \param endPos last word position of span covered
+ * \param staging where to put the new hypotheses, NULL to add them to the stacks
  */
 
 void
 SearchNormal::
-ExpandAllHypotheses(const Hypothesis &hypothesis, size_t startPos, size_t endPos)
+ExpandAllHypotheses(const Hypothesis &hypothesis, size_t startPos, size_t endPos,
+                    Staging *staging)
 {
+  // loop through all translation options
+  const TranslationOptionList* tol
+  = m_transOptColl.GetTranslationOptionList(startPos, endPos);
+  if (!tol || tol->size() == 0) return;
+
+  // Create new bitmap
+  const Bitmap &sourceCompleted = hypothesis.GetWordsBitmap();
+  const TranslationOption &transOpt = **tol->begin();
+  const Range &nextRange = transOpt.GetSourceWordsRange();
+  const Bitmap *nextBitmapPtr;
+#ifdef WITH_THREADS
+  if (staging) {
+    boost::mutex::scoped_lock lock(m_bitmapsMutex);
+    nextBitmapPtr = &m_bitmaps.GetBitmap(sourceCompleted, nextRange);
+  } else
+#endif
+    nextBitmapPtr = &m_bitmaps.GetBitmap(sourceCompleted, nextRange);
+  const Bitmap &nextBitmap = *nextBitmapPtr;
+
+  // future score of the words left after this expansion, computed once per bitmap
+  float estimatedScore = nextBitmap.GetEstimatedScore();
+
   // early discarding: check if hypothesis is too bad to build
   // this idea is explained in (Moore&Quirk, MT Summit 2007)
   float expectedScore = 0.0f;
 
-  const Bitmap &sourceCompleted = hypothesis.GetWordsBitmap();
-  float estimatedScore = m_transOptColl.GetEstimatedScores().CalcEstimatedScore( sourceCompleted, startPos, endPos );
-
   if (m_options.search.UseEarlyDiscarding()) {
     // expected score is based on score of current hypothesis
     expectedScore = hypothesis.GetScore();
@@ -251,20 +660,34 @@ ExpandAllHypotheses(const Hypothesis &hypothesis, size_t startPos, size_t endPos
     expectedScore += estimatedScore;
   }
 
-  // loop through all translation options
-  const TranslationOptionList* tol
-  = m_transOptColl.GetTranslationOptionList(startPos, endPos);
-  if (!tol || tol->size() == 0) return;
+  // all the options of the list cover the same span, so they all land on the same stack
+  HypothesisStackNormal &stack = *static_cast<HypothesisStackNormal*>(m_hypoStackColl[nextBitmap.GetNumWordsCovered()]);
 
-  // Create new bitmap
-  const TranslationOption &transOpt = **tol->begin();
-  const Range &nextRange = transOpt.GetSourceWordsRange();
-  const Bitmap &nextBitmap = m_bitmaps.GetBitmap(sourceCompleted, nextRange);
+  // the time budget may limit the options to the best ones
+  TranslationOptionList::const_iterator end = tol->end();
+  if (m_maxOptionsPerSpan && tol->size() > m_maxOptionsPerSpan)
+    end = tol->begin() + m_maxOptionsPerSpan;
 
   TranslationOptionList::const_iterator iter;
-  for (iter = tol->begin() ; iter != tol->end() ; ++iter) {
+  for (iter = tol->begin() ; iter != end ; ++iter) {
     const TranslationOption &transOpt = **iter;
-    ExpandHypothesis(hypothesis, transOpt, expectedScore, estimatedScore, nextBitmap);
+
+    // worst possible score may have changed -> recompute
+    if (m_options.search.UseEarlyDiscarding()
+        && stack.IsDiscarded(expectedScore + transOpt.GetFutureScore(), nextBitmap.GetID(),
+                             m_options.search.early_discarding_threshold)) {
+      // options are sorted by future score: if this one is below the limit,
+      // so are the remaining ones, don't build any of them
+      if (staging) {
+        StagedExpansion notBuilt = { NULL, 0.0f, (size_t) (end - iter) };
+        staging->expansions.push_back(notBuilt);
+      } else {
+        m_manager.GetSentenceStats().AddNotBuilt(end - iter);
+      }
+      break;
+    }
+
+    ExpandHypothesis(hypothesis, transOpt, expectedScore, estimatedScore, nextBitmap, staging);
   }
 }
 
@@ -276,88 +699,60 @@ ExpandAllHypotheses(const Hypothesis &hypothesis, size_t startPos, size_t endPos
  *        that is applied to create the new hypothesis
  * \param expectedScore base score for early discarding
  *        (base hypothesis score plus future score estimation)
+ * \param staging where to put the new hypothesis, NULL to add it to its stack
  */
 void SearchNormal::ExpandHypothesis(const Hypothesis &hypothesis,
                                     const TranslationOption &transOpt,
                                     float expectedScore,
                                     float estimatedScore,
-                                    const Bitmap &bitmap)
+                                    const Bitmap &bitmap,
+                                    Staging *staging)
 {
-  SentenceStats &stats = m_manager.GetSentenceStats();
-
-  Hypothesis *newHypo;
-  if (! m_options.search.UseEarlyDiscarding()) {
-    // simple build, no questions asked
-    IFVERBOSE(2) {
-      stats.StartTimeBuildHyp();
-    }
-    newHypo = new Hypothesis(hypothesis, transOpt, bitmap, m_manager.GetNextHypoId());
-    IFVERBOSE(2) {
-      stats.StopTimeBuildHyp();
-    }
-    if (newHypo==NULL) return;
-
-    IFVERBOSE(2) {
-      m_manager.GetSentenceStats().StartTimeOtherScore();
-    }
+  if (staging) {
+    // no ids nor stats outside of the decoding thread: both are taken care of on commit
+    Hypothesis *newHypo = new (*staging->pool) Hypothesis(hypothesis, transOpt, bitmap, 0);
     newHypo->EvaluateWhenApplied(estimatedScore, m_contextScope->GetFeatureWeights());
-    IFVERBOSE(2) {
-      m_manager.GetSentenceStats().StopTimeOtherScore();
 
-      // TODO: these have been meaningless for a while.
-      // At least since commit 67fb5c
-      // should now be measured in SearchNormal.cpp:254 instead, around CalcFutureScore2()
-      // CalcFutureScore2() also called in BackwardsEdge::Initialize().
-      //
-      // however, CalcFutureScore2() should be quick
-      // since it uses dynamic programming results in SquareMatrix
-      m_manager.GetSentenceStats().StartTimeEstimateScore();
-      m_manager.GetSentenceStats().StopTimeEstimateScore();
-    }
-  } else
-    // early discarding: check if hypothesis is too bad to build
-  {
-    // worst possible score may have changed -> recompute
-    size_t wordsTranslated = hypothesis.GetWordsBitmap().GetNumWordsCovered() + transOpt.GetSize();
-    float allowedScore = m_hypoStackColl[wordsTranslated]->GetWorstScore();
-    if (m_options.search.stack_diversity) {
-      WordsBitmapID id = hypothesis.GetWordsBitmap().GetIDPlus(transOpt.GetStartPos(), transOpt.GetEndPos());
-      float allowedScoreForBitmap = m_hypoStackColl[wordsTranslated]->GetWorstScoreForBitmap( id );
-      allowedScore = std::min( allowedScore, allowedScoreForBitmap );
-    }
-    allowedScore += m_options.search.early_discarding_threshold;
+    StagedExpansion expansion = { newHypo, expectedScore + transOpt.GetFutureScore(), 0 };
+    staging->expansions.push_back(expansion);
+    return;
+  }
 
-    // add expected score of translation option
-    expectedScore += transOpt.GetFutureScore();
+  SentenceStats &stats = m_manager.GetSentenceStats();
 
-    // check if transOpt score push it already below limit
-    if (expectedScore < allowedScore) {
-      IFVERBOSE(2) {
-        stats.AddNotBuilt();
-      }
-      return;
-    }
+  IFVERBOSE(2) {
+    stats.StartTimeBuildHyp();
+  }
+  Hypothesis *newHypo = new (m_manager.GetHypothesisPool()) Hypothesis(hypothesis, transOpt, bitmap, m_manager.GetNextHypoId());
+  IFVERBOSE(2) {
+    stats.StopTimeBuildHyp();
+  }
+  if (newHypo==NULL) return;
 
-    // build the hypothesis without scoring
-    IFVERBOSE(2) {
-      stats.StartTimeBuildHyp();
-    }
-    newHypo = new Hypothesis(hypothesis, transOpt, bitmap, m_manager.GetNextHypoId());
-    if (newHypo==NULL) return;
-    IFVERBOSE(2) {
-      stats.StopTimeBuildHyp();
-    }
+  IFVERBOSE(2) {
+    m_manager.GetSentenceStats().StartTimeOtherScore();
+  }
+  newHypo->EvaluateWhenApplied(estimatedScore, m_contextScope->GetFeatureWeights());
+  IFVERBOSE(2) {
+    m_manager.GetSentenceStats().StopTimeOtherScore();
+
+    // TODO: these have been meaningless for a while.
+    // At least since commit 67fb5c
+    // should now be measured in SearchNormal.cpp:254 instead, around CalcFutureScore2()
+    // CalcFutureScore2() also called in BackwardsEdge::Initialize().
+    //
+    // however, CalcFutureScore2() should be quick
+    // since it uses dynamic programming results in SquareMatrix
+    m_manager.GetSentenceStats().StartTimeEstimateScore();
+    m_manager.GetSentenceStats().StopTimeEstimateScore();
+  }
 
-    // ... and check if that is below the limit
-    if (expectedScore < allowedScore) {
-      IFVERBOSE(2) {
-        stats.AddEarlyDiscarded();
-      }
-      delete newHypo;
-      return;
-    }
+  AddToStack(newHypo);
+}
 
-  }
+void SearchNormal::AddToStack(Hypothesis *newHypo)
+{
+  SentenceStats &stats = m_manager.GetSentenceStats();
 
   // logging for the curious
   IFVERBOSE(3) {
@@ -386,6 +781,9 @@ const std::vector < HypothesisStack* >& SearchNormal::GetHypothesisStacks() cons
  */
 const Hypothesis *SearchNormal::GetBestHypothesis() const
 {
+  if (m_completed)
+    return m_completed;
+
   if (interrupted_flag == 0) {
     const HypothesisStackNormal &hypoColl = *static_cast<HypothesisStackNormal*>(m_hypoStackColl.back());
     return hypoColl.GetBestHypothesis();
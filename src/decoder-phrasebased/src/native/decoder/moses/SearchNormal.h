@@ -7,11 +7,17 @@
 #include "TranslationOptionCollection.h"
 #include "Timer.h"
 
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
+
 namespace Moses
 {
 
 class Manager;
 class TranslationOptionCollection;
+class HypothesisPool;
+class ExpansionTask;
 
 /** Functions and variables you need to decoder an input using the
  *  phrase-based decoder (NO cube-pruning)
@@ -30,23 +36,80 @@ protected:
   /** pre-computed list of translation options for the phrases in this sentence */
   const TranslationOptionCollection &m_transOptColl;
 
+  // search limits, from the options but tightened when running out of the time budget
+  size_t m_stackSize;
+  size_t m_maxOptionsPerSpan; //!< 0 for all the options
+  int m_maxDistortion; //!< 0 in monotone search, where ProcessOneHypothesis() widens it to fill gaps
+
+  //! greedy completion of the best partial hypothesis, when the search is interrupted
+  //! or ends with an empty last stack
+  std::vector<Hypothesis*> m_completion;
+  const Hypothesis *m_completed; //!< end of the completion, NULL if the search reached the end
+
+  /** expansion built off the stacks by a parallel slice, committed later in serial order */
+  struct StagedExpansion {
+    Hypothesis *hypo; //!< scored hypothesis, NULL if the rest of an option list was not built
+    float expectedScore; //!< early discarding estimate of the expansion
+    size_t notBuilt; //!< number of options skipped, when hypo is NULL
+  };
+
+  /** output of one slice of a stack expanded in parallel (see search-threads) */
+  struct Staging {
+    HypothesisPool *pool;
+    std::vector<StagedExpansion> expansions;
+    bool interrupted; //!< the slice stopped early, out of the time budget
+  };
+
+  // parallel expansion: one staging area for each thread, the first one is used by the decoding thread
+  std::vector<Staging> m_stagings;
+  uint64_t m_searchId; //!< identifies this search on the worker threads
+#ifdef WITH_THREADS
+  boost::mutex m_bitmapsMutex; //!< m_bitmaps is shared by the threads expanding a stack
+#endif
+
   // functions for creating hypotheses
 
   virtual bool
   ProcessOneStack(HypothesisStack* hstack);
 
+  //! expand the hypotheses of a stack with all the threads in m_stagings, same results as the serial loop.
+  //! Returns false if out of the time budget before the end, like ProcessOneStack()
+  bool ProcessOneStackInParallel(HypothesisStackNormal &sourceHypoColl);
+
+  //! worker side of ProcessOneStackInParallel()
+  void ExpandSlice(const std::vector<const Hypothesis*> &hypos, size_t begin, size_t end,
+                   Staging &staging);
+
+  //! replay a staged expansion as the serial search would have done it
+  void CommitExpansion(const StagedExpansion &expansion);
+
+  /** expansion functions: with a staging area, hypotheses are built and scored
+   * but not added to the stacks, and the stacks are only read */
   virtual void
-  ProcessOneHypothesis(const Hypothesis &hypothesis);
+  ProcessOneHypothesis(const Hypothesis &hypothesis, Staging *staging = NULL);
 
   virtual void
-  ExpandAllHypotheses(const Hypothesis &hypothesis, size_t startPos, size_t endPos);
+  ExpandAllHypotheses(const Hypothesis &hypothesis, size_t startPos, size_t endPos,
+                      Staging *staging);
 
   virtual void
   ExpandHypothesis(const Hypothesis &hypothesis,
                    const TranslationOption &transOpt,
                    float expectedScore,
                    float estimatedScore,
-                   const Bitmap &bitmap);
+                   const Bitmap &bitmap,
+                   Staging *staging);
+
+  //! add a scored hypothesis to its stack
+  void AddToStack(Hypothesis *newHypo);
+
+  //! tighten the search limits if behind schedule, before expanding the given stack
+  void AdaptToTimeBudget(size_t stackIndex);
+
+  //! greedily extend the best hypothesis of a stack into a complete one, see m_completed
+  void CompleteBestHypothesis(const HypothesisStack &stack);
+
+  friend class ExpansionTask;
 
 public:
   SearchNormal(Manager& manager, const TranslationOptionCollection &transOptColl);
@@ -0,0 +1,227 @@
+#include <boost/test/unit_test.hpp>
+
+#include <cstdlib>
+#include <limits>
+#include <unistd.h>
+
+#include "FF/StatelessFeatureFunction.h"
+#include "ContextScope.h"
+#include "Hypothesis.h"
+#include "HypothesisStack.h"
+#include "Manager.h"
+#include "SearchNormal.h"
+#include "Sentence.h"
+#include "StaticData.h"
+#include "Timer.h"
+#include "TranslationOptionCollection.h"
+#include "TranslationTask.h"
+
+using namespace Moses;
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(search_normal)
+
+//! phrase scores cached in the target phrases, plus a reward for translating s1 before s0
+class MockReorderingScore : public StatelessFeatureFunction
+{
+public:
+  MockReorderingScore() : StatelessFeatureFunction(1, "MockReorderingScore") {}
+
+  bool IsUseable(const FactorMask &mask) const {
+    return true;
+  }
+
+  void EvaluateInIsolation(const Phrase &source, const TargetPhrase &targetPhrase
+                           , ScoreComponentCollection &scoreBreakdown
+                           , ScoreComponentCollection &estimatedScores) const {}
+  void EvaluateWithSourceContext(const InputType &input, const InputPath &inputPath
+                                 , const TargetPhrase &targetPhrase, const StackVec *stackVec
+                                 , ScoreComponentCollection &scoreBreakdown
+                                 , ScoreComponentCollection *estimatedScores) const {}
+  void EvaluateTranslationOptionListWithSourceContext(const InputType &input
+      , const TranslationOptionList &translationOptionList) const {}
+  void EvaluateWhenApplied(const Hypothesis &hypo, ScoreComponentCollection *accumulator) const {
+    if (hypo.GetCurrSourceWordsRange().GetStartPos() == 1 && !hypo.GetWordsBitmap().GetValue(0))
+      accumulator->PlusEquals(this, 10.0f);
+  }
+  void EvaluateWhenApplied(const ChartHypothesis &hypo, ScoreComponentCollection *accumulator) const {}
+};
+
+//! features stay registered for the whole process, like the ones loaded from moses.ini
+static MockReorderingScore &GetReorderingScore()
+{
+  static MockReorderingScore *score = NULL;
+  if (score == NULL) {
+    score = new MockReorderingScore();
+    FeatureFunction::Register(score);
+  }
+  return *score;
+}
+
+//! translation options added by hand, instead of being looked up in the phrase tables
+class MockTranslationOptions : public TranslationOptionCollection
+{
+public:
+  MockTranslationOptions(ttasksptr const& ttask, InputType const& src)
+    : TranslationOptionCollection(ttask, src) {}
+
+  void AddOption(TranslationOption *transOpt) {
+    Add(transOpt);
+  }
+
+  //! sorted best first, as the search expects them
+  void Finish() {
+    Sort();
+    CalcEstimatedScore();
+  }
+
+  bool CreateTranslationOptionsForRange(const DecodeGraph &decodeStepList,
+                                        size_t startPosition, size_t endPosition,
+                                        bool adhereTableLimit, size_t graphInd) {
+    return false;
+  }
+
+protected:
+  void ProcessUnknownWord(size_t sourcePos) {}
+};
+
+//! a search that runs behind schedule once the given number of stacks are expanded
+class BehindScheduleSearch : public SearchNormal
+{
+public:
+  BehindScheduleSearch(Manager &manager, const TranslationOptionCollection &transOptColl,
+                       size_t onScheduleStacks, double budgetUsed)
+    : SearchNormal(manager, transOptColl), m_onScheduleStacks(onScheduleStacks), m_processed(0) {
+    // a stopped clock: the share of the budget used stays the same for the whole search
+    m_clock.start();
+    usleep(20000);
+    m_clock.stop();
+    m_budget = m_clock.get_elapsed_time() / budgetUsed;
+  }
+
+protected:
+  bool ProcessOneStack(HypothesisStack *hstack) {
+    bool inTime = SearchNormal::ProcessOneStack(hstack);
+    if (++m_processed == m_onScheduleStacks)
+      m_manager.SetTimeBudget(m_clock, m_budget);
+    return inTime;
+  }
+
+private:
+  size_t m_onScheduleStacks;
+  size_t m_processed;
+  Timer m_clock;
+  double m_budget;
+};
+
+class SearchFixture
+{
+public:
+  SearchFixture() : m_score(GetReorderingScore()), m_weights(new ScoreComponentCollection()) {
+    m_weights->Assign(&m_score, 1.0f);
+  }
+
+  void Build(const string &source, size_t stackSize, size_t threads = 1,
+             float earlyDiscardingThreshold = -numeric_limits<float>::infinity()) {
+    m_options.reset();
+    m_manager.reset();
+
+    AllOptions *opts = new AllOptions(*StaticData::Instance().options());
+    opts->search.stack_size = stackSize;
+    opts->search.threads = threads;
+    opts->search.threads_min_length = 0;
+    opts->search.beam_width = -numeric_limits<float>::infinity();
+    opts->search.early_discarding_threshold = earlyDiscardingThreshold;
+
+    m_sentence.reset(new Sentence(AllOptions::ptr(opts), 0, source));
+    m_scope.reset(new ContextScope(m_weights));
+    m_ttask = TranslationTask::create(m_sentence, boost::shared_ptr<IOWrapper>(), m_scope);
+    m_manager.reset(new Manager(m_ttask));
+    m_manager->ResetSentenceStats(*m_sentence);
+
+    m_options.reset(new MockTranslationOptions(m_ttask, *m_sentence));
+  }
+
+  void AddOption(size_t startPos, size_t endPos, const string &target, float score) {
+    TargetPhrase targetPhrase(m_ttask);
+    targetPhrase.CreateFromString(Output, m_sentence->options()->output.factor_order, target, NULL);
+    targetPhrase.GetScoreBreakdown().Assign(&m_score, score);
+    targetPhrase.EvaluateInIsolation(Phrase(), vector<FeatureFunction*>(1, &m_score));
+
+    m_options->AddOption(new TranslationOption(Range(startPos, endPos), targetPhrase));
+  }
+
+  MockReorderingScore &m_score;
+  boost::shared_ptr<ScoreComponentCollection> m_weights;
+  boost::shared_ptr<Sentence> m_sentence;
+  boost::shared_ptr<ContextScope> m_scope;
+  ttasksptr m_ttask;
+  boost::shared_ptr<Manager> m_manager;
+  boost::shared_ptr<MockTranslationOptions> m_options;
+};
+
+BOOST_FIXTURE_TEST_CASE(monotone_switch_fills_gaps, SearchFixture)
+{
+  Build("s0 s1 s2 s3", 4);
+  for (size_t pos = 0; pos < 4; ++pos)
+    AddOption(pos, pos, "t" + string(1, '0' + pos), -1.0f);
+  m_options->Finish();
+
+  // behind schedule after the first stack: the reduced beam only keeps the hypothesis
+  // that translated s1 first, and reordering is switched off with s0 left to translate
+  BehindScheduleSearch search(*m_manager, *m_options, 1, 0.8);
+  search.Decode();
+
+  BOOST_CHECK_EQUAL(search.GetDegradation(), MonotoneSearch);
+
+  // the gap was filled by the search itself, not by the completion of a partial hypothesis
+  BOOST_CHECK(search.GetHypothesisStacks().back()->size() > 0);
+  const Hypothesis *best = search.GetBestHypothesis();
+  BOOST_REQUIRE(best != NULL);
+  BOOST_CHECK(best->GetWordsBitmap().IsComplete());
+
+  const Hypothesis *first = best;
+  while (first->GetPrevHypo()->GetPrevHypo() != NULL)
+    first = first->GetPrevHypo();
+  BOOST_CHECK_EQUAL(first->GetCurrSourceWordsRange().GetStartPos(), 1U);
+}
+
+BOOST_FIXTURE_TEST_CASE(parallel_expansion_matches_serial, SearchFixture)
+{
+  const char *words[] = {"a", "b", "c"};
+  string bestPhrase[2];
+  float bestScore[2];
+
+  // several searches in a row share the expansion threads; the last ones discard early,
+  // before building the hypotheses and again when committing them
+  for (int sentence = 0; sentence < 4; ++sentence) {
+    float earlyDiscardingThreshold = sentence < 2 ? -numeric_limits<float>::infinity() : -0.5f;
+    for (size_t run = 0; run < 2; ++run) {
+      Build("s0 s1 s2 s3 s4 s5 s6 s7 s8 s9", 20, run == 0 ? 1 : 4, earlyDiscardingThreshold);
+
+      srand(100 + sentence);
+      for (size_t startPos = 0; startPos < 10; ++startPos) {
+        for (size_t endPos = startPos; endPos < std::min(startPos + 3, (size_t) 10); ++endPos) {
+          for (size_t i = 0; i < 3; ++i)
+            AddOption(startPos, endPos, words[rand() % 3], -(float) (rand() % 10000) / 997.0f);
+        }
+      }
+      m_options->Finish();
+
+      SearchNormal search(*m_manager, *m_options);
+      search.Decode();
+
+      const Hypothesis *best = search.GetBestHypothesis();
+      BOOST_REQUIRE(best != NULL);
+      Phrase phrase;
+      best->GetOutputPhrase(phrase);
+      bestPhrase[run] = phrase.GetStringRep(m_sentence->options()->output.factor_order);
+      bestScore[run] = best->GetFutureScore();
+    }
+
+    BOOST_CHECK_EQUAL(bestPhrase[1], bestPhrase[0]);
+    BOOST_CHECK_EQUAL(bestScore[1], bestScore[0]);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
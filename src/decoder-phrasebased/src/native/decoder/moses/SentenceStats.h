@@ -157,8 +157,8 @@ public:
   void AddEarlyDiscarded() {
     m_numHyposEarlyDiscarded++;
   }
-  void AddNotBuilt() {
-    m_numHyposNotBuilt++;
+  void AddNotBuilt(size_t count = 1) {
+    m_numHyposNotBuilt += count;
   }
   void AddDiscarded() {
     m_numHyposDiscarded++;
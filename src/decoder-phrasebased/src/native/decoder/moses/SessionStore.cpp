@@ -0,0 +1,91 @@
+#include "SessionStore.h"
+#include "ContextScope.h"
+
+using namespace std;
+using namespace mmt::decoder;
+
+SessionStore::SessionStore(chrono::seconds ttl) : ttl(ttl), nextId(1), size(0), memory(0),
+                                                  lastSweep(chrono::steady_clock::now().time_since_epoch().count()) {
+}
+
+uint64_t SessionStore::Put(const scope_t &scope, size_t footprint) {
+    // start with session ID 1 (when passed to translate(), session ID 0 means 'no session')
+    uint64_t id = nextId.fetch_add(1);
+
+    entry_t entry;
+    entry.scope = scope;
+    entry.footprint = footprint;
+    entry.lastAccess = chrono::steady_clock::now();
+
+    {
+        shard_t &shard = ShardOf(id);
+        lock_guard<mutex> guard(shard.lock);
+        shard.sessions[id] = entry;
+    }
+
+    size++;
+    memory += footprint;
+
+    // sweep abandoned sessions at most four times per time-to-live period, one thread at a time
+    int64_t last = lastSweep.load();
+    int64_t now = entry.lastAccess.time_since_epoch().count();
+    if (now - last > (ttl / 4).count() && lastSweep.compare_exchange_strong(last, now))
+        ExpireSessions();
+
+    return id;
+}
+
+SessionStore::scope_t SessionStore::Get(uint64_t id) {
+    shard_t &shard = ShardOf(id);
+    lock_guard<mutex> guard(shard.lock);
+
+    auto entry = shard.sessions.find(id);
+    if (entry == shard.sessions.end())
+        return scope_t();
+
+    entry->second.lastAccess = chrono::steady_clock::now();
+    return entry->second.scope;
+}
+
+void SessionStore::Remove(uint64_t id) {
+    size_t footprint;
+
+    {
+        shard_t &shard = ShardOf(id);
+        lock_guard<mutex> guard(shard.lock);
+
+        auto entry = shard.sessions.find(id);
+        if (entry == shard.sessions.end())
+            return;
+
+        footprint = entry->second.footprint;
+        shard.sessions.erase(entry);
+    }
+
+    size--;
+    memory -= footprint;
+}
+
+size_t SessionStore::ExpireSessions() {
+    chrono::steady_clock::time_point deadline = chrono::steady_clock::now() - ttl;
+    size_t expired = 0;
+
+    for (size_t i = 0; i < kShardCount; ++i) {
+        shard_t &shard = shards[i];
+        lock_guard<mutex> guard(shard.lock);
+
+        for (auto entry = shard.sessions.begin(); entry != shard.sessions.end();) {
+            if (entry->second.lastAccess < deadline) {
+                size--;
+                memory -= entry->second.footprint;
+                expired++;
+
+                entry = shard.sessions.erase(entry);
+            } else {
+                ++entry;
+            }
+        }
+    }
+
+    return expired;
+}
@@ -0,0 +1,78 @@
+#ifndef JNIMOSES_SESSIONSTORE_H
+#define JNIMOSES_SESSIONSTORE_H
+
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <unordered_map>
+#include <boost/shared_ptr.hpp>
+
+namespace Moses {
+    class ContextScope;
+}
+
+namespace mmt {
+    namespace decoder {
+
+        /*
+         * Concurrent store for the ContextScope of translation sessions.
+         *
+         * Ids come from an atomic counter (never reused), sessions are spread across independently
+         * locked shards, and sessions idle for longer than the time-to-live are dropped during the
+         * periodic sweep triggered by new insertions. The time-to-live is the "session-timeout"
+         * decoder option.
+         */
+        class SessionStore {
+        public:
+            typedef boost::shared_ptr<Moses::ContextScope> scope_t;
+
+            SessionStore(std::chrono::seconds ttl = std::chrono::hours(24));
+
+            uint64_t Put(const scope_t &scope, size_t footprint);
+
+            scope_t Get(uint64_t id);
+
+            void Remove(uint64_t id);
+
+            size_t ExpireSessions();
+
+            size_t GetSize() const {
+                return size;
+            }
+
+            size_t GetMemoryUsage() const {
+                return memory;
+            }
+
+        private:
+            struct entry_t {
+                scope_t scope;
+                size_t footprint;
+                std::chrono::steady_clock::time_point lastAccess;
+            };
+
+            struct shard_t {
+                std::mutex lock;
+                std::unordered_map<uint64_t, entry_t> sessions;
+            };
+
+            static const size_t kShardCount = 16;
+
+            const std::chrono::steady_clock::duration ttl;
+            std::atomic<uint64_t> nextId;
+            std::atomic<size_t> size;
+            std::atomic<size_t> memory;
+            std::atomic<int64_t> lastSweep;
+
+            shard_t shards[kShardCount];
+
+            shard_t &ShardOf(uint64_t id) {
+                return shards[id % kShardCount];
+            }
+        };
+
+    }
+}
+
+#endif //JNIMOSES_SESSIONSTORE_H
@@ -22,6 +22,11 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include <string>
 #include <iostream>
+#include <new>
+#include <cstdlib>
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
 #include "SquareMatrix.h"
 #include "TypeDef.h"
 #include "Util.h"
@@ -30,11 +35,99 @@ using namespace std;
 
 namespace Moses
 {
+// rows and columns of the triangle start on a cache line
+static const size_t kFloatsPerLine = 64 / sizeof(float);
+
+static inline size_t PadToLine(size_t count)
+{
+  return (count + kFloatsPerLine - 1) / kFloatsPerLine * kFloatsPerLine;
+}
+
+static float *AllocateLines(size_t count)
+{
+  if (count == 0) return NULL;
+
+  void *ptr = NULL;
+  if (posix_memalign(&ptr, kFloatsPerLine * sizeof(float), count * sizeof(float)) != 0)
+    throw std::bad_alloc();
+  return (float*) ptr;
+}
+
+/** best sum left[i] + right[i], scores of two adjacent spans */
+static inline float MaxJoinedScore(const float *left, const float *right, size_t count)
+{
+  float best = -numeric_limits<float>::infinity();
+  size_t i = 0;
+
+#ifdef __SSE__
+  if (count >= 4) {
+    // left is a row, hence aligned
+    __m128 best4 = _mm_set1_ps(best);
+    for (; i + 4 <= count; i += 4)
+      best4 = _mm_max_ps(best4, _mm_add_ps(_mm_load_ps(left + i), _mm_loadu_ps(right + i)));
+
+    float lanes[4];
+    _mm_storeu_ps(lanes, best4);
+    best = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+  }
+#endif
+
+  for (; i < count; ++i) {
+    float joinedScore = left[i] + right[i];
+    if (joinedScore > best)
+      best = joinedScore;
+  }
+
+  return best;
+}
+
+SquareMatrix::SquareMatrix(size_t size)
+  :m_size(size)
+{
+  m_rowOffsets = new size_t[size + 1];
+  m_colOffsets = new size_t[size + 1];
+
+  m_rowOffsets[0] = m_colOffsets[0] = 0;
+  for (size_t pos = 0; pos < size; ++pos) {
+    m_rowOffsets[pos + 1] = m_rowOffsets[pos] + PadToLine(size - pos);
+    m_colOffsets[pos + 1] = m_colOffsets[pos] + PadToLine(pos + 1);
+  }
+
+  m_rows = AllocateLines(m_rowOffsets[size]);
+  m_cols = AllocateLines(m_colOffsets[size]);
+}
+
+SquareMatrix::~SquareMatrix()
+{
+  free(m_rows);
+  free(m_cols);
+  delete[] m_rowOffsets;
+  delete[] m_colOffsets;
+}
+
 void SquareMatrix::InitTriangle(float val)
 {
-  for(size_t row=0; row < m_size; row++) {
-    for(size_t col=row; col<m_size; col++) {
-      SetScore(row, col, -numeric_limits<float>::infinity());
+  // padding included, never read but kept initialized
+  std::fill(m_rows, m_rows + m_rowOffsets[m_size], val);
+  std::fill(m_cols, m_cols + m_colOffsets[m_size], val);
+}
+
+void SquareMatrix::CalcJoinedScores()
+{
+  // like in chart parsing, spans are visited by increasing width so that all the
+  // spans they can be split into have been filled already. For [sPos, ePos]:
+  //   row sPos holds [sPos, sPos], [sPos, sPos+1], ..., [sPos, ePos-1]
+  //   column ePos holds [sPos+1, ePos], [sPos+2, ePos], ..., [ePos, ePos]
+  // and the splits are their pairwise sums
+  for (size_t width = 1; width < m_size; ++width) {
+    for (size_t sPos = 0; sPos + width < m_size; ++sPos) {
+      size_t ePos = sPos + width;
+
+      float joinedScore = MaxJoinedScore(m_rows + m_rowOffsets[sPos],
+                                         m_cols + m_colOffsets[ePos] + sPos + 1,
+                                         width);
+      if (joinedScore > GetScore(sPos, ePos))
+        SetScore(sPos, ePos, joinedScore);
     }
   }
 }
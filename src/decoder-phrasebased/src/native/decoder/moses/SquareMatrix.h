@@ -30,40 +30,49 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 namespace Moses
 {
 
-//! A square array of floats to store future costs in the phrase-based decoder
+/** Future costs of all the spans of the input, for the phrase-based decoder.
+ *
+ * Only the upper triangle (startPos <= endPos) is stored. Cells are kept twice, once grouped by
+ * start position and once by end position, each group starting on a cache line: joining two
+ * adjacent spans in CalcJoinedScores() then reads two contiguous arrays, which is vectorized.
+ */
 class SquareMatrix
 {
   friend std::ostream& operator<<(std::ostream &out, const SquareMatrix &matrix);
 protected:
   const size_t m_size; /**< length of the square (sentence length) */
-  float *m_array; /**< two-dimensional array to store floats */
+  float *m_rows; /**< cells grouped by start position, m_rows[m_rowOffsets[startPos] + endPos - startPos] */
+  float *m_cols; /**< cells grouped by end position, m_cols[m_colOffsets[endPos] + startPos] */
+  size_t *m_rowOffsets;
+  size_t *m_colOffsets;
 
   SquareMatrix(); // not implemented
   SquareMatrix(const SquareMatrix &copy); // not implemented
+  SquareMatrix &operator=(const SquareMatrix &copy); // not implemented
 
 public:
-  SquareMatrix(size_t size)
-    :m_size(size) {
-    m_array = (float*) malloc(sizeof(float) * size * size);
-  }
-  ~SquareMatrix() {
-    free(m_array);
-  }
+  SquareMatrix(size_t size);
+  ~SquareMatrix();
 
   // set upper triangle
   void InitTriangle(float val);
 
+  /** Fill every span with the best between its own score and the sum of the scores
+   * of two adjacent spans covering it, shortest spans first */
+  void CalcJoinedScores();
+
   /** Returns length of the square: typically the sentence length */
   inline size_t GetSize() const {
     return m_size;
   }
   /** Get a future cost score for a span */
   inline float GetScore(size_t startPos, size_t endPos) const {
-    return m_array[startPos * m_size + endPos];
+    return m_rows[m_rowOffsets[startPos] + endPos - startPos];
   }
   /** Set a future cost score for a span */
   inline void SetScore(size_t startPos, size_t endPos, float value) {
-    m_array[startPos * m_size + endPos] = value;
+    m_rows[m_rowOffsets[startPos] + endPos - startPos] = value;
+    m_cols[m_colOffsets[endPos] + startPos] = value;
   }
   float CalcEstimatedScore( Bitmap const& ) const;
   float CalcEstimatedScore( Bitmap const&, size_t startPos, size_t endPos ) const;
@@ -74,7 +83,7 @@ public:
 inline std::ostream& operator<<(std::ostream &out, const SquareMatrix &matrix)
 {
   for (size_t endPos = 0 ; endPos < matrix.GetSize() ; endPos++) {
-    for (size_t startPos = 0 ; startPos < matrix.GetSize() ; startPos++)
+    for (size_t startPos = 0 ; startPos <= endPos ; startPos++)
       out << matrix.GetScore(startPos, endPos) << " ";
     out << std::endl;
   }
@@ -0,0 +1,140 @@
+#include <boost/test/unit_test.hpp>
+
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+#include "Bitmaps.h"
+#include "SquareMatrix.h"
+
+using namespace Moses;
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(square_matrix)
+
+// Reference implementation: a full size x size matrix filled with the scalar loops
+// SquareMatrix and Bitmaps replaced
+struct ScalarMatrix {
+  size_t size;
+  vector<float> scores;
+
+  ScalarMatrix(size_t size) : size(size), scores(size * size, 0.0f) {}
+
+  float &operator()(size_t startPos, size_t endPos) {
+    return scores[startPos * size + endPos];
+  }
+
+  void CalcJoinedScores() {
+    for (size_t colstart = 1; colstart < size; colstart++) {
+      for (size_t diagshift = 0; diagshift < size - colstart; diagshift++) {
+        size_t sPos = diagshift;
+        size_t ePos = colstart + diagshift;
+        for (size_t joinAt = sPos; joinAt < ePos; joinAt++) {
+          float joinedScore = (*this)(sPos, joinAt) + (*this)(joinAt + 1, ePos);
+          if (joinedScore > (*this)(sPos, ePos))
+            (*this)(sPos, ePos) = joinedScore;
+        }
+      }
+    }
+  }
+
+  float CalcEstimatedScore(const Bitmap &bitmap) {
+    float estimatedScore = 0.0f;
+    size_t pos = 0;
+    while (pos < bitmap.GetSize()) {
+      if (bitmap.GetValue(pos)) {
+        ++pos;
+        continue;
+      }
+
+      size_t startGap = pos;
+      while (pos < bitmap.GetSize() && !bitmap.GetValue(pos))
+        ++pos;
+      estimatedScore += (*this)(startGap, pos - 1);
+    }
+    return estimatedScore;
+  }
+};
+
+// phrase-table-like scores: mostly negative log probs, some spans without any option
+static void FillRandom(SquareMatrix &matrix, ScalarMatrix &reference)
+{
+  for (size_t sPos = 0; sPos < matrix.GetSize(); ++sPos) {
+    for (size_t ePos = sPos; ePos < matrix.GetSize(); ++ePos) {
+      float score = -numeric_limits<float>::infinity();
+      if (ePos == sPos || rand() % 3 != 0)
+        score = -(float) (rand() % 100000) / 1000.0f;
+      if (rand() % 10 == 0)
+        score = -numeric_limits<float>::infinity();
+
+      matrix.SetScore(sPos, ePos, score);
+      reference(sPos, ePos) = score;
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(joined_scores_match_scalar)
+{
+  srand(42);
+
+  // around the SSE width and the cache line padding
+  size_t sizes[] = {1, 2, 3, 4, 5, 7, 8, 15, 16, 17, 31, 33, 64, 80};
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+    for (int trial = 0; trial < 20; ++trial) {
+      SquareMatrix matrix(sizes[s]);
+      matrix.InitTriangle(-numeric_limits<float>::infinity());
+      ScalarMatrix reference(sizes[s]);
+      FillRandom(matrix, reference);
+
+      matrix.CalcJoinedScores();
+      reference.CalcJoinedScores();
+
+      for (size_t sPos = 0; sPos < sizes[s]; ++sPos) {
+        for (size_t ePos = sPos; ePos < sizes[s]; ++ePos) {
+          BOOST_CHECK_EQUAL(matrix.GetScore(sPos, ePos), reference(sPos, ePos));
+        }
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(interned_bitmaps_match_scalar)
+{
+  srand(7);
+
+  size_t sizes[] = {1, 5, 16, 17, 40};
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+    size_t size = sizes[s];
+    SquareMatrix matrix(size);
+    matrix.InitTriangle(-numeric_limits<float>::infinity());
+    ScalarMatrix reference(size);
+    FillRandom(matrix, reference);
+    matrix.CalcJoinedScores();
+    reference.CalcJoinedScores();
+
+    Bitmaps bitmaps(size, vector<bool>());
+    bitmaps.SetEstimatedScores(&matrix);
+
+    for (int trial = 0; trial < 50; ++trial) {
+      // cover the sentence with random phrases in random order
+      const Bitmap *bitmap = &bitmaps.GetInitialBitmap();
+      while (bitmap->GetNumWordsCovered() < size) {
+        size_t startPos = rand() % size;
+        while (bitmap->GetValue(startPos))
+          startPos = (startPos + 1) % size;
+
+        size_t endPos = startPos;
+        while (endPos + 1 < size && !bitmap->GetValue(endPos + 1) && rand() % 2)
+          ++endPos;
+
+        bitmap = &bitmaps.GetBitmap(*bitmap, Range(startPos, endPos));
+
+        float expected = reference.CalcEstimatedScore(*bitmap);
+        BOOST_CHECK_EQUAL(bitmap->GetEstimatedScore(), expected);
+        BOOST_CHECK_EQUAL(matrix.CalcEstimatedScore(*bitmap), expected);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
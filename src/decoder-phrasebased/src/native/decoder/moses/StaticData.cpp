@@ -73,6 +73,7 @@ StaticData::StaticData()
   , m_registry(new FeatureRegistry)
   , m_treeStructure(NULL)
 {
+  m_allWeightsSnapshot.reset(new ScoreComponentCollection);
   Phrase::InitializeMemPool();
 }
 
@@ -248,6 +249,11 @@ bool StaticData::LoadData(Parameter *parameter)
   //Load sparse features from config (overrules weight file)
   LoadSparseWeightsFromConfig();
 
+  {
+    boost::lock_guard<boost::mutex> lock(m_allWeightsMutex);
+    PublishWeights();
+  }
+
   return true;
 }
 
@@ -256,6 +262,7 @@ void StaticData::SetWeight(const FeatureFunction* sp, float weight)
   boost::lock_guard<boost::mutex> lock(m_allWeightsMutex);
   m_allWeights.Resize();
   m_allWeights.Assign(sp,weight);
+  PublishWeights();
 }
 
 void StaticData::SetWeights(const FeatureFunction* sp,
@@ -264,6 +271,14 @@ void StaticData::SetWeights(const FeatureFunction* sp,
   boost::lock_guard<boost::mutex> lock(m_allWeightsMutex);
   m_allWeights.Resize();
   m_allWeights.Assign(sp,weights);
+  PublishWeights();
+}
+
+void StaticData::PublishWeights()
+{
+  // caller must hold m_allWeightsMutex
+  boost::shared_ptr<ScoreComponentCollection const> snapshot(new ScoreComponentCollection(m_allWeights));
+  boost::atomic_store(&m_allWeightsSnapshot, snapshot);
 }
 
 void StaticData::LoadNonTerminals()
@@ -79,8 +79,13 @@ protected:
   Parameter *m_parameter;
   boost::shared_ptr<AllOptions> m_options;
 
+  // m_allWeights is the writers' master copy (guarded by m_allWeightsMutex); readers only ever
+  // see immutable snapshots of it, republished atomically after every change (RCU style)
   ScoreComponentCollection m_allWeights;
   mutable boost::mutex m_allWeightsMutex;
+  boost::shared_ptr<ScoreComponentCollection const> m_allWeightsSnapshot;
+
+  void PublishWeights();
 
   std::vector<DecodeGraph*> m_decodeGraphs;
 
@@ -208,16 +213,25 @@ public:
   }
 
   /**
-   * Get feature weights.
+   * Get the current feature weights snapshot, without copying it.
    *
-   * This is slow / locking on purpose.
+   * The snapshot is immutable: later weight changes publish a new snapshot and leave this one untouched.
+   * While decoding, you should call ContextScope::GetFeatureWeights() instead!
+   */
+  boost::shared_ptr<ScoreComponentCollection const>
+  GetAllWeightsSnapshot() const {
+    return boost::atomic_load(&m_allWeightsSnapshot);
+  }
+
+  /**
+   * Get a copy of the feature weights.
+   *
+   * This is slow on purpose.
    * You should call ContextScope::GetFeatureWeights() instead!
    */
   ScoreComponentCollection
   GetAllWeightsNew() const { // temporarily called GetAllWeightsNew() so we are aware of all call sites used in MMT.
-    boost::lock_guard<boost::mutex> lock(m_allWeightsMutex);
-    ScoreComponentCollection copy = m_allWeights;
-    return copy;
+    return *GetAllWeightsSnapshot();
   }
 
   ScoreComponentCollection GetAllWeights() const {
@@ -230,17 +244,18 @@ public:
    */
   void SetAllWeights(const ScoreComponentCollection& weights) {
     /*
-     * Before decoding each sentence, ContextScope() retrieves the current feature weights from StaticData.
-     * Therefore, we can safely lock and change the weights here, which affects all subsequent sentences.
+     * Before decoding each sentence, ContextScope() pins the current weights snapshot from StaticData.
+     * Therefore, we can safely publish new weights here, which affects all subsequent sentences
+     * while the ones in flight keep decoding with the snapshot they started with.
      */
     boost::lock_guard<boost::mutex> lock(m_allWeightsMutex);
     m_allWeights = weights;
+    PublishWeights();
   }
 
   //! DEPRECATED. Use ContextScope::GetFeatureWeights(). Weight for a single-valued feature
   float GetWeight(const FeatureFunction* sp) const {
-    boost::lock_guard<boost::mutex> lock(m_allWeightsMutex);
-    return m_allWeights.GetScoreForProducer(sp);
+    return GetAllWeightsSnapshot()->GetScoreForProducer(sp);
   }
 
   //Weight for a single-valued feature
@@ -249,8 +264,7 @@ public:
 
   //! DEPRECATED. Use ContextScope::GetFeatureWeights(). Weights for feature with fixed number of values
   std::vector<float> GetWeights(const FeatureFunction* sp) const {
-    boost::lock_guard<boost::mutex> lock(m_allWeightsMutex);
-    return m_allWeights.GetScoresForProducer(sp);
+    return GetAllWeightsSnapshot()->GetScoresForProducer(sp);
   }
 
   //Weights for feature with fixed number of values
@@ -45,6 +45,7 @@ TargetPhrase::TargetPhrase(const ttasksptr& ttask, std::string out_string, const
   :Phrase(0)
   , m_futureScore(0.0)
   , m_estimatedScore(0.0)
+  , m_weightedScore(0.0)
   , m_alignTerm(&AlignmentInfoCollection::Instance().GetEmptyAlignmentInfo())
   , m_alignNonTerm(&AlignmentInfoCollection::Instance().GetEmptyAlignmentInfo())
   , m_lhsTarget(NULL)
@@ -63,6 +64,7 @@ TargetPhrase::TargetPhrase(const ttasksptr& ttask, const PhraseDictionary *pt)
   : Phrase()
   , m_futureScore(0.0)
   , m_estimatedScore(0.0)
+  , m_weightedScore(0.0)
   , m_alignTerm(&AlignmentInfoCollection::Instance().GetEmptyAlignmentInfo())
   , m_alignNonTerm(&AlignmentInfoCollection::Instance().GetEmptyAlignmentInfo())
   , m_lhsTarget(NULL)
@@ -77,6 +79,7 @@ TargetPhrase::TargetPhrase(const ttasksptr& ttask, const Phrase &phrase, const P
   : Phrase(phrase)
   , m_futureScore(0.0)
   , m_estimatedScore(0.0)
+  , m_weightedScore(0.0)
   , m_alignTerm(&AlignmentInfoCollection::Instance().GetEmptyAlignmentInfo())
   , m_alignNonTerm(&AlignmentInfoCollection::Instance().GetEmptyAlignmentInfo())
   , m_lhsTarget(NULL)
@@ -93,6 +96,7 @@ TargetPhrase::TargetPhrase(const TargetPhrase &copy)
   , m_scope(copy.m_scope)
   , m_futureScore(copy.m_futureScore)
   , m_estimatedScore(copy.m_estimatedScore)
+  , m_weightedScore(copy.m_weightedScore)
   , m_scoreBreakdown(copy.m_scoreBreakdown)
   , m_alignTerm(copy.m_alignTerm)
   , m_alignNonTerm(copy.m_alignNonTerm)
@@ -164,9 +168,9 @@ void TargetPhrase::EvaluateInIsolation(const Phrase &source, const std::vector<F
       }
     }
 
-    float weightedScore = m_scoreBreakdown.GetWeightedScore(weights);
+    m_weightedScore = m_scoreBreakdown.GetWeightedScore(weights);
     m_estimatedScore += estimatedScores.GetWeightedScore(weights);
-    m_futureScore = weightedScore + m_estimatedScore;
+    m_futureScore = m_weightedScore + m_estimatedScore;
   }
 }
 
@@ -185,9 +189,9 @@ void TargetPhrase::EvaluateWithSourceContext(const InputType &input, const Input
       ff.EvaluateWithSourceContext(input, inputPath, *this, NULL, m_scoreBreakdown, &futureScoreBreakdown);
     }
   }
-  float weightedScore = m_scoreBreakdown.GetWeightedScore(weights);
+  m_weightedScore = m_scoreBreakdown.GetWeightedScore(weights);
   m_estimatedScore += futureScoreBreakdown.GetWeightedScore(weights);
-  m_futureScore = weightedScore + m_estimatedScore;
+  m_futureScore = m_weightedScore + m_estimatedScore;
 }
 
 void TargetPhrase::UpdateScore(ScoreComponentCollection* futureScoreBreakdown)
@@ -196,10 +200,10 @@ void TargetPhrase::UpdateScore(ScoreComponentCollection* futureScoreBreakdown)
   UTIL_THROW_IF2(scope.get() == NULL, "TargetPhrase::EvaluateWithSourceContext() must now have a ContextScope for feature weights.");
   const ScoreComponentCollection &weights = scope->GetFeatureWeights();
 
-  float weightedScore = m_scoreBreakdown.GetWeightedScore(weights);
+  m_weightedScore = m_scoreBreakdown.GetWeightedScore(weights);
   if(futureScoreBreakdown)
     m_estimatedScore += futureScoreBreakdown->GetWeightedScore(weights);
-  m_futureScore = weightedScore + m_estimatedScore;
+  m_futureScore = m_weightedScore + m_estimatedScore;
 }
 
 void TargetPhrase::SetXMLScore(float score)
@@ -279,6 +283,7 @@ Merge(const TargetPhrase &copy, const std::vector<FactorType>& factorVec)
   Phrase::MergeFactors(copy, factorVec);
   m_scoreBreakdown.Merge(copy.GetScoreBreakdown());
   m_estimatedScore += copy.m_estimatedScore;
+  m_weightedScore += copy.m_weightedScore;
   m_futureScore += copy.m_futureScore;
   typedef ScoreCache_t::iterator iter;
   typedef ScoreCache_t::value_type item;
@@ -335,6 +340,7 @@ void swap(TargetPhrase &first, TargetPhrase &second)
   first.SwapWords(second);
   std::swap(first.m_futureScore, second.m_futureScore);
   std::swap(first.m_estimatedScore, second.m_estimatedScore);
+  std::swap(first.m_weightedScore, second.m_weightedScore);
   swap(first.m_scoreBreakdown, second.m_scoreBreakdown);
   std::swap(first.m_alignTerm, second.m_alignTerm);
   std::swap(first.m_alignNonTerm, second.m_alignNonTerm);
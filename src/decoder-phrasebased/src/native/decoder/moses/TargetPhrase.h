@@ -65,6 +65,7 @@ private:
   friend void swap(TargetPhrase &first, TargetPhrase &second);
 
   float m_futureScore, m_estimatedScore;
+  float m_weightedScore; /*< m_scoreBreakdown weighted with the scope feature weights, kept in sync with m_futureScore */
   ScoreComponentCollection m_scoreBreakdown;
 
   const AlignmentInfo* m_alignTerm, *m_alignNonTerm;
@@ -122,6 +123,14 @@ public:
     return m_futureScore;
   }
 
+  /***
+   * return the weighted sum of the scores in the breakdown, as of the last evaluation
+   * (the future score without the estimates)
+   */
+  inline float GetWeightedScore() const {
+    return m_weightedScore;
+  }
+
   inline const ScoreComponentCollection &GetScoreBreakdown() const {
     return m_scoreBreakdown;
   }
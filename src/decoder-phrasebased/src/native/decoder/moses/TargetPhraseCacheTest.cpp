@@ -0,0 +1,131 @@
+#include <boost/test/unit_test.hpp>
+
+#include "FF/StatelessFeatureFunction.h"
+#include "TranslationModel/TargetPhraseCache.h"
+#include "TranslationTask.h"
+#include "ContextScope.h"
+
+using namespace Moses;
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(target_phrase_cache)
+
+class MockTranslationModel : public StatelessFeatureFunction
+{
+public:
+  MockTranslationModel() : StatelessFeatureFunction(1, "MockTranslationModel") {}
+
+  bool IsUseable(const FactorMask &mask) const {
+    return true;
+  }
+
+  void EvaluateInIsolation(const Phrase &source, const TargetPhrase &targetPhrase
+                           , ScoreComponentCollection &scoreBreakdown
+                           , ScoreComponentCollection &estimatedScores) const {}
+  void EvaluateWithSourceContext(const InputType &input, const InputPath &inputPath
+                                 , const TargetPhrase &targetPhrase, const StackVec *stackVec
+                                 , ScoreComponentCollection &scoreBreakdown
+                                 , ScoreComponentCollection *estimatedScores) const {}
+  void EvaluateTranslationOptionListWithSourceContext(const InputType &input
+      , const TranslationOptionList &translationOptionList) const {}
+  void EvaluateWhenApplied(const Hypothesis &hypo, ScoreComponentCollection *accumulator) const {}
+  void EvaluateWhenApplied(const ChartHypothesis &hypo, ScoreComponentCollection *accumulator) const {}
+};
+
+struct MockLookup {
+  MockLookup() {
+    FeatureFunction::Register(&model);
+  }
+
+  SPTR<ScoreComponentCollection const> MakeWeights(float weight) {
+    ScoreComponentCollection *weights = new ScoreComponentCollection();
+    weights->Assign(&model, weight);
+    return SPTR<ScoreComponentCollection const>(weights);
+  }
+
+  // stands for the phrase table: the score depends on the phrase, the context and the weights
+  TargetPhraseCollection::shared_ptr Lookup(const vector<mmt::wid_t> &phrase, const mmt::context_t &context,
+      const SPTR<ScoreComponentCollection const> &weights) {
+    SPTR<ContextScope> scope(new ContextScope(weights));
+    ttasksptr ttask = TranslationTask::create(SPTR<InputType>(), SPTR<IOWrapper>(), scope);
+
+    float score = weights->GetScoreForProducer(&model) * phrase.size();
+    for (size_t i = 0; i < context.size(); ++i)
+      score += context[i].domain * context[i].score;
+
+    TargetPhrase *tp = new TargetPhrase(ttask);
+    tp->GetScoreBreakdown().Assign(&model, score);
+
+    TargetPhraseCollection *tpc = new TargetPhraseCollection();
+    tpc->Add(tp);
+    return TargetPhraseCollection::shared_ptr(tpc);
+  }
+
+  float GetScore(const TargetPhraseCollection::shared_ptr &collection) {
+    return (*collection->begin())->GetScoreBreakdown().GetScoreForProducer(&model);
+  }
+
+  MockTranslationModel model;
+};
+
+BOOST_FIXTURE_TEST_CASE(hit_matches_uncached_lookup, MockLookup)
+{
+  TargetPhraseCache cache(1 << 20);
+  vector<mmt::wid_t> phrase = {4, 8, 15};
+  mmt::context_t context = {mmt::cscore_t(1, 0.25f), mmt::cscore_t(2, 0.75f)};
+  SPTR<ScoreComponentCollection const> weights = MakeWeights(0.5f);
+
+  TargetPhraseCollection::shared_ptr collection;
+  BOOST_CHECK(!cache.Get(phrase, TargetPhraseCache::MakeSignature(&context, weights), &collection));
+
+  cache.Put(phrase, TargetPhraseCache::MakeSignature(&context, weights), Lookup(phrase, context, weights), 0);
+
+  // equal contexts in different vectors must hit
+  mmt::context_t copy = context;
+  BOOST_REQUIRE(cache.Get(phrase, TargetPhraseCache::MakeSignature(&copy, weights), &collection));
+  BOOST_CHECK_EQUAL(GetScore(collection), GetScore(Lookup(phrase, context, weights)));
+  BOOST_CHECK_EQUAL(cache.GetHitCount(), 1U);
+}
+
+BOOST_FIXTURE_TEST_CASE(changed_context_or_weights_miss, MockLookup)
+{
+  TargetPhraseCache cache(1 << 20);
+  vector<mmt::wid_t> phrase = {16, 23};
+  mmt::context_t context = {mmt::cscore_t(1, 0.25f), mmt::cscore_t(2, 0.75f)};
+  SPTR<ScoreComponentCollection const> weights = MakeWeights(0.5f);
+
+  cache.Put(phrase, TargetPhraseCache::MakeSignature(&context, weights), Lookup(phrase, context, weights), 0);
+
+  TargetPhraseCollection::shared_ptr collection;
+
+  mmt::context_t other = {mmt::cscore_t(1, 0.75f), mmt::cscore_t(2, 0.25f)};
+  BOOST_CHECK(!cache.Get(phrase, TargetPhraseCache::MakeSignature(&other, weights), &collection));
+  BOOST_CHECK(!cache.Get(phrase, TargetPhraseCache::MakeSignature(NULL, weights), &collection));
+
+  // same values, different scope
+  BOOST_CHECK(!cache.Get(phrase, TargetPhraseCache::MakeSignature(&context, MakeWeights(0.5f)), &collection));
+  BOOST_CHECK(!cache.Get(phrase, TargetPhraseCache::MakeSignature(&context, MakeWeights(2.f)), &collection));
+
+  BOOST_CHECK_EQUAL(cache.GetHitCount(), 0U);
+}
+
+BOOST_FIXTURE_TEST_CASE(hash_collision_misses, MockLookup)
+{
+  TargetPhraseCache cache(1 << 20);
+  vector<mmt::wid_t> phrase = {42};
+  mmt::context_t context = {mmt::cscore_t(1, 1.f)};
+  SPTR<ScoreComponentCollection const> weights = MakeWeights(1.f);
+
+  TargetPhraseCache::signature_t signature = TargetPhraseCache::MakeSignature(&context, weights);
+  cache.Put(phrase, signature, Lookup(phrase, context, weights), 0);
+
+  mmt::context_t other = {mmt::cscore_t(3, 1.f)};
+  TargetPhraseCache::signature_t forged = TargetPhraseCache::MakeSignature(&other, weights);
+  forged.hash = signature.hash;
+
+  TargetPhraseCollection::shared_ptr collection;
+  BOOST_CHECK(!cache.Get(phrase, forged, &collection));
+  BOOST_CHECK(cache.Get(phrase, signature, &collection));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -3,13 +3,13 @@
 #include "StaticData.h"
 #include "TranslationTask.h"
 
-#define ParseWord(w) (boost::lexical_cast<wid_t>((w)))
-
 using namespace std;
 using namespace Moses;
 using namespace mmt::sapt;
 
 namespace Moses {
+    static const size_t kDefaultCacheMemory = 64 * 1024 * 1024;
+
 
 //used the constant of mmt::sapt to get entries of the vector cnt,
 //used the cnstant of LRModel   for the probabilities
@@ -68,7 +68,9 @@ namespace Moses {
 
     PhraseDictionarySADB::PhraseDictionarySADB(const std::string &line)
             : PhraseDictionary(line),
-              m_lr_func(NULL) {
+              m_lr_func(NULL),
+              m_cacheMemory(kDefaultCacheMemory),
+              m_cache(NULL) {
         m_numScoreComponents = 4;
         m_numTuneableComponents = m_numScoreComponents;
         ReadParameters();
@@ -106,13 +108,28 @@ namespace Moses {
         m_options = opts;
         SetFeaturesToApply();
         m_pt = new mmt::sapt::PhraseTable(m_modelPath, pt_options, StaticData::Instance().GetAligner());
+
+        if (m_cacheMemory > 0)
+            m_cache = new TargetPhraseCache(m_cacheMemory);
     }
 
 
     PhraseDictionarySADB::~PhraseDictionarySADB() {
+        delete m_cache;
         delete m_pt;
     }
 
+    uint64_t PhraseDictionarySADB::GetModelWatermark() const {
+        // sequence ids only grow: their sum changes whenever an update reaches the index
+        uint64_t watermark = 0;
+
+        unordered_map<stream_t, seqid_t> streams = m_pt->GetLatestUpdatesIdentifier();
+        for (auto stream = streams.begin(); stream != streams.end(); ++stream)
+            watermark += (uint64_t) stream->second;
+
+        return watermark;
+    }
+
 
     void PhraseDictionarySADB::InitializeForInput(ttasksptr const &ttask) {
         //todo: do we need this cache?
@@ -129,16 +146,17 @@ namespace Moses {
 
         // DO NOT modify members of 'this' here. We are being called from different
         // threads, and there is no locking here.
-        SPTR<weightmap_t const> weights = ttask->GetScope()->GetContextWeights();
-
-        if (weights) {
-            context_t *context_vec = new context_t;
-
-            for (weightmap_t::const_iterator it = weights->begin(); it != weights->end(); ++it) {
-                context_vec->push_back(cscore_t(ParseWord(it->first), it->second));
+        SPTR<context_t const> context = ttask->GetScope()->GetContext();
+        ContextScope::AssignThreadContext(t_context_vec, context.get());
+
+        if (m_cache) {
+            uint64_t *watermark = t_cache_watermark.get();
+            if (watermark == NULL) {
+                watermark = new uint64_t;
+                t_cache_watermark.reset(watermark);
             }
 
-            t_context_vec.reset(context_vec);
+            *watermark = m_cache->Validate(GetModelWatermark());
         }
 
         if (m_lr_func_name.size() && m_lr_func == NULL) {
@@ -154,7 +172,7 @@ namespace Moses {
         vector<wid_t> result(phrase.GetSize());
 
         for (size_t i = 0; i < phrase.GetSize(); i++) {
-            result[i] = ParseWord(phrase.GetWord(i).GetString(m_input, false));
+            result[i] = phrase.GetFactor(i, m_input[0])->GetWid();
         }
 
         return result;
@@ -165,26 +183,82 @@ namespace Moses {
         Phrase sourceSentence(ttask->GetSource()->GetSubString(Range(0, ttask->GetSource()->GetSize() - 1)));
 
         context_t *context = t_context_vec.get();
+        SPTR<ContextScope> const &scope = ttask->GetScope();
+        SPTR<ScoreComponentCollection const> weights = scope->GetFeatureWeightsPtr();
+        TargetPhraseCache::signature_t signature = TargetPhraseCache::MakeSignature(context, weights);
+
+        // cached phrases are copied and bound to this scope, the others need the phrase table
+        vector<pair<InputPath *, vector<wid_t>>> misses;
 
-        vector<wid_t> sentence = ParsePhrase(sourceSentence);
-        translation_table_t ttable = m_pt->GetAllTranslationOptions(sentence, context);
         for (auto inputPath = inputPathQueue.begin(); inputPath != inputPathQueue.end(); ++inputPath) {
             vector<wid_t> phrase = ParsePhrase((*inputPath)->GetPhrase());
 
-            auto options = ttable.find(phrase);
-            if (options != ttable.end()) {
-                TargetPhraseCollection::shared_ptr targetPhrases = MakeTargetPhraseCollection(ttask,
-                                                                                              (*inputPath)->GetPhrase(),
-                                                                                              options->second);
-                (*inputPath)->SetTargetPhrases(*this, targetPhrases, NULL);
+            TargetPhraseCollection::shared_ptr cached;
+            if (m_cache && m_cache->Get(phrase, signature, &cached)) {
+                if (cached)
+                    (*inputPath)->SetTargetPhrases(*this, CopyTargetPhraseCollection(*cached, scope), NULL);
+            } else {
+                misses.push_back(make_pair(*inputPath, phrase));
             }
         }
+
+        VERBOSE(2, GetScoreProducerDescription() << " target phrase cache: "
+                << (inputPathQueue.size() - misses.size()) << "/" << inputPathQueue.size() << " hits, "
+                << (m_cache ? m_cache->GetHitCount() : 0) << " hits and "
+                << (m_cache ? m_cache->GetMissCount() : 0) << " misses in total" << std::endl);
+
+        if (misses.empty())
+            return;
+
+        // on a cold sentence the whole-sentence lookup shares the suffix array walks between phrases
+        bool cold = misses.size() == inputPathQueue.size();
+        translation_table_t ttable;
+        if (cold)
+            ttable = m_pt->GetAllTranslationOptions(ParsePhrase(sourceSentence), context);
+
+        for (auto miss = misses.begin(); miss != misses.end(); ++miss) {
+            InputPath *inputPath = miss->first;
+            TargetPhraseCollection::shared_ptr targetPhrases;
+
+            vector<mmt::sapt::TranslationOption> options;
+            if (cold) {
+                auto entry = ttable.find(miss->second);
+                if (entry != ttable.end())
+                    options.swap(entry->second);
+            } else {
+                options = m_pt->GetTranslationOptions(miss->second, context);
+            }
+
+            if (!options.empty()) {
+                targetPhrases = MakeTargetPhraseCollection(ttask, inputPath->GetPhrase(), options);
+                inputPath->SetTargetPhrases(*this, targetPhrases, NULL);
+            }
+
+            if (m_cache)
+                m_cache->Put(miss->second, signature, targetPhrases, *t_cache_watermark);
+        }
+    }
+
+    TargetPhraseCollection::shared_ptr
+    PhraseDictionarySADB::CopyTargetPhraseCollection(const TargetPhraseCollection &collection,
+                                                     const SPTR<ContextScope> &scope) const {
+        TargetPhraseCollection *tpc = new TargetPhraseCollection();
+
+        for (auto tp = collection.begin(); tp != collection.end(); ++tp) {
+            // scores do not change, only the scope the feature weights are read from
+            TargetPhrase *copy = new TargetPhrase(**tp);
+            copy->SetScope(scope);
+            tpc->Add(copy);
+        }
+
+        return TargetPhraseCollection::shared_ptr(tpc);
     }
 
     TargetPhraseCollection::shared_ptr
     PhraseDictionarySADB::MakeTargetPhraseCollection(ttasksptr const &ttask, Phrase const &sourcePhrase,
                                                      const vector<mmt::sapt::TranslationOption> &options) const {
         TargetPhraseCollection *tpc = new TargetPhraseCollection();
+        FactorCollection &factorCollection = FactorCollection::Instance();
 
         auto target_options_it = options.begin();
 
@@ -197,7 +271,7 @@ namespace Moses {
             for (auto word_it = target_options_it->targetPhrase.begin();
                  word_it != target_options_it->targetPhrase.end(); ++word_it) {
                 Word w;
-                w.CreateFromString(Output, m_output, to_string(*word_it), false);
+                w.SetFactor(m_output[0], factorCollection.AddFactor(*word_it));
                 tp->AddWord(w);
             }
             std::set<std::pair<size_t, size_t> > aln;
@@ -243,6 +317,9 @@ namespace Moses {
         } else if (key == "sample-limit") {
             pt_options.samples = Scan<int>(value);
             VERBOSE(3, "pt_options.sample:" << pt_options.samples << std::endl);
+        } else if (key == "cache-memory") {
+            m_cacheMemory = Scan<size_t>(value) * 1024 * 1024;
+            VERBOSE(3, "m_cacheMemory:" << m_cacheMemory << std::endl);
         } else if (key == "lr-func") {
             m_lr_func_name = Scan<std::string>(value);
             VERBOSE(3, "m_lr_func_name:" << m_lr_func_name << std::endl);
@@ -7,6 +7,7 @@
 #pragma once
 
 #include "PhraseDictionary.h"
+#include "TargetPhraseCache.h"
 #include "sapt/PhraseTable.h"
 #include <mmt/sentence.h>
 #include <mmt/IncrementalModel.h>
@@ -59,11 +60,16 @@ namespace Moses {
             return m_pt;
         }
 
+        const TargetPhraseCache *GetTargetPhraseCache() const {
+            return m_cache;
+        }
+
     protected:
 
 #ifdef WITH_THREADS
         boost::thread_specific_ptr<ttasksptr> m_ttask;
         boost::thread_specific_ptr<context_t> t_context_vec;
+        boost::thread_specific_ptr<uint64_t> t_cache_watermark;
 #else
         boost::scoped_ptr<context_t> *t_context_vec;
 #endif
@@ -77,6 +83,14 @@ namespace Moses {
         LexicalReordering* m_lr_func; // associated lexical reordering function
         std::string m_lr_func_name; // name of associated lexical reordering function
 
+        size_t m_cacheMemory; // in bytes, 0 to disable the cache
+        TargetPhraseCache *m_cache;
+
+        uint64_t GetModelWatermark() const;
+
+        TargetPhraseCollection::shared_ptr
+        CopyTargetPhraseCollection(const TargetPhraseCollection &collection, const SPTR<ContextScope> &scope) const;
+
         inline vector<wid_t> ParsePhrase(const Phrase &phrase) const;
 
         TargetPhraseCollection::shared_ptr
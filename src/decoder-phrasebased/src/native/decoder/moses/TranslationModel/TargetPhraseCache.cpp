@@ -0,0 +1,144 @@
+#include "TargetPhraseCache.h"
+#include "util/murmur_hash.hh"
+
+using namespace std;
+
+namespace Moses {
+
+    // Rough estimate of the per-phrase overhead: score vectors, alignment info and allocator slack
+    static const size_t kTargetPhraseOverhead = 256;
+
+    size_t TargetPhraseCache::key_hash::operator()(const key_t &key) const {
+        return (size_t) util::MurmurHashNative(key.phrase.data(), key.phrase.size() * sizeof(mmt::wid_t),
+                                               key.signature.hash);
+    }
+
+    bool TargetPhraseCache::signature_t::operator==(const signature_t &other) const {
+        if (hash != other.hash || weights != other.weights)
+            return false;
+        if (context == other.context)
+            return true;
+        if (!context || !other.context || context->size() != other.context->size())
+            return false;
+
+        for (size_t i = 0; i < context->size(); ++i) {
+            const mmt::cscore_t &a = (*context)[i];
+            const mmt::cscore_t &b = (*other.context)[i];
+
+            if (a.domain != b.domain || a.score != b.score)
+                return false;
+        }
+
+        return true;
+    }
+
+    TargetPhraseCache::TargetPhraseCache(size_t maxMemory)
+            : m_maxShardMemory(maxMemory / kShardCount), m_watermark(0), m_hits(0), m_misses(0), m_memory(0) {
+    }
+
+    TargetPhraseCache::signature_t TargetPhraseCache::MakeSignature(const mmt::context_t *context,
+                                                                    const SPTR<ScoreComponentCollection const> &weights) {
+        signature_t signature;
+        signature.weights = weights;
+
+        uint64_t seed = (uint64_t) weights.get();
+        if (context == NULL || context->empty()) {
+            signature.hash = util::MurmurHashNative(&seed, sizeof(seed));
+        } else {
+            signature.context.reset(new mmt::context_t(*context));
+            signature.hash = util::MurmurHashNative(context->data(), context->size() * sizeof(mmt::cscore_t), seed);
+        }
+
+        return signature;
+    }
+
+    bool TargetPhraseCache::Get(const vector<mmt::wid_t> &phrase, const signature_t &signature,
+                                TargetPhraseCollection::shared_ptr *outCollection) {
+        key_t key;
+        key.phrase = phrase;
+        key.signature = signature;
+
+        shard_t &shard = m_shards[key_hash()(key) % kShardCount];
+        boost::mutex::scoped_lock lock(shard.lock);
+
+        auto entry = shard.entries.find(key);
+        if (entry == shard.entries.end()) {
+            m_misses++;
+            return false;
+        }
+
+        shard.lru.splice(shard.lru.begin(), shard.lru, entry->second);
+        *outCollection = entry->second->collection;
+        m_hits++;
+
+        return true;
+    }
+
+    void TargetPhraseCache::Put(const vector<mmt::wid_t> &phrase, const signature_t &signature,
+                                const TargetPhraseCollection::shared_ptr &collection, uint64_t watermark) {
+        entry_t entry;
+        entry.key.phrase = phrase;
+        entry.key.signature = signature;
+        entry.collection = collection;
+        entry.footprint = EstimateFootprint(entry.key, collection);
+
+        if (entry.footprint > m_maxShardMemory)
+            return;
+
+        shard_t &shard = m_shards[key_hash()(entry.key) % kShardCount];
+        boost::mutex::scoped_lock lock(shard.lock);
+
+        // computed on a model that has been updated since: useless
+        if (watermark != m_watermark)
+            return;
+
+        if (shard.entries.find(entry.key) != shard.entries.end())
+            return;
+
+        shard.lru.push_front(entry);
+        shard.entries[entry.key] = shard.lru.begin();
+        shard.memory += entry.footprint;
+        m_memory += entry.footprint;
+
+        while (shard.memory > m_maxShardMemory) {
+            entry_t &victim = shard.lru.back();
+            shard.memory -= victim.footprint;
+            m_memory -= victim.footprint;
+            shard.entries.erase(victim.key);
+            shard.lru.pop_back();
+        }
+    }
+
+    uint64_t TargetPhraseCache::Validate(uint64_t watermark) {
+        uint64_t current = m_watermark;
+        if (current == watermark || !m_watermark.compare_exchange_strong(current, watermark))
+            return m_watermark;
+
+        for (size_t i = 0; i < kShardCount; ++i) {
+            shard_t &shard = m_shards[i];
+            boost::mutex::scoped_lock lock(shard.lock);
+
+            m_memory -= shard.memory;
+            shard.memory = 0;
+            shard.entries.clear();
+            shard.lru.clear();
+        }
+
+        return watermark;
+    }
+
+    size_t TargetPhraseCache::EstimateFootprint(const key_t &key,
+                                                const TargetPhraseCollection::shared_ptr &collection) {
+        // list node, hash node and key
+        size_t footprint = sizeof(entry_t) + 4 * sizeof(void *) + key.phrase.size() * sizeof(mmt::wid_t);
+
+        if (collection) {
+            footprint += sizeof(TargetPhraseCollection);
+            for (auto tp = collection->begin(); tp != collection->end(); ++tp)
+                footprint += sizeof(TargetPhrase) + (*tp)->GetSize() * sizeof(Word) + kTargetPhraseOverhead;
+        }
+
+        return footprint;
+    }
+
+}
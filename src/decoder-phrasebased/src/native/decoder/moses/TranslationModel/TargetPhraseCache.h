@@ -0,0 +1,112 @@
+#ifndef MOSES_TARGETPHRASECACHE_H
+#define MOSES_TARGETPHRASECACHE_H
+
+#include <list>
+#include <vector>
+#include <boost/atomic.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/unordered_map.hpp>
+#include <mmt/sentence.h>
+
+#include "TargetPhraseCollection.h"
+#include "ScoreComponentCollection.h"
+#include "Util.h"
+
+namespace Moses {
+
+    /*
+     * Concurrent LRU cache of the scored TargetPhraseCollections built by PhraseDictionarySADB.
+     *
+     * Entries are keyed by source phrase and by a signature of everything their scores depend on
+     * (translation context and feature weights). The signature keeps a copy of the context and a
+     * reference to the weights, so that a hash collision can never return another scope's scores.
+     * Entries are spread across independently locked
+     * shards, each one evicting its least recently used entries when over its share of the memory
+     * budget. Phrases without translations are cached too, as NULL collections.
+     *
+     * The cache is tied to a model watermark: when the model changes, everything is dropped, and
+     * entries computed before the change are refused.
+     */
+    class TargetPhraseCache {
+    public:
+        struct signature_t {
+            uint64_t hash;
+            SPTR<mmt::context_t const> context; // NULL if there is no context
+            SPTR<ScoreComponentCollection const> weights; // also keeps the address from being reused
+
+            bool operator==(const signature_t &other) const;
+        };
+
+        TargetPhraseCache(size_t maxMemory);
+
+        static signature_t MakeSignature(const mmt::context_t *context,
+                                         const SPTR<ScoreComponentCollection const> &weights);
+
+        bool Get(const std::vector<mmt::wid_t> &phrase, const signature_t &signature,
+                 TargetPhraseCollection::shared_ptr *outCollection);
+
+        void Put(const std::vector<mmt::wid_t> &phrase, const signature_t &signature,
+                 const TargetPhraseCollection::shared_ptr &collection, uint64_t watermark);
+
+        //! drop all the entries if the model watermark changed, returns the current one
+        uint64_t Validate(uint64_t watermark);
+
+        size_t GetHitCount() const {
+            return m_hits;
+        }
+
+        size_t GetMissCount() const {
+            return m_misses;
+        }
+
+        size_t GetMemoryUsage() const {
+            return m_memory;
+        }
+
+    private:
+        struct key_t {
+            std::vector<mmt::wid_t> phrase;
+            signature_t signature;
+
+            bool operator==(const key_t &other) const {
+                return signature == other.signature && phrase == other.phrase;
+            }
+        };
+
+        struct key_hash {
+            size_t operator()(const key_t &key) const;
+        };
+
+        struct entry_t {
+            key_t key;
+            TargetPhraseCollection::shared_ptr collection;
+            size_t footprint;
+        };
+
+        typedef std::list<entry_t> lru_t;
+
+        struct shard_t {
+            boost::mutex lock;
+            lru_t lru; // most recently used first
+            boost::unordered_map<key_t, lru_t::iterator, key_hash> entries;
+            size_t memory;
+
+            shard_t() : memory(0) {}
+        };
+
+        static const size_t kShardCount = 16;
+
+        const size_t m_maxShardMemory;
+        boost::atomic<uint64_t> m_watermark;
+        boost::atomic<size_t> m_hits;
+        boost::atomic<size_t> m_misses;
+        boost::atomic<size_t> m_memory;
+
+        shard_t m_shards[kShardCount];
+
+        static size_t EstimateFootprint(const key_t &key, const TargetPhraseCollection::shared_ptr &collection);
+    };
+
+}
+
+#endif //MOSES_TARGETPHRASECACHE_H
@@ -135,6 +135,11 @@ public:
     return m_futureScore;
   }
 
+  /** return the weighted sum of the scores cached in this option, estimates excluded */
+  inline float GetWeightedScore() const {
+    return m_targetPhrase.GetWeightedScore();
+  }
+
   /** return true if the source phrase translates into nothing */
   inline bool IsDeletionOption() const {
     return m_targetPhrase.GetSize() == 0;
@@ -274,26 +274,7 @@ CalcEstimatedScore()
   //   we leave the +inf in the matrix
   // like in chart parsing we want each cell to contain the highest score
   // of the full-span trOpt or the sum of scores of joining two smaller spans
-
-  for(size_t colstart = 1; colstart < size ; colstart++) {
-    for(size_t diagshift = 0; diagshift < size-colstart ; diagshift++) {
-      size_t sPos = diagshift;
-      size_t ePos = colstart+diagshift;
-      for(size_t joinAt = sPos; joinAt < ePos ; joinAt++)  {
-        float joinedScore = m_estimatedScores.GetScore(sPos, joinAt)
-                            + m_estimatedScores.GetScore(joinAt+1, ePos);
-        // uncomment to see the cell filling scheme
-        // TRACE_ERR("[" << sPos << "," << ePos << "] <-? ["
-        // 	  << sPos << "," << joinAt << "]+["
-        // 	  << joinAt+1 << "," << ePos << "] (colstart: "
-        // 	  << colstart << ", diagshift: " << diagshift << ")"
-        // 	  << endl);
-
-        if (joinedScore > m_estimatedScores.GetScore(sPos, ePos))
-          m_estimatedScores.SetScore(sPos, ePos, joinedScore);
-      }
-    }
-  }
+  m_estimatedScores.CalcJoinedScores();
 
   IFVERBOSE(3) {
     int total = 0;
@@ -0,0 +1,180 @@
+// -*- mode: c++; indent-tabs-mode: nil; tab-width:2  -*-
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <boost/functional/hash.hpp>
+#include <boost/unordered_set.hpp>
+
+#include "TrellisKBestExtractor.h"
+#include "TrellisPath.h"
+#include "TrellisPathList.h"
+#include "Hypothesis.h"
+#include "TargetPhrase.h"
+
+using namespace std;
+
+namespace Moses
+{
+
+TrellisKBestExtractor::TrellisKBestExtractor(const std::vector<FactorType> &outputFactors)
+  : m_outputFactors(outputFactors)
+{
+}
+
+TrellisKBestExtractor::~TrellisKBestExtractor()
+{
+}
+
+void TrellisKBestExtractor::Extract(const std::vector<const Hypothesis*> &finalHypos, size_t count,
+                                    bool onlyDistinct, size_t maxCandidates, TrellisPathList &ret)
+{
+  // the root joins the final hypotheses with edges that add nothing to the path
+  m_vertexPool.push_back(Vertex());
+  Vertex &root = m_vertexPool.back();
+  root.hypo = NULL;
+  root.expanded = 0;
+  for (size_t i = 0; i < finalHypos.size(); ++i) {
+    Vertex &vertex = GetVertex(finalHypos[i]);
+    const Derivation *best = LazyKthBest(vertex, 0);
+    if (best)
+      root.candidates.push(CreateDerivation(NULL, &vertex, 0, best));
+  }
+
+  boost::unordered_set<size_t> distinctOutputs;
+  for (size_t k = 0; ret.GetSize() < count && (!onlyDistinct || k < maxCandidates); ++k) {
+    const Derivation *derivation = LazyKthBest(root, k);
+    if (derivation == NULL)
+      break; // no more paths in the graph
+
+    if (onlyDistinct && !distinctOutputs.insert(derivation->outputHash).second)
+      continue;
+
+    ret.Add(CreatePath(*derivation));
+  }
+}
+
+TrellisKBestExtractor::Vertex &TrellisKBestExtractor::GetVertex(const Hypothesis *winner)
+{
+  boost::unordered_map<const Hypothesis*, Vertex*>::iterator it = m_vertices.find(winner);
+  if (it != m_vertices.end())
+    return *it->second;
+
+  m_vertexPool.push_back(Vertex());
+  Vertex &vertex = m_vertexPool.back();
+  vertex.hypo = winner;
+  vertex.expanded = 0;
+  m_vertices[winner] = &vertex;
+
+  // the best derivation through each incoming edge; the winner is the first of them
+  const ArcList *arcList = winner->GetArcList();
+  const size_t numEdges = 1 + (arcList ? arcList->size() : 0);
+  for (size_t i = 0; i < numEdges; ++i) {
+    const Hypothesis *edge = (i == 0) ? winner : (*arcList)[i - 1];
+    const Hypothesis *prevHypo = edge->GetPrevHypo();
+    if (prevHypo == NULL) {
+      vertex.candidates.push(CreateDerivation(edge, NULL, 0, NULL));
+      continue;
+    }
+
+    Vertex &tailVertex = GetVertex(prevHypo);
+    const Derivation *tail = LazyKthBest(tailVertex, 0);
+    if (tail)
+      vertex.candidates.push(CreateDerivation(edge, &tailVertex, 0, tail));
+  }
+
+  return vertex;
+}
+
+const TrellisKBestExtractor::Derivation *
+TrellisKBestExtractor::CreateDerivation(const Hypothesis *edge, Vertex *tailVertex, size_t tailRank, const Derivation *tail)
+{
+  m_derivations.push_back(Derivation());
+  Derivation &derivation = m_derivations.back();
+  derivation.edge = edge;
+  derivation.tailVertex = tailVertex;
+  derivation.tailRank = tailRank;
+  derivation.tail = tail;
+
+  if (tail == NULL) {
+    // initial hypothesis, translates nothing
+    derivation.score = edge->GetFutureScore();
+    derivation.outputHash = 0;
+  } else if (edge == NULL) {
+    // edge of the root
+    derivation.score = tail->score;
+    derivation.outputHash = tail->outputHash;
+  } else {
+    // same coverage and estimated score as the winner of its vertex, so only the difference to the previous hypothesis counts
+    derivation.score = tail->score + edge->GetFutureScore() - edge->GetPrevHypo()->GetFutureScore();
+
+    // word by word, so that different segmentations of the same output hash alike
+    size_t hash = tail->outputHash;
+    const TargetPhrase &phrase = edge->GetCurrTargetPhrase();
+    for (size_t pos = 0; pos < phrase.GetSize(); ++pos) {
+      for (size_t i = 0; i < m_outputFactors.size(); ++i)
+        boost::hash_combine(hash, phrase.GetFactor(pos, m_outputFactors[i]));
+    }
+    derivation.outputHash = hash;
+  }
+
+  return &derivation;
+}
+
+/** the k-th best derivation of vertex (0-based), or NULL if it has fewer.
+ *  The successor of a derivation differs only in its tail, which is the next
+ *  best derivation of the same tail vertex; it becomes a candidate when the
+ *  derivation after it is requested.
+ */
+const TrellisKBestExtractor::Derivation *TrellisKBestExtractor::LazyKthBest(Vertex &vertex, size_t k)
+{
+  while (vertex.kBest.size() <= k) {
+    if (vertex.expanded < vertex.kBest.size()) {
+      const Derivation *last = vertex.kBest.back();
+      ++vertex.expanded;
+      if (last->tailVertex) {
+        const size_t nextRank = last->tailRank + 1;
+        const Derivation *nextTail = LazyKthBest(*last->tailVertex, nextRank);
+        if (nextTail)
+          vertex.candidates.push(CreateDerivation(last->edge, last->tailVertex, nextRank, nextTail));
+      }
+    }
+
+    if (vertex.candidates.empty())
+      return NULL;
+
+    vertex.kBest.push_back(vertex.candidates.top());
+    vertex.candidates.pop();
+  }
+
+  return vertex.kBest[k];
+}
+
+TrellisPath *TrellisKBestExtractor::CreatePath(const Derivation &derivation) const
+{
+  // last edge first, as in TrellisPath
+  std::vector<const Hypothesis*> edges;
+  for (const Derivation *d = &derivation; d != NULL; d = d->tail) {
+    if (d->edge)
+      edges.push_back(d->edge);
+  }
+
+  return new TrellisPath(edges, derivation.score);
+}
+
+}
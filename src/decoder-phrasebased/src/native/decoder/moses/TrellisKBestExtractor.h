@@ -0,0 +1,106 @@
+// -*- mode: c++; indent-tabs-mode: nil; tab-width:2  -*-
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#pragma once
+
+#include <deque>
+#include <queue>
+#include <vector>
+
+#include <boost/unordered_map.hpp>
+
+#include "TypeDef.h"
+
+namespace Moses
+{
+
+class Hypothesis;
+class TrellisPath;
+class TrellisPathList;
+
+/** Lazy k-best extraction from the recombined search graph of phrase-based
+ *  decoding (Huang and Chiang, 2005, "Better k-best parsing", Algorithm 3).
+ *
+ *  Every recombination winner is a vertex; its incoming edges are the winner
+ *  itself and the hypotheses of its arc list, each leading back to the vertex
+ *  of its previous hypothesis. The k-best derivations of a vertex are found on
+ *  demand by merging the derivations of its predecessors, so a derivation is a
+ *  single node pointing to the derivation it extends: no edge vectors are
+ *  copied and no score breakdowns are computed during the search. A
+ *  TrellisPath is built only for the derivations that are actually returned.
+ *
+ *  Distinct n-best lists are filtered by a hash of the output words, kept
+ *  incrementally on each derivation, rather than by comparing phrases.
+ */
+class TrellisKBestExtractor
+{
+public:
+  /** @param outputFactors factors that make two outputs distinct */
+  explicit TrellisKBestExtractor(const std::vector<FactorType> &outputFactors);
+  ~TrellisKBestExtractor();
+
+  /** adds the count best paths ending in one of the (sorted) final hypotheses to ret.
+   *  With onlyDistinct, paths with an output seen before are skipped, and
+   *  the search gives up after maxCandidates paths.
+   */
+  void Extract(const std::vector<const Hypothesis*> &finalHypos, size_t count,
+               bool onlyDistinct, size_t maxCandidates, TrellisPathList &ret);
+
+private:
+  struct Vertex;
+
+  //! a path from the initial hypothesis to edge, sharing its prefix with tail
+  struct Derivation {
+    const Hypothesis *edge; //! last hypothesis of the path, winner or arc
+    Vertex *tailVertex; //! vertex of edge->GetPrevHypo(), NULL for the initial hypothesis
+    size_t tailRank; //! rank of tail among the derivations of tailVertex
+    const Derivation *tail;
+    float score; //! total (future) score of the path
+    size_t outputHash; //! hash of the output words of the path
+  };
+
+  struct CompareDerivation {
+    bool operator()(const Derivation *a, const Derivation *b) const {
+      return a->score < b->score; // max-heap
+    }
+  };
+
+  typedef std::priority_queue<const Derivation*, std::vector<const Derivation*>, CompareDerivation> CandidateHeap;
+
+  //! recombination winner and the derivations found for it so far
+  struct Vertex {
+    const Hypothesis *hypo;
+    std::vector<const Derivation*> kBest; //! in order of decreasing score
+    size_t expanded; //! derivations in kBest whose successor has been put in candidates
+    CandidateHeap candidates;
+  };
+
+  std::vector<FactorType> m_outputFactors;
+  boost::unordered_map<const Hypothesis*, Vertex*> m_vertices;
+  std::deque<Derivation> m_derivations; //! owns all derivations, addresses are stable
+  std::deque<Vertex> m_vertexPool;
+
+  Vertex &GetVertex(const Hypothesis *winner);
+  const Derivation *CreateDerivation(const Hypothesis *edge, Vertex *tailVertex, size_t tailRank, const Derivation *tail);
+  const Derivation *LazyKthBest(Vertex &vertex, size_t k);
+  TrellisPath *CreatePath(const Derivation &derivation) const;
+};
+
+}
@@ -0,0 +1,229 @@
+#include <boost/test/unit_test.hpp>
+
+#include <cstdlib>
+#include <set>
+#include <vector>
+
+#include "FF/StatelessFeatureFunction.h"
+#include "Bitmaps.h"
+#include "ContextScope.h"
+#include "Hypothesis.h"
+#include "Manager.h"
+#include "Sentence.h"
+#include "StaticData.h"
+#include "TranslationOption.h"
+#include "TranslationTask.h"
+#include "TrellisKBestExtractor.h"
+#include "TrellisPath.h"
+#include "TrellisPathCollection.h"
+#include "TrellisPathList.h"
+
+using namespace Moses;
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(trellis_kbest)
+
+//! holds the phrase scores, cached in the target phrases like a phrase table would
+class MockPhraseScore : public StatelessFeatureFunction
+{
+public:
+  MockPhraseScore() : StatelessFeatureFunction(1, "MockPhraseScore") {}
+
+  bool IsUseable(const FactorMask &mask) const {
+    return true;
+  }
+
+  void EvaluateInIsolation(const Phrase &source, const TargetPhrase &targetPhrase
+                           , ScoreComponentCollection &scoreBreakdown
+                           , ScoreComponentCollection &estimatedScores) const {}
+  void EvaluateWithSourceContext(const InputType &input, const InputPath &inputPath
+                                 , const TargetPhrase &targetPhrase, const StackVec *stackVec
+                                 , ScoreComponentCollection &scoreBreakdown
+                                 , ScoreComponentCollection *estimatedScores) const {}
+  void EvaluateTranslationOptionListWithSourceContext(const InputType &input
+      , const TranslationOptionList &translationOptionList) const {}
+  void EvaluateWhenApplied(const Hypothesis &hypo, ScoreComponentCollection *accumulator) const {}
+  void EvaluateWhenApplied(const ChartHypothesis &hypo, ScoreComponentCollection *accumulator) const {}
+};
+
+//! features stay registered for the whole process, like the ones loaded from moses.ini
+static MockPhraseScore &GetPhraseScore()
+{
+  static MockPhraseScore *score = NULL;
+  if (score == NULL) {
+    score = new MockPhraseScore();
+    FeatureFunction::Register(score);
+  }
+  return *score;
+}
+
+/** A monotone search graph over a short sentence: one recombination winner for every
+ *  translated prefix, reached from every shorter prefix by a few options with random scores.
+ *  The losers end up in the arc lists of the winners, as in the stacks.
+ */
+class SearchGraphFixture
+{
+public:
+  SearchGraphFixture() : m_score(GetPhraseScore()), m_weights(new ScoreComponentCollection()) {
+    m_weights->Assign(&m_score, 1.0f);
+  }
+
+  ~SearchGraphFixture() {
+    // winners delete the hypotheses in their arc lists
+    for (size_t i = m_winners.size(); i-- > 0;)
+      delete m_winners[i];
+    RemoveAllInColl(m_options);
+  }
+
+  void Build(const string &source, size_t optionsPerSpan) {
+    AllOptions::ptr opts(new AllOptions(*StaticData::Instance().options()));
+    m_sentence.reset(new Sentence(opts, 0, source));
+    m_scope.reset(new ContextScope(m_weights));
+    m_ttask = TranslationTask::create(m_sentence, boost::shared_ptr<IOWrapper>(), m_scope);
+    m_manager.reset(new Manager(m_ttask));
+    m_manager->ResetSentenceStats(*m_sentence);
+    m_bitmaps.reset(new Bitmaps(m_sentence->GetSize(), m_sentence->m_sourceCompleted));
+
+    m_initialOption.reset(new TranslationOption(m_ttask));
+    m_winners.push_back(new (m_manager->GetHypothesisPool()) Hypothesis(*m_manager, *m_sentence, *m_initialOption,
+                        m_bitmaps->GetInitialBitmap(), m_manager->GetNextHypoId()));
+    m_winners.back()->CleanupArcList(0, true);
+
+    const char *words[] = {"a", "b", "c"};
+    for (size_t end = 1; end <= m_sentence->GetSize(); ++end) {
+      vector<Hypothesis*> group;
+      for (size_t start = 0; start < end; ++start) {
+        for (size_t i = 0; i < optionsPerSpan; ++i) {
+          string target;
+          for (size_t length = rand() % 3; length > 0; --length)
+            target += string(words[rand() % 3]) + " ";
+
+          Hypothesis *prev = m_winners[start];
+          const Bitmap &bitmap = m_bitmaps->GetBitmap(prev->GetWordsBitmap(), Range(start, end - 1));
+          Hypothesis *hypo = new (m_manager->GetHypothesisPool()) Hypothesis(*prev,
+              *MakeOption(start, end - 1, target), bitmap, m_manager->GetNextHypoId());
+          hypo->EvaluateWhenApplied(0.0f, *m_weights);
+          group.push_back(hypo);
+        }
+      }
+
+      Hypothesis *winner = group[0];
+      for (size_t i = 1; i < group.size(); ++i) {
+        if (group[i]->GetFutureScore() > winner->GetFutureScore())
+          winner = group[i];
+      }
+      for (size_t i = 0; i < group.size(); ++i) {
+        if (group[i] != winner)
+          winner->AddArc(group[i]);
+      }
+      // as the stacks do before being expanded: the arcs point to their winner, all kept
+      winner->CleanupArcList(0, true);
+      m_winners.push_back(winner);
+    }
+  }
+
+  const Hypothesis *GetFinalHypothesis() const {
+    return m_winners.back();
+  }
+
+  const vector<FactorType> &GetOutputFactors() const {
+    return m_sentence->options()->output.factor_order;
+  }
+
+private:
+  const TranslationOption *MakeOption(size_t startPos, size_t endPos, const string &target) {
+    TargetPhrase targetPhrase(m_ttask);
+    targetPhrase.CreateFromString(Output, GetOutputFactors(), target, NULL);
+    targetPhrase.GetScoreBreakdown().Assign(&m_score, -(float) (rand() % 100000) / 997.0f);
+    targetPhrase.EvaluateInIsolation(Phrase(), vector<FeatureFunction*>(1, &m_score));
+
+    m_options.push_back(new TranslationOption(Range(startPos, endPos), targetPhrase));
+    return m_options.back();
+  }
+
+  MockPhraseScore &m_score;
+  boost::shared_ptr<ScoreComponentCollection> m_weights;
+  boost::shared_ptr<Sentence> m_sentence;
+  boost::shared_ptr<ContextScope> m_scope;
+  ttasksptr m_ttask;
+  boost::shared_ptr<Manager> m_manager;
+  boost::shared_ptr<Bitmaps> m_bitmaps;
+  boost::shared_ptr<TranslationOption> m_initialOption;
+  vector<Hypothesis*> m_winners;
+  vector<TranslationOption*> m_options;
+};
+
+//! the n-best extraction Manager::CalcNBest() used before TrellisKBestExtractor
+static void ExtractWithDeviantPaths(const Hypothesis *finalHypo, size_t count, bool onlyDistinct,
+                                    size_t nBestFactor, TrellisPathList &ret)
+{
+  TrellisPathCollection contenders;
+  set<Phrase> distinctHyps;
+  contenders.Add(new TrellisPath(finalHypo));
+
+  for (size_t iteration = 0; (onlyDistinct ? distinctHyps.size() : ret.GetSize()) < count
+       && contenders.GetSize() > 0 && iteration < count * nBestFactor; iteration++) {
+    TrellisPath *path = contenders.pop();
+    path->CreateDeviantPaths(contenders);
+    if (onlyDistinct) {
+      if (distinctHyps.insert(path->GetSurfacePhrase()).second)
+        ret.Add(path);
+      else
+        delete path;
+      contenders.Prune(count * nBestFactor);
+    } else {
+      ret.Add(path);
+      contenders.Prune(count);
+    }
+  }
+}
+
+static void CheckSameList(const TrellisPathList &expected, const TrellisPathList &actual)
+{
+  BOOST_REQUIRE_EQUAL(actual.GetSize(), expected.GetSize());
+
+  TrellisPathList::const_iterator e = expected.begin();
+  TrellisPathList::const_iterator a = actual.begin();
+  for (; e != expected.end(); ++e, ++a) {
+    BOOST_CHECK_CLOSE((*a)->GetFutureScore(), (*e)->GetFutureScore(), 0.001f);
+    BOOST_CHECK_EQUAL((*a)->GetSurfacePhrase(), (*e)->GetSurfacePhrase());
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(matches_deviant_paths, SearchGraphFixture)
+{
+  srand(11);
+  Build("s1 s2 s3 s4 s5", 2);
+
+  size_t counts[] = {1, 2, 10, 100, 1000};
+  for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); ++i) {
+    TrellisPathList expected;
+    ExtractWithDeviantPaths(GetFinalHypothesis(), counts[i], false, 1000, expected);
+
+    TrellisPathList actual;
+    TrellisKBestExtractor extractor(GetOutputFactors());
+    extractor.Extract(vector<const Hypothesis*>(1, GetFinalHypothesis()), counts[i], false, counts[i] * 1000, actual);
+
+    CheckSameList(expected, actual);
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(distinct_matches_deviant_paths, SearchGraphFixture)
+{
+  srand(23);
+  Build("s1 s2 s3 s4", 3);
+
+  size_t counts[] = {1, 5, 20};
+  for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); ++i) {
+    TrellisPathList expected;
+    ExtractWithDeviantPaths(GetFinalHypothesis(), counts[i], true, 1000, expected);
+
+    TrellisPathList actual;
+    TrellisKBestExtractor extractor(GetOutputFactors());
+    extractor.Extract(vector<const Hypothesis*>(1, GetFinalHypothesis()), counts[i], true, counts[i] * 1000, actual);
+
+    CheckSameList(expected, actual);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -85,6 +85,12 @@ TrellisPath::TrellisPath(const vector<const Hypothesis*> edges)
   InitTotalScore();
 }
 
+TrellisPath::TrellisPath(const vector<const Hypothesis*> &path, float totalScore)
+  :m_path(path)
+  ,m_prevEdgeChanged(NOT_FOUND)
+  ,m_totalScore(totalScore)
+{
+}
 
 void TrellisPath::CreateDeviantPaths(TrellisPathCollection &pathColl) const
 {
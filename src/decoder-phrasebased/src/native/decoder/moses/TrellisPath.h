@@ -44,6 +44,7 @@ class TrellisPath
 {
   friend std::ostream& operator<<(std::ostream&, const TrellisPath&);
   friend class Manager;
+  friend class TrellisKBestExtractor;
 
 protected:
   std::vector<const Hypothesis *> m_path; //< list of hypotheses/arcs
@@ -58,6 +59,9 @@ protected:
   //Used by Manager::LatticeSample()
   explicit TrellisPath(const std::vector<const Hypothesis*> edges);
 
+  //Used by TrellisKBestExtractor, edges are in path order (last edge first)
+  TrellisPath(const std::vector<const Hypothesis*> &path, float totalScore);
+
   void InitTotalScore();
 
   Manager const& manager() const {
@@ -68,6 +68,7 @@ const float LOWEST_SCORE							= -100.0f;
 const float DEFAULT_BEAM_WIDTH				= 0.00001f;
 const float DEFAULT_EARLY_DISCARDING_THRESHOLD		= 0.0f;
 const float DEFAULT_TRANSLATION_OPTION_THRESHOLD	= 0.0f;
+const size_t DEFAULT_SEARCH_THREADS_MIN_LENGTH	= 30;
 const size_t DEFAULT_VERBOSE_LEVEL = 1;
 
 // output floats with five significant digits
@@ -153,6 +154,14 @@ enum SearchAlgorithm {
   DefaultSearchAlgorithm = 777 // means: use StaticData.m_searchAlgorithm
 };
 
+// how much the phrase-based search was simplified to fit its time budget (see Manager::SetTimeBudget)
+enum SearchDegradation {
+  NoDegradation = 0, // full search
+  ReducedBeam = 1, // smaller stacks, fewer translation options per span
+  MonotoneSearch = 2, // as above, without reordering
+  InterruptedSearch = 3 // stopped early, SearchNormal completes its best partial hypothesis greedily
+};
+
 enum SourceLabelOverlap {
   SourceLabelOverlapAdd = 0,
   SourceLabelOverlapReplace = 1,
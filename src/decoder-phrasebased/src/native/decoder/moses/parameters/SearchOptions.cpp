@@ -18,6 +18,8 @@ namespace Moses
     , consensus(false)
     , early_discarding_threshold(DEFAULT_EARLY_DISCARDING_THRESHOLD)
     , trans_opt_threshold(DEFAULT_TRANSLATION_OPTION_THRESHOLD)
+    , threads(1)
+    , threads_min_length(DEFAULT_SEARCH_THREADS_MIN_LENGTH)
   { }
 
   SearchOptions::
@@ -49,6 +51,9 @@ namespace Moses
 
     param.SetParameter(consensus, "consensus-decoding", false);
     param.SetParameter(disable_discarding, "disable-discarding", false);
+    param.SetParameter(threads, "search-threads", size_t(1));
+    param.SetParameter(threads_min_length, "search-threads-min-length",
+                       DEFAULT_SEARCH_THREADS_MIN_LENGTH);
     
     // transformation to log of a few scores
     beam_width = TransformScore(beam_width);
@@ -35,6 +35,11 @@ namespace Moses
     float early_discarding_threshold;
     float trans_opt_threshold;
 
+    // intra-sentence parallelism: hypotheses of one stack are expanded by
+    // up to 'threads' threads, for inputs of at least 'threads_min_length' words
+    size_t threads;
+    size_t threads_min_length;
+
     bool init(Parameter const& param);
     SearchOptions(Parameter const& param);
     SearchOptions();
@@ -4,6 +4,8 @@
 #include "Parameter.h"
 namespace Moses
 {
+  // seconds in a timeout specification such as "2h30m" or "1d"
+  size_t parse_timespec(std::string const& spec);
 
   struct 
   ServerOptions 
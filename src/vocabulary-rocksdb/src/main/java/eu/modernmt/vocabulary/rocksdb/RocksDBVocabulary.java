@@ -8,6 +8,7 @@ import org.apache.logging.log4j.Logger;
 
 import java.io.File;
 import java.io.IOException;
+import java.nio.ByteBuffer;
 import java.util.Arrays;
 import java.util.List;
 
@@ -97,6 +98,26 @@ public class RocksDBVocabulary implements Vocabulary {
         return result;
     }
 
+    /**
+     * Bulk version of lookup: word i is read from the direct buffer "tokens" as the UTF-8 bytes
+     * in range [offsets[i], offsets[i + 1]). Ids are written in output[0, count).
+     * The whole batch is resolved with a constant number of JNI calls.
+     *
+     * @throws IllegalArgumentException if tokens is not a direct buffer, or the arrays or offsets do not
+     *                                  fit count and the buffer
+     */
+    public native void lookupBuffer(ByteBuffer tokens, int[] offsets, int count, int[] output, boolean putIfAbsent);
+
+    /**
+     * Bulk version of reverseLookup: the words of ids[0, count) are written as UTF-8 bytes in the
+     * direct buffer "output", word i in range [offsets[i], offsets[i + 1]). Unknown ids produce an
+     * empty range.
+     *
+     * @return the number of bytes written, or the negated number of bytes required if the buffer is too small
+     * @throws IllegalArgumentException if output is not a direct buffer, or the arrays are shorter than count
+     */
+    public native int reverseLookupBuffer(int[] ids, int count, ByteBuffer output, int[] offsets);
+
     @Override
     public long getNativeHandle() {
         return nativeHandle;
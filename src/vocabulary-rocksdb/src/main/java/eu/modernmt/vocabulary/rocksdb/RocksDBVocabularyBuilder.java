@@ -92,6 +92,6 @@ public class RocksDBVocabularyBuilder implements VocabularyBuilder {
         return new RocksDBVocabulary(model);
     }
 
-    private native void flush(String[] words, int[] ids, int id, String path);
+    private native void flush(String[] words, int[] ids, int id, String path) throws IOException;
 
 }
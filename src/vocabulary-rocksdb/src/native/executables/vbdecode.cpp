@@ -55,6 +55,7 @@ int main(int argc, const char *argv[]) {
     string modelPath = argv[1];
 
     PersistentVocabulary vocabulary(modelPath);
+    vocabulary.PreloadCache();
 
     vector<vector<wid_t>> buffer;
     vector<vector<string>> output;
@@ -42,6 +42,7 @@ int main(int argc, const char *argv[]) {
 
     string modelPath = argv[1];
     PersistentVocabulary vocabulary(modelPath);
+    vocabulary.PreloadCache();
 
     vector<vector<string>> buffer;
     vector<vector<wid_t>> output;
@@ -0,0 +1,23 @@
+#include <vocabulary/PersistentVocabulary.h>
+#include <iostream>
+
+using namespace std;
+using namespace mmt;
+using namespace mmt::vocabulary;
+
+int main(int argc, const char *argv[]) {
+    if (argc != 2) {
+        cerr << "USAGE: vbsnapshot <model_path>" << endl;
+        exit(1);
+    }
+
+    string modelPath = argv[1];
+    PersistentVocabulary vocabulary(modelPath, false, 0);
+
+    if (!vocabulary.WriteSnapshot()) {
+        cerr << "ERROR: unable to write vocabulary snapshot in " << modelPath << endl;
+        exit(2);
+    }
+
+    return 0;
+}
@@ -3,6 +3,7 @@
 //
 
 #include <string>
+#include <cstring>
 #include <vocabulary/PersistentVocabulary.h>
 #include <mmt/jniutil.h>
 #include "javah/eu_modernmt_vocabulary_rocksdb_RocksDBVocabulary.h"
@@ -54,18 +55,18 @@ static inline const void ParseIntLine(JNIEnv *jvm, jintArray jline, vector<wid_t
     jvm->ReleaseIntArrayElements(jline, line, 0);
 }
 
-static inline const jintArray EncodeIntLine(JNIEnv *jvm, vector<wid_t> &line) {
-    jsize length = (jsize) line.size();
+static inline void ThrowIllegalArgument(JNIEnv *jvm, const char *message) {
+    jclass exceptionClass = jvm->FindClass("java/lang/IllegalArgumentException");
+    jvm->ThrowNew(exceptionClass, message);
+}
 
-    const wid_t *rawLine = line.data();
-    jint *array = new jint[length];
+static_assert(sizeof(jint) == sizeof(wid_t), "Current implementation only support 4-byte word id");
 
-    for (jsize i = 0; i < length; ++i)
-        array[i] = (jint) rawLine[i];
+static inline const jintArray EncodeIntLine(JNIEnv *jvm, vector<wid_t> &line) {
+    jsize length = (jsize) line.size();
 
     jintArray result = jvm->NewIntArray(length);
-    jvm->SetIntArrayRegion(result, 0, length, array);
-    delete[] array;
+    jvm->SetIntArrayRegion(result, 0, length, (const jint *) line.data());
 
     return result;
 }
@@ -234,4 +235,129 @@ Java_eu_modernmt_vocabulary_rocksdb_RocksDBVocabulary_reverseLookupLines(JNIEnv
     jclass jstringClass = LoadStringClass(jvm);
     for (jsize i = 0; i < bufferSize; ++i)
         jvm->SetObjectArrayElement(joutput, i, EncodeStringLine(jvm, output[i], jstringClass));
-}
\ No newline at end of file
+}
+
+/*
+ * Class:     eu_modernmt_vocabulary_rocksdb_RocksDBVocabulary
+ * Method:    lookupBuffer
+ * Signature: (Ljava/nio/ByteBuffer;[II[IZ)V
+ */
+JNIEXPORT void JNICALL
+Java_eu_modernmt_vocabulary_rocksdb_RocksDBVocabulary_lookupBuffer(JNIEnv *jvm, jobject jself, jobject jtokens,
+                                                                   jintArray joffsets, jint count, jintArray joutput,
+                                                                   jboolean putIfAbsent) {
+    Vocabulary *self = jni_gethandle<Vocabulary>(jvm, jself);
+
+    if (count < 0) {
+        ThrowIllegalArgument(jvm, "negative count");
+        return;
+    }
+    if (count == 0)
+        return;
+
+    const char *tokens = (const char *) jvm->GetDirectBufferAddress(jtokens);
+    if (tokens == NULL) {
+        ThrowIllegalArgument(jvm, "tokens is not a direct buffer");
+        return;
+    }
+    if (jvm->GetArrayLength(joffsets) <= count) {
+        ThrowIllegalArgument(jvm, "offsets must have count + 1 elements");
+        return;
+    }
+    if (jvm->GetArrayLength(joutput) < count) {
+        ThrowIllegalArgument(jvm, "output must have count elements");
+        return;
+    }
+
+    vector<jint> offsets((size_t) count + 1);
+    jvm->GetIntArrayRegion(joffsets, 0, count + 1, offsets.data());
+
+    jlong capacity = jvm->GetDirectBufferCapacity(jtokens);
+    if (offsets[0] < 0 || offsets[count] > capacity) {
+        ThrowIllegalArgument(jvm, "offsets out of the tokens buffer");
+        return;
+    }
+    for (jint i = 0; i < count; ++i) {
+        if (offsets[i + 1] < offsets[i]) {
+            ThrowIllegalArgument(jvm, "offsets must not decrease");
+            return;
+        }
+    }
+
+    vector<vector<string>> buffer(1);
+    vector<string> &line = buffer[0];
+    line.reserve((size_t) count);
+
+    for (jint i = 0; i < count; ++i)
+        line.push_back(string(tokens + offsets[i], (size_t) (offsets[i + 1] - offsets[i])));
+
+    vector<vector<wid_t>> output;
+    self->Lookup(buffer, &output, putIfAbsent);
+
+    jvm->SetIntArrayRegion(joutput, 0, count, (const jint *) output[0].data());
+}
+
+/*
+ * Class:     eu_modernmt_vocabulary_rocksdb_RocksDBVocabulary
+ * Method:    reverseLookupBuffer
+ * Signature: ([IILjava/nio/ByteBuffer;[I)I
+ */
+JNIEXPORT jint JNICALL
+Java_eu_modernmt_vocabulary_rocksdb_RocksDBVocabulary_reverseLookupBuffer(JNIEnv *jvm, jobject jself, jintArray jids,
+                                                                          jint count, jobject joutput,
+                                                                          jintArray joffsets) {
+    Vocabulary *self = jni_gethandle<Vocabulary>(jvm, jself);
+
+    if (count < 0) {
+        ThrowIllegalArgument(jvm, "negative count");
+        return 0;
+    }
+    if (count == 0)
+        return 0;
+    if (jvm->GetArrayLength(jids) < count) {
+        ThrowIllegalArgument(jvm, "ids must have count elements");
+        return 0;
+    }
+    if (jvm->GetArrayLength(joffsets) <= count) {
+        ThrowIllegalArgument(jvm, "offsets must have count + 1 elements");
+        return 0;
+    }
+
+    char *data = (char *) jvm->GetDirectBufferAddress(joutput);
+    if (data == NULL) {
+        ThrowIllegalArgument(jvm, "output is not a direct buffer");
+        return 0;
+    }
+    jlong capacity = jvm->GetDirectBufferCapacity(joutput);
+
+    vector<vector<wid_t>> buffer(1);
+    buffer[0].resize((size_t) count);
+    jvm->GetIntArrayRegion(jids, 0, count, (jint *) buffer[0].data());
+
+    vector<vector<string>> output;
+    self->ReverseLookup(buffer, output);
+    const vector<string> &words = output[0];
+
+    size_t required = 0;
+    for (auto word = words.begin(); word != words.end(); ++word)
+        required += word->size();
+
+    if ((jlong) required > capacity)
+        return -((jint) required);
+
+    vector<jint> offsets((size_t) count + 1);
+    size_t ptr = 0;
+
+    for (jint i = 0; i < count; ++i) {
+        const string &word = words[i];
+
+        offsets[i] = (jint) ptr;
+        memcpy(data + ptr, word.data(), word.size());
+        ptr += word.size();
+    }
+    offsets[count] = (jint) ptr;
+
+    jvm->SetIntArrayRegion(joffsets, 0, count + 1, offsets.data());
+
+    return (jint) ptr;
+}
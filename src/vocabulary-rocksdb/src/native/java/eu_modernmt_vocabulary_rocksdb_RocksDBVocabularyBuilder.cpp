@@ -39,4 +39,8 @@ Java_eu_modernmt_vocabulary_rocksdb_RocksDBVocabularyBuilder_flush(JNIEnv *jvm,
 
     vocabulary.ForceCompaction();
     vocabulary.ResetId((wid_t) nextId);
+    if (!vocabulary.WriteSnapshot()) {
+        jclass exceptionClass = jvm->FindClass("java/io/IOException");
+        jvm->ThrowNew(exceptionClass, "unable to write vocabulary snapshot");
+    }
 }
\ No newline at end of file
@@ -4,6 +4,8 @@
 
 #include <iostream>
 #include <cassert>
+#include <fcntl.h>
+#include <unistd.h>
 #include "IdGenerator.h"
 
 using namespace std;
@@ -12,7 +14,11 @@ using namespace mmt::vocabulary;
 
 static_assert(sizeof(wid_t) == 4, "Current implementation only support 4-byte word id");
 
-static void write(wid_t value, FILE *file) {
+#ifdef __APPLE__
+#define fdatasync fsync
+#endif
+
+static void write(wid_t value, int fd) {
     uint8_t buffer[4];
 
     buffer[0] = (uint8_t) (value & 0x000000FF);
@@ -20,67 +26,72 @@ static void write(wid_t value, FILE *file) {
     buffer[2] = (uint8_t) ((value & 0x00FF0000) >> 16);
     buffer[3] = (uint8_t) ((value & 0xFF000000) >> 24);
 
-    fseek(file, 0, SEEK_SET);
-    fwrite((void *)buffer, sizeof(uint8_t), 4, file);
-    fflush(file);
-}
+    ssize_t written_bytes = pwrite(fd, (void *) buffer, 4, 0);
+    assert(written_bytes == 4);
 
-static wid_t read(FILE *file) {
-    fseek(file, 0, SEEK_SET);
+    fdatasync(fd);
+}
 
+static bool read(int fd, wid_t *output) {
     uint8_t buffer[4];
-    size_t read_bytes = fread((void *) buffer, sizeof(uint8_t), 4, file);
-    assert(read_bytes == 4);
+    if (pread(fd, (void *) buffer, 4, 0) != 4)
+        return false;
 
     wid_t id = buffer[0] & 0xFFU;
     id += (buffer[1] & 0xFFU) << 8;
     id += (buffer[2] & 0xFFU) << 16;
     id += (buffer[3] & 0xFFU) << 24;
 
-    return id;
+    *output = id;
+    return true;
 }
 
 IdGenerator::IdGenerator(string &filepath, wid_t idStep) : idStep(idStep) {
-    const char *cpath = filepath.c_str();
+    storage = open(filepath.c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    assert(storage != -1);
 
-    if (FILE *file = fopen(cpath, "r")) {
-        counter = read(file);
-        fclose(file);
-    } else {
-        counter = 0;
-    }
+    wid_t value;
+    if (!read(storage, &value))
+        value = 0;
 
-    wid_t upperbound = ((counter / idStep) + 1) * idStep;
-
-    storage = fopen(cpath, "w+");
+    wid_t upperbound = ((value / idStep) + 1) * idStep;
     write(upperbound, storage);
+
+    counter = value;
+    highWaterMark = upperbound;
 }
 
 IdGenerator::~IdGenerator() {
     write(counter, storage);
-    fclose(storage);
+    close(storage);
 }
 
-wid_t IdGenerator::Next() {
-    wid_t result;
-
-    m.lock();
-    {
-        result = counter++;
+wid_t IdGenerator::NextRange(wid_t count) {
+    wid_t result = counter.fetch_add(count);
+    wid_t end = result + count;
 
-        if (result % idStep == 0)
-            write(result + idStep, storage);
-    };
-    m.unlock();
+    if (end > highWaterMark.load(memory_order_acquire))
+        Reserve(end);
 
     return result;
 }
 
+void IdGenerator::Reserve(wid_t end) {
+    lock_guard<mutex> guard(m);
+
+    if (end <= highWaterMark.load(memory_order_relaxed))
+        return;
+
+    // Leave one extra step of headroom so that concurrent callers keep on the lock-free path
+    wid_t upperbound = ((end / idStep) + 2) * idStep;
+    write(upperbound, storage);
+    highWaterMark.store(upperbound, memory_order_release);
+}
+
 void IdGenerator::Reset(wid_t id) {
-    m.lock();
-    {
-        counter = id;
-        write(id + idStep, storage);
-    };
-    m.unlock();
+    lock_guard<mutex> guard(m);
+
+    counter = id;
+    write(id + idStep, storage);
+    highWaterMark.store(id + idStep, memory_order_release);
 }
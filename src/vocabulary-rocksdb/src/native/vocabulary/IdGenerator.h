@@ -7,6 +7,7 @@
 
 #include <string>
 #include <mutex>
+#include <atomic>
 #include <cstdint>
 #include <mmt/sentence.h>
 
@@ -15,21 +16,33 @@ using namespace std;
 namespace mmt {
     namespace vocabulary {
 
+        /*
+         * Ids are handed out with an atomic fetch-add. The file on disk always holds a high-water mark
+         * greater than any id returned so far: it is moved forward (pwrite + fdatasync) only when a
+         * request crosses it, so ids are never reused after a crash.
+         */
         class IdGenerator {
         public:
             IdGenerator(string &filepath, wid_t idStep = 1000);
 
             ~IdGenerator();
 
-            wid_t Next();
+            wid_t Next() {
+                return NextRange(1);
+            }
+
+            wid_t NextRange(wid_t count);
 
             void Reset(wid_t id);
 
         private:
-            wid_t idStep;
-            wid_t counter;
-            FILE *storage;
+            const wid_t idStep;
+            atomic<wid_t> counter;
+            atomic<wid_t> highWaterMark;
+            int storage;
             mutex m;
+
+            void Reserve(wid_t end);
         };
 
     }
@@ -9,7 +9,9 @@
 #include <rocksdb/memtablerep.h>
 #include <rocksdb/slice_transform.h>
 #include <rocksdb/merge_operator.h>
+#include <rocksdb/write_batch.h>
 #include <thread>
+#include <algorithm>
 
 #define MakeSlice(buffer) (Slice((const char *) buffer, 4))
 
@@ -26,6 +28,8 @@ using namespace mmt::vocabulary;
 
 static_assert(sizeof(wid_t) == 4, "Current implementation only support 4-byte word id");
 
+static const size_t kParallelEncodingMinLines = 10000;
+
 static const void Serialize(wid_t value, uint8_t *output) {
     output[0] = (uint8_t) (value & 0x000000FF);
     output[1] = (uint8_t) ((value & 0x0000FF00) >> 8);
@@ -72,7 +76,9 @@ public:
     virtual bool
     FullMerge(const Slice &key, const Slice *existing_value, const deque<string> &operand_list, string *new_value,
               Logger *logger) const {
-        if (existing_value == nullptr) {
+        if (existing_value != nullptr) {
+            *new_value = existing_value->ToString();
+        } else {
             wid_t maxId = 0;
 
             for (auto i = operand_list.begin(); i != operand_list.end(); ++i) {
@@ -132,8 +138,10 @@ public:
 
 // PersistentVocabulary implementation
 
-PersistentVocabulary::PersistentVocabulary(string basepath, bool prepareForBulkLoad) :
-        idGeneratorPath(basepath + kPathSeparator + "_id"), idGenerator(idGeneratorPath) {
+PersistentVocabulary::PersistentVocabulary(string basepath, bool prepareForBulkLoad, size_t cacheSize) :
+        idGeneratorPath(basepath + kPathSeparator + "_id"), snapshotPath(basepath + kPathSeparator + "snapshot"),
+        idGenerator(idGeneratorPath), cache(cacheSize > 0 && !prepareForBulkLoad ? new VocabularyCache(cacheSize) : NULL),
+        snapshot(prepareForBulkLoad ? NULL : VocabularySnapshot::Open(snapshotPath)) {
     rocksdb::Options options;
     options.create_if_missing = true;
     options.merge_operator.reset(new NewWordOperator());
@@ -173,10 +181,18 @@ PersistentVocabulary::PersistentVocabulary(string basepath, bool prepareForBulkL
     status = DB::Open(options, reversePath, &reverseDb);
     assert(status.ok());
 
-    ForceCompaction();
+    // With a snapshot in place, RocksDB only serves the words added after it: no need to compact at startup
+    if (!snapshot)
+        ForceCompaction();
 }
 
 wid_t PersistentVocabulary::Lookup(const string &word, bool putIfAbsent) {
+    wid_t cached;
+    if (snapshot && snapshot->Lookup(word, &cached))
+        return cached;
+    if (cache && cache->Get(word, &cached))
+        return cached;
+
     ReadOptions options = ReadOptions();
     options.verify_checksums = false;
 
@@ -209,42 +225,169 @@ wid_t PersistentVocabulary::Lookup(const string &word, bool putIfAbsent) {
     }
 
     wid_t output;
-    return Deserialize(value, &output) ? output : kVocabularyUnknownWord;
+    if (!Deserialize(value, &output))
+        return kVocabularyUnknownWord;
+
+    if (cache)
+        cache->Put(word, output);
+
+    return output;
 }
 
 void
 PersistentVocabulary::Lookup(const vector<vector<string>> &buffer, vector<vector<wid_t>> *output, bool putIfAbsent) {
     unordered_map<string, wid_t> vocabulary(buffer.size() * 20);
 
+    // Collect unique words and resolve the ones already known by the snapshot or the cache
+    vector<const string *> unknowns;
+
     for (auto line = buffer.begin(); line != buffer.end(); ++line) {
-        size_t length = line->size();
+        for (auto word = line->begin(); word != line->end(); ++word) {
+            auto inserted = vocabulary.emplace(*word, kVocabularyUnknownWord);
+            if (!inserted.second)
+                continue;
 
-        vector<wid_t> encoded;
-        for (size_t i = 0; i < length; ++i) {
             wid_t id;
-            const string &word = line->at(i);
+            if ((snapshot && snapshot->Lookup(*word, &id)) || (cache && cache->Get(*word, &id)))
+                inserted.first->second = id;
+            else
+                unknowns.push_back(&inserted.first->first);
+        }
+    }
+
+    // Resolve the remaining words with a single MultiGet
+    if (!unknowns.empty()) {
+        ReadOptions options = ReadOptions();
+        options.verify_checksums = false;
+
+        vector<Slice> keys;
+        keys.reserve(unknowns.size());
+        for (auto word = unknowns.begin(); word != unknowns.end(); ++word)
+            keys.push_back(Slice(**word));
+
+        vector<string> values;
+        vector<Status> statuses = directDb->MultiGet(options, keys, &values);
+
+        vector<size_t> misses;
+
+        for (size_t i = 0; i < unknowns.size(); ++i) {
+            wid_t id;
 
-            auto valueRef = vocabulary.find(word);
-            if (valueRef != vocabulary.end()) {
-                id = valueRef->second;
+            if (statuses[i].ok() && Deserialize(values[i], &id)) {
+                vocabulary[*unknowns[i]] = id;
+
+                if (cache)
+                    cache->Put(*unknowns[i], id);
             } else {
-                id = Lookup(word, putIfAbsent);
-                vocabulary[word] = id;
+                assert(statuses[i].ok() || statuses[i].IsNotFound());
+                misses.push_back(i);
             }
+        }
+
+        if (putIfAbsent && !misses.empty())
+            PutBatch(keys, misses, vocabulary);
+    }
+
+    if (!output)
+        return;
+
+    // Encode lines, the vocabulary map is now read-only and can be shared among threads
+    size_t offset = output->size();
+    output->resize(offset + buffer.size());
 
-            if (output)
-                encoded.push_back(id);
+    auto encode = [&buffer, &vocabulary, output, offset](size_t begin, size_t end) {
+        for (size_t l = begin; l < end; ++l) {
+            const vector<string> &line = buffer[l];
+            vector<wid_t> &encoded = output->at(offset + l);
+
+            encoded.reserve(line.size());
+            for (auto word = line.begin(); word != line.end(); ++word)
+                encoded.push_back(vocabulary.find(*word)->second);
         }
+    };
+
+    size_t threads = min((size_t) max(thread::hardware_concurrency(), 1U), buffer.size() / kParallelEncodingMinLines);
 
-        if (output)
-            output->push_back(encoded);
+    if (threads > 1) {
+        vector<thread> workers;
+        size_t step = (buffer.size() + threads - 1) / threads;
+
+        for (size_t begin = 0; begin < buffer.size(); begin += step)
+            workers.push_back(thread(encode, begin, min(begin + step, buffer.size())));
+
+        for (auto worker = workers.begin(); worker != workers.end(); ++worker)
+            worker->join();
+    } else {
+        encode(0, buffer.size());
     }
 }
 
+void PersistentVocabulary::PutBatch(const vector<Slice> &keys, const vector<size_t> &misses,
+                                    unordered_map<string, wid_t> &vocabulary) {
+    wid_t firstId = idGenerator.NextRange((wid_t) misses.size()) + kVocabularyWordIdStart;
+
+    // Merge operator keeps the first id assigned to a word, even in case of concurrent insertions
+    WriteBatch directBatch;
+    vector<Slice> missingKeys;
+    missingKeys.reserve(misses.size());
+
+    uint8_t buffer[4];
+    for (size_t i = 0; i < misses.size(); ++i) {
+        const Slice &key = keys[misses[i]];
+        Serialize(firstId + (wid_t) i, buffer);
+
+        directBatch.Merge(key, MakeSlice(buffer));
+        missingKeys.push_back(key);
+    }
+
+    Status status = directDb->Write(WriteOptions(), &directBatch);
+    assert(status.ok());
+
+    ReadOptions options = ReadOptions();
+    options.verify_checksums = false;
+
+    vector<string> values;
+    vector<Status> statuses = directDb->MultiGet(options, missingKeys, &values);
+
+    WriteBatch reverseBatch;
+
+    for (size_t i = 0; i < missingKeys.size(); ++i) {
+        assert(statuses[i].ok());
+
+        wid_t id;
+        if (!Deserialize(values[i], &id))
+            continue;
+
+        string word = missingKeys[i].ToString();
+        reverseBatch.Put(Slice(values[i]), missingKeys[i]);
+
+        if (cache)
+            cache->Put(word, id);
+
+        vocabulary[word] = id;
+    }
+
+    status = reverseDb->Write(WriteOptions(), &reverseBatch);
+    assert(status.ok());
+}
+
 const bool PersistentVocabulary::ReverseLookup(wid_t id, string *output) {
     if (id < kVocabularyWordIdStart)
         return true;
 
+    // A snapshot older than RocksDB may lack words: ask the cache and RocksDB when it has no answer
+    if (snapshot && snapshot->ReverseLookup(id, output))
+        return true;
+
+    if (cache) {
+        const string *cached = cache->Get(id);
+
+        if (cached) {
+            *output = *cached;
+            return true;
+        }
+    }
+
     ReadOptions options = ReadOptions();
     options.verify_checksums = false;
 
@@ -261,6 +404,9 @@ const bool PersistentVocabulary::ReverseLookup(wid_t id, string *output) {
         assert(false);
     }
 
+    if (cache)
+        cache->Put(*output, id);
+
     return true;
 }
 
@@ -305,6 +451,9 @@ void PersistentVocabulary::Put(const string &_word, const wid_t _id) {
 
     status = reverseDb->Put(WriteOptions(), id, word);
     assert(status.ok());
+
+    if (cache)
+        cache->Put(_word, _id);
 }
 
 void PersistentVocabulary::ResetId(wid_t id) {
@@ -316,7 +465,56 @@ void PersistentVocabulary::ForceCompaction() {
     reverseDb->CompactRange(CompactRangeOptions(), NULL, NULL);
 }
 
+void PersistentVocabulary::PreloadCache() {
+    if (!cache)
+        return;
+
+    ReadOptions options = ReadOptions();
+    options.verify_checksums = false;
+    options.fill_cache = false;
+    options.total_order_seek = true;
+
+    Iterator *it = reverseDb->NewIterator(options);
+
+    for (it->SeekToFirst(); it->Valid() && !cache->IsFull(); it->Next()) {
+        wid_t id;
+        if (Deserialize(it->key(), &id))
+            cache->Put(it->value().ToString(), id);
+    }
+
+    delete it;
+}
+
+bool PersistentVocabulary::WriteSnapshot() {
+    ReadOptions options = ReadOptions();
+    options.verify_checksums = false;
+    options.fill_cache = false;
+    options.total_order_seek = true;
+
+    vector<string> words;
+
+    Iterator *it = reverseDb->NewIterator(options);
+
+    for (it->SeekToFirst(); it->Valid(); it->Next()) {
+        wid_t id;
+        if (!Deserialize(it->key(), &id) || id < kVocabularyWordIdStart)
+            continue;
+
+        size_t index = id - kVocabularyWordIdStart;
+        if (index >= words.size())
+            words.resize(index + 1);
+
+        words[index] = it->value().ToString();
+    }
+
+    delete it;
+
+    return VocabularySnapshot::Write(snapshotPath, words, kVocabularyWordIdStart);
+}
+
 PersistentVocabulary::~PersistentVocabulary() {
+    delete snapshot;
+    delete cache;
     delete directDb;
     delete reverseDb;
 }
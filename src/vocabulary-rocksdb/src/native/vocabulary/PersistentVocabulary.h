@@ -9,7 +9,10 @@
 #include <string>
 #include <rocksdb/db.h>
 #include <unordered_set>
+#include <unordered_map>
 #include "IdGenerator.h"
+#include "VocabularyCache.h"
+#include "VocabularySnapshot.h"
 
 using namespace std;
 
@@ -18,7 +21,8 @@ namespace mmt {
 
         class PersistentVocabulary : public Vocabulary {
         public:
-            PersistentVocabulary(string path, bool prepareForBulkLoad = false);
+            PersistentVocabulary(string path, bool prepareForBulkLoad = false,
+                                 size_t cacheSize = kVocabularyDefaultCacheSize);
 
             virtual ~PersistentVocabulary() override;
 
@@ -37,11 +41,21 @@ namespace mmt {
 
             void ResetId(wid_t id);
 
+            void PreloadCache();
+
+            bool WriteSnapshot();
+
         private:
             string idGeneratorPath;
+            string snapshotPath;
             IdGenerator idGenerator;
             rocksdb::DB* directDb;
             rocksdb::DB* reverseDb;
+            VocabularyCache *cache;
+            VocabularySnapshot *snapshot;
+
+            void PutBatch(const vector<rocksdb::Slice> &keys, const vector<size_t> &misses,
+                          unordered_map<string, wid_t> &vocabulary);
         };
 
     }
@@ -0,0 +1,82 @@
+#include "VocabularyCache.h"
+
+using namespace mmt;
+using namespace mmt::vocabulary;
+
+// Rough estimate of the per-entry overhead: hash node, key string, bucket slot and reverse table slot
+static const size_t kEntryOverhead = sizeof(string) + sizeof(wid_t) + 4 * sizeof(void *);
+
+VocabularyCache::VocabularyCache(size_t maxMemory) : maxMemory(maxMemory), memoryUsage(0) {
+    chunks = new atomic<entry_t *>[kChunkCount];
+    for (size_t i = 0; i < kChunkCount; ++i)
+        chunks[i].store(nullptr, memory_order_relaxed);
+
+    memoryUsage += kChunkCount * sizeof(atomic<entry_t *>);
+}
+
+VocabularyCache::~VocabularyCache() {
+    for (size_t i = 0; i < kChunkCount; ++i)
+        delete[] chunks[i].load(memory_order_relaxed);
+    delete[] chunks;
+}
+
+bool VocabularyCache::Get(const string &word, wid_t *outId) {
+    shard_t &shard = shards[hash<string>()(word) % kShardCount];
+    lock_guard<mutex> guard(shard.lock);
+
+    auto entry = shard.words.find(word);
+    if (entry == shard.words.end())
+        return false;
+
+    *outId = entry->second;
+    return true;
+}
+
+const string *VocabularyCache::Get(wid_t id) const {
+    if (id < kVocabularyWordIdStart)
+        return nullptr;
+
+    size_t index = id - kVocabularyWordIdStart;
+    entry_t *chunk = chunks[index >> kChunkBits].load(memory_order_acquire);
+
+    return chunk ? chunk[index & (kChunkSize - 1)].load(memory_order_acquire) : nullptr;
+}
+
+bool VocabularyCache::Put(const string &word, wid_t id) {
+    if (id < kVocabularyWordIdStart || IsFull())
+        return false;
+
+    size_t index = id - kVocabularyWordIdStart;
+    entry_t *chunk = GetOrCreateChunk(index >> kChunkBits);
+
+    shard_t &shard = shards[hash<string>()(word) % kShardCount];
+    lock_guard<mutex> guard(shard.lock);
+
+    auto inserted = shard.words.emplace(word, id);
+    if (!inserted.second)
+        return true;
+
+    // unordered_map never moves its nodes, the key address is stable until the cache is destroyed
+    chunk[index & (kChunkSize - 1)].store(&inserted.first->first, memory_order_release);
+    memoryUsage += word.size() + kEntryOverhead;
+
+    return true;
+}
+
+VocabularyCache::entry_t *VocabularyCache::GetOrCreateChunk(size_t index) {
+    entry_t *chunk = chunks[index].load(memory_order_acquire);
+    if (chunk)
+        return chunk;
+
+    entry_t *newChunk = new entry_t[kChunkSize];
+    for (size_t i = 0; i < kChunkSize; ++i)
+        newChunk[i].store(nullptr, memory_order_relaxed);
+
+    if (chunks[index].compare_exchange_strong(chunk, newChunk, memory_order_acq_rel)) {
+        memoryUsage += kChunkSize * sizeof(entry_t);
+        return newChunk;
+    } else {
+        delete[] newChunk;
+        return chunk;
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef MMTCORE_VOCABULARYCACHE_H
+#define MMTCORE_VOCABULARYCACHE_H
+
+#include <mmt/vocabulary/Vocabulary.h>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+
+using namespace std;
+
+namespace mmt {
+    namespace vocabulary {
+
+        const size_t kVocabularyDefaultCacheSize = 64 * 1024 * 1024;
+
+        /*
+         * Process-wide read-through cache for the vocabulary. Entries are never evicted nor updated:
+         * vocabulary is append-only, so once a (word, id) pair is known it stays valid forever.
+         * When the memory cap is reached, new entries are simply not cached anymore.
+         *
+         * - direct lookups (word -> id) go through a sharded hash map, one mutex per shard
+         * - reverse lookups (id -> word) go through a dense, chunked table indexed by
+         *   (id - kVocabularyWordIdStart) that points to the key strings stored in the shards;
+         *   reads from this table are lock-free.
+         */
+        class VocabularyCache {
+        public:
+            VocabularyCache(size_t maxMemory = kVocabularyDefaultCacheSize);
+
+            ~VocabularyCache();
+
+            bool Get(const string &word, wid_t *outId);
+
+            const string *Get(wid_t id) const;
+
+            bool Put(const string &word, wid_t id);
+
+            size_t GetMemoryUsage() const {
+                return memoryUsage;
+            }
+
+            bool IsFull() const {
+                return memoryUsage >= maxMemory;
+            }
+
+        private:
+            static const size_t kShardCount = 64;
+            static const size_t kChunkBits = 16;
+            static const size_t kChunkSize = 1 << kChunkBits;
+            static const size_t kChunkCount = (((size_t) UINT32_MAX) + 1) >> kChunkBits;
+
+            typedef atomic<const string *> entry_t;
+
+            struct shard_t {
+                mutex lock;
+                unordered_map<string, wid_t> words;
+            };
+
+            const size_t maxMemory;
+            atomic<size_t> memoryUsage;
+
+            shard_t shards[kShardCount];
+            atomic<entry_t *> *chunks;
+
+            entry_t *GetOrCreateChunk(size_t index);
+        };
+
+    }
+}
+
+#endif //MMTCORE_VOCABULARYCACHE_H
@@ -0,0 +1,282 @@
+#include "VocabularySnapshot.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace mmt;
+using namespace mmt::vocabulary;
+
+static_assert(sizeof(wid_t) == 4, "Current implementation only support 4-byte word id");
+
+static const uint64_t kSnapshotMagic = 0x50414e5342434f56ULL; // "VOCBSNAP"
+static const uint32_t kSnapshotVersion = 1;
+
+static const uint32_t kBucketAverageSize = 4;
+static const uint32_t kDirectSlotFlag = 0x80000000U;
+static const uint32_t kMaxSeedAttempts = 1U << 20;
+static const uint32_t kMaxSaltAttempts = 64;
+
+static inline uint64_t Mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static inline uint64_t Hash(const char *word, size_t length, uint32_t salt) {
+    uint64_t h = 0xcbf29ce484222325ULL ^ Mix(salt);
+    for (size_t i = 0; i < length; ++i) {
+        h ^= (uint8_t) word[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static inline uint32_t BucketOf(uint64_t hash, uint32_t bucketCount) {
+    return (uint32_t) (Mix(hash) % bucketCount);
+}
+
+static inline uint32_t SlotOf(uint64_t hash, uint32_t seed, uint32_t slotCount) {
+    if (seed & kDirectSlotFlag)
+        return seed & ~kDirectSlotFlag;
+    return (uint32_t) (Mix(hash + seed * 0x9e3779b97f4a7c15ULL) % slotCount);
+}
+
+static bool BuildPerfectHash(const vector<uint64_t> &hashes, uint32_t bucketCount,
+                             vector<uint32_t> &outSeeds, vector<uint32_t> &outSlots) {
+    uint32_t n = (uint32_t) hashes.size();
+
+    vector<vector<uint32_t>> buckets(bucketCount);
+    for (uint32_t k = 0; k < n; ++k)
+        buckets[BucketOf(hashes[k], bucketCount)].push_back(k);
+
+    vector<uint32_t> order(bucketCount);
+    for (uint32_t b = 0; b < bucketCount; ++b)
+        order[b] = b;
+    stable_sort(order.begin(), order.end(), [&buckets](uint32_t a, uint32_t b) {
+        return buckets[a].size() > buckets[b].size();
+    });
+
+    outSeeds.assign(bucketCount, 0);
+    outSlots.assign(n, 0);
+
+    vector<bool> taken(n, false);
+    vector<uint32_t> candidates;
+    uint32_t freeCursor = 0;
+
+    for (auto b = order.begin(); b != order.end(); ++b) {
+        const vector<uint32_t> &bucket = buckets[*b];
+
+        if (bucket.empty())
+            break;
+
+        if (bucket.size() == 1) {
+            // Larger buckets have all been placed already: singletons just take the next free slot
+            while (taken[freeCursor])
+                freeCursor++;
+
+            taken[freeCursor] = true;
+            outSeeds[*b] = kDirectSlotFlag | freeCursor;
+            outSlots[freeCursor] = bucket[0];
+            continue;
+        }
+
+        bool placed = false;
+
+        for (uint32_t seed = 1; seed < kMaxSeedAttempts && !placed; ++seed) {
+            candidates.clear();
+            placed = true;
+
+            for (auto k = bucket.begin(); k != bucket.end(); ++k) {
+                uint32_t slot = SlotOf(hashes[*k], seed, n);
+
+                if (taken[slot] || find(candidates.begin(), candidates.end(), slot) != candidates.end()) {
+                    placed = false;
+                    break;
+                }
+
+                candidates.push_back(slot);
+            }
+
+            if (placed) {
+                outSeeds[*b] = seed;
+                for (size_t i = 0; i < bucket.size(); ++i) {
+                    taken[candidates[i]] = true;
+                    outSlots[candidates[i]] = bucket[i];
+                }
+            }
+        }
+
+        if (!placed)
+            return false;
+    }
+
+    return true;
+}
+
+bool VocabularySnapshot::Write(const string &path, const vector<string> &words, wid_t firstId) {
+    vector<uint32_t> keys;
+    vector<uint64_t> offsets;
+    offsets.reserve(words.size() + 1);
+
+    uint64_t heapSize = 0;
+    for (size_t i = 0; i < words.size(); ++i) {
+        offsets.push_back(heapSize);
+        heapSize += words[i].size();
+
+        if (!words[i].empty())
+            keys.push_back((uint32_t) i);
+    }
+    offsets.push_back(heapSize);
+
+    header_t header;
+    memset(&header, 0, sizeof(header_t));
+    header.magic = kSnapshotMagic;
+    header.version = kSnapshotVersion;
+    header.firstId = firstId;
+    header.idCount = (uint32_t) words.size();
+    header.wordCount = (uint32_t) keys.size();
+    header.bucketCount = max((uint32_t) 1, (header.wordCount + kBucketAverageSize - 1) / kBucketAverageSize);
+    header.heapSize = heapSize;
+
+    vector<uint32_t> seeds;
+    vector<uint32_t> slots;
+    vector<uint64_t> hashes(keys.size());
+
+    bool built = false;
+    for (uint32_t salt = 0; salt < kMaxSaltAttempts && !built; ++salt) {
+        for (size_t k = 0; k < keys.size(); ++k) {
+            const string &word = words[keys[k]];
+            hashes[k] = Hash(word.data(), word.size(), salt);
+        }
+
+        header.salt = salt;
+        built = BuildPerfectHash(hashes, header.bucketCount, seeds, slots);
+    }
+
+    if (!built)
+        return false;
+
+    for (size_t i = 0; i < slots.size(); ++i)
+        slots[i] = firstId + keys[slots[i]];
+
+    string tmpPath = path + ".tmp";
+    FILE *file = fopen(tmpPath.c_str(), "wb");
+    if (!file)
+        return false;
+
+    bool success = fwrite(&header, sizeof(header_t), 1, file) == 1;
+    success &= fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), file) == offsets.size();
+    success &= fwrite(seeds.data(), sizeof(uint32_t), seeds.size(), file) == seeds.size();
+    success &= fwrite(slots.data(), sizeof(wid_t), slots.size(), file) == slots.size();
+    for (auto word = words.begin(); word != words.end() && success; ++word)
+        success &= fwrite(word->data(), 1, word->size(), file) == word->size();
+
+    success &= fflush(file) == 0;
+    success &= fsync(fileno(file)) == 0;
+    fclose(file);
+
+    if (success)
+        success = rename(tmpPath.c_str(), path.c_str()) == 0;
+    if (!success)
+        remove(tmpPath.c_str());
+
+    return success;
+}
+
+VocabularySnapshot *VocabularySnapshot::Open(const string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+        return NULL;
+
+    struct stat info;
+    if (fstat(fd, &info) == -1 || (size_t) info.st_size < sizeof(header_t)) {
+        close(fd);
+        return NULL;
+    }
+
+    size_t length = (size_t) info.st_size;
+    void *data = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED)
+        return NULL;
+
+    const header_t *header = (const header_t *) data;
+    size_t expectedLength = sizeof(header_t) +
+                            sizeof(uint64_t) * ((size_t) header->idCount + 1) +
+                            sizeof(uint32_t) * (size_t) header->bucketCount +
+                            sizeof(wid_t) * (size_t) header->wordCount +
+                            header->heapSize;
+
+    if (header->magic != kSnapshotMagic || header->version != kSnapshotVersion ||
+        header->bucketCount == 0 || length != expectedLength) {
+        munmap(data, length);
+        return NULL;
+    }
+
+    return new VocabularySnapshot(data, length);
+}
+
+VocabularySnapshot::VocabularySnapshot(void *data, size_t dataLength) : data(data), dataLength(dataLength) {
+    const char *ptr = (const char *) data;
+
+    header = (const header_t *) ptr;
+    ptr += sizeof(header_t);
+    offsets = (const uint64_t *) ptr;
+    ptr += sizeof(uint64_t) * ((size_t) header->idCount + 1);
+    seeds = (const uint32_t *) ptr;
+    ptr += sizeof(uint32_t) * header->bucketCount;
+    slots = (const wid_t *) ptr;
+    ptr += sizeof(wid_t) * header->wordCount;
+    heap = ptr;
+}
+
+VocabularySnapshot::~VocabularySnapshot() {
+    munmap(data, dataLength);
+}
+
+bool VocabularySnapshot::Lookup(const string &word, wid_t *outId) const {
+    if (header->wordCount == 0 || word.empty())
+        return false;
+
+    uint64_t hash = Hash(word.data(), word.size(), header->salt);
+    uint32_t seed = seeds[BucketOf(hash, header->bucketCount)];
+    uint32_t slot = SlotOf(hash, seed, header->wordCount);
+
+    if (slot >= header->wordCount)
+        return false;
+
+    wid_t id = slots[slot];
+    size_t index = id - header->firstId;
+
+    uint64_t offset = offsets[index];
+    uint64_t length = offsets[index + 1] - offset;
+
+    if (length != word.size() || memcmp(heap + offset, word.data(), length) != 0)
+        return false;
+
+    *outId = id;
+    return true;
+}
+
+bool VocabularySnapshot::ReverseLookup(wid_t id, string *outWord) const {
+    if (id < header->firstId || id >= GetEndId())
+        return false;
+
+    size_t index = id - header->firstId;
+    uint64_t offset = offsets[index];
+    uint64_t length = offsets[index + 1] - offset;
+
+    if (length == 0)
+        return false;
+
+    outWord->assign(heap + offset, length);
+    return true;
+}
@@ -0,0 +1,73 @@
+#ifndef MMTCORE_VOCABULARYSNAPSHOT_H
+#define MMTCORE_VOCABULARYSNAPSHOT_H
+
+#include <mmt/vocabulary/Vocabulary.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+namespace mmt {
+    namespace vocabulary {
+
+        /*
+         * Immutable, memory-mapped image of the vocabulary. File layout:
+         *
+         *   header_t
+         *   uint64_t offsets[idCount + 1]   id -> word position in the string heap (dense, firstId based)
+         *   uint32_t seeds[bucketCount]     minimal perfect hash displacements (hash-and-displace)
+         *   wid_t    slots[wordCount]       perfect hash slot -> word id
+         *   char     heap[heapSize]         contiguous, not null-terminated words
+         *
+         * Missing ids have zero length. Direct lookups hash the word into its slot and then verify it
+         * against the heap, so words that are not part of the snapshot are correctly rejected.
+         */
+        class VocabularySnapshot {
+        public:
+            static VocabularySnapshot *Open(const string &path);
+
+            static bool Write(const string &path, const vector<string> &words, wid_t firstId);
+
+            ~VocabularySnapshot();
+
+            bool Lookup(const string &word, wid_t *outId) const;
+
+            bool ReverseLookup(wid_t id, string *outWord) const;
+
+            wid_t GetFirstId() const {
+                return header->firstId;
+            }
+
+            wid_t GetEndId() const {
+                return header->firstId + header->idCount;
+            }
+
+        private:
+            struct header_t {
+                uint64_t magic;
+                uint32_t version;
+                uint32_t firstId;
+                uint32_t idCount;
+                uint32_t wordCount;
+                uint32_t bucketCount;
+                uint32_t salt;
+                uint64_t heapSize;
+            };
+
+            void *data;
+            size_t dataLength;
+
+            const header_t *header;
+            const uint64_t *offsets;
+            const uint32_t *seeds;
+            const wid_t *slots;
+            const char *heap;
+
+            VocabularySnapshot(void *data, size_t dataLength);
+        };
+
+    }
+}
+
+#endif //MMTCORE_VOCABULARYSNAPSHOT_H